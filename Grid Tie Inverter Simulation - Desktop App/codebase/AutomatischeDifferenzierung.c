@@ -0,0 +1,564 @@
+#include "inverter.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Forward-mode automatic differentiation of the closed loop
+// Every signal of the model is a dual number x + sum_j x_j * e_j (e_j * e_k = 0) that
+// carries its value together with the partial derivatives with respect to up to
+// AD_MAX_PARAMETERS tuning parameters. One run of the dual model returns a cost metric
+// and its exact gradient, instead of two perturbed runs per parameter.
+// The model mirrors simulation_step() at a fixed step for the configurations the tuner
+// works on: SRF-PLL on the loaded PCC voltages of the grid model, and no control, the
+// single-phase PI current loop or the three-phase dq loops. ad_cost() runs the same
+// metric on the double-precision modules, so the two can be compared directly.
+
+#define AD_THD_ORDER 25 // Highest harmonic in the THD metric
+#define AD_PLL_BAND (2.0 * M_PI / 180.0) // Settling band of the PLL phase error (rad)
+
+typedef struct {
+    double v; // Value
+    double d[AD_MAX_PARAMETERS]; // Partial derivatives
+} Dual;
+
+static inline Dual dual_const(double v) {
+    Dual r = { v, { 0.0 } };
+    return r;
+}
+
+static inline Dual dual_add(Dual a, Dual b) {
+    Dual r = { a.v + b.v, { 0.0 } };
+    for (int j = 0; j < AD_MAX_PARAMETERS; j++) r.d[j] = a.d[j] + b.d[j];
+    return r;
+}
+
+static inline Dual dual_sub(Dual a, Dual b) {
+    Dual r = { a.v - b.v, { 0.0 } };
+    for (int j = 0; j < AD_MAX_PARAMETERS; j++) r.d[j] = a.d[j] - b.d[j];
+    return r;
+}
+
+static inline Dual dual_scale(Dual a, double k) {
+    Dual r = { a.v * k, { 0.0 } };
+    for (int j = 0; j < AD_MAX_PARAMETERS; j++) r.d[j] = a.d[j] * k;
+    return r;
+}
+
+static inline Dual dual_mul(Dual a, Dual b) {
+    Dual r = { a.v * b.v, { 0.0 } };
+    for (int j = 0; j < AD_MAX_PARAMETERS; j++) r.d[j] = a.d[j] * b.v + a.v * b.d[j];
+    return r;
+}
+
+static inline Dual dual_div(Dual a, Dual b) {
+    Dual r = { a.v / b.v, { 0.0 } };
+    for (int j = 0; j < AD_MAX_PARAMETERS; j++) r.d[j] = (a.d[j] - r.v * b.d[j]) / b.v;
+    return r;
+}
+
+// a + k * b
+static inline Dual dual_axpy(Dual a, double k, Dual b) {
+    Dual r = { a.v + k * b.v, { 0.0 } };
+    for (int j = 0; j < AD_MAX_PARAMETERS; j++) r.d[j] = a.d[j] + k * b.d[j];
+    return r;
+}
+
+static inline Dual dual_hypot(Dual a, Dual b) {
+    Dual r = { hypot(a.v, b.v), { 0.0 } };
+    if (r.v > 0.0) {
+        for (int j = 0; j < AD_MAX_PARAMETERS; j++) r.d[j] = (a.v * a.d[j] + b.v * b.d[j]) / r.v;
+    }
+    return r;
+}
+
+static inline Dual dual_sqrt(Dual a) {
+    Dual r = { sqrt(a.v), { 0.0 } };
+    if (r.v > 0.0) {
+        for (int j = 0; j < AD_MAX_PARAMETERS; j++) r.d[j] = a.d[j] / (2.0 * r.v);
+    }
+    return r;
+}
+
+static inline Dual dual_fabs(Dual a) {
+    return a.v < 0.0 ? dual_scale(a, -1.0) : a;
+}
+
+// Clamp: the derivative vanishes while a limit is active
+static inline Dual dual_clamp(Dual a, double lo, double hi) {
+    return a.v < lo ? dual_const(lo) : a.v > hi ? dual_const(hi) : a;
+}
+
+// sin and cos of an angle whose value is already wrapped
+static inline void dual_sin_cos(Dual a, Dual *s, Dual *c) {
+    double sv = sin(a.v), cv = cos(a.v);
+    *s = dual_scale(a, cv);
+    *c = dual_scale(a, -sv);
+    s->v = sv;
+    c->v = cv;
+}
+
+// timebase_angle(f, t) with a dual frequency: d/df = 2*pi*t
+static inline Dual dual_timebase_angle(Dual f, double t) {
+    Dual r = dual_scale(f, 2 * M_PI * t);
+    r.v = timebase_angle(f.v, t);
+    return r;
+}
+
+static double wrap_angle(double a) {
+    a = fmod(a, 2 * M_PI);
+    return a < 0 ? a + 2 * M_PI : a;
+}
+
+// Tustin PI (kp*s + ki) / s, the coefficients biquad_pi() and biquad_set_rate() produce:
+// b0 = kp + ki*dt/2, b1 = ki*dt/2 - kp, a1 = -1 (transposed direct form II, one state)
+static Dual dual_pi_update(Dual *s1, Dual kp, Dual ki, double dt, Dual x) {
+    Dual half = dual_scale(ki, dt / 2.0);
+    Dual y = dual_add(dual_mul(dual_add(kp, half), x), *s1);
+    *s1 = dual_add(dual_mul(dual_sub(half, kp), x), y);
+    return y;
+}
+
+// Differentiable copy of the model state that depends on the tuning parameters
+typedef struct {
+    Dual pll_kp, pll_ki, control_kp, control_ki; // Tuning parameters
+    Dual pll_s1, pll_angle, pll_frequency, pll_voltage; // SRF-PLL
+    Dual pi_s1[2]; // current_pi and current_pi_q
+    Dual control_output; // Single-phase duty
+    Dual harmonic_output; // Single-phase waveform correction
+    Dual control_dq[2]; // Three-phase dq modulation
+    Dual current[3]; // Plant phase currents (phase a only for single-phase)
+} ADState;
+
+// Cost accumulated along the run
+typedef struct {
+    ADMetric metric;
+    double start; // Window start (absolute time, s)
+    double end; // Run end (absolute time, s)
+    double dt;
+    Dual cost; // ITAE integral or settling time
+    Dual prev_error; // Settling: |e| of the previous sample
+    gboolean outside; // Settling: previous sample outside the band
+    int thd_samples; // THD: samples per fundamental period
+    Dual thd_re[AD_THD_ORDER], thd_im[AD_THD_ORDER]; // THD: DFT of the last period
+    double frequency; // THD: fundamental (Hz)
+} ADMetricState;
+
+static void ad_metric_init(ADMetricState *m, ADMetric metric, double t0, double duration, double dt, double start,
+                           double frequency) {
+    memset(m, 0, sizeof(*m));
+    m->metric = metric;
+    m->start = t0 + start;
+    m->end = t0 + duration;
+    m->dt = dt;
+    m->frequency = frequency;
+    m->thd_samples = (int)round(1.0 / (frequency * dt));
+}
+
+// One sample at time t: error of the selected signal (current tracking or PLL phase) and the
+// phase-a current; step is the sample index counted back from the last one (0 = last)
+static void ad_metric_sample(ADMetricState *m, double t, Dual error, Dual current, int step) {
+    if (t < m->start - 0.5 * m->dt) {
+        return;
+    }
+    switch (m->metric) {
+        case AD_METRIC_CURRENT_ITAE:
+        case AD_METRIC_PLL_ITAE:
+            // Integral of (t - start) * |e| dt
+            m->cost = dual_axpy(m->cost, (t - m->start) * m->dt, dual_fabs(error));
+            break;
+        case AD_METRIC_PLL_SETTLING: {
+            // Last exit from the band, interpolated between samples: the crossing time is a
+            // smooth function of the samples around it, so it differentiates like any signal
+            Dual e = dual_fabs(error);
+            gboolean outside = e.v >= AD_PLL_BAND;
+            if (m->outside && !outside) {
+                Dual span = dual_sub(m->prev_error, e);
+                Dual fraction = dual_div(dual_sub(m->prev_error, dual_const(AD_PLL_BAND)), span);
+                m->cost = dual_scale(fraction, m->dt);
+                m->cost.v += t - m->dt - m->start;
+            } else if (outside && step == 0) {
+                m->cost = dual_const(m->end - m->start); // Not settled within the run
+            }
+            m->outside = outside;
+            m->prev_error = e;
+            break;
+        }
+        case AD_METRIC_CURRENT_THD:
+            // DFT of the phase-a current over the last whole period
+            if (step < m->thd_samples) {
+                double theta = timebase_angle(m->frequency, t);
+                for (int h = 0; h < AD_THD_ORDER; h++) {
+                    double angle = wrap_angle((h + 1) * theta);
+                    m->thd_re[h] = dual_axpy(m->thd_re[h], sin(angle), current);
+                    m->thd_im[h] = dual_axpy(m->thd_im[h], cos(angle), current);
+                }
+            }
+            if (step == 0) {
+                Dual harmonics = dual_const(0.0);
+                for (int h = 1; h < AD_THD_ORDER; h++) {
+                    harmonics = dual_add(harmonics, dual_add(dual_mul(m->thd_re[h], m->thd_re[h]),
+                                                             dual_mul(m->thd_im[h], m->thd_im[h])));
+                }
+                Dual fundamental = dual_hypot(m->thd_re[0], m->thd_im[0]);
+                m->cost = fundamental.v > 0.0 ? dual_div(dual_sqrt(harmonics), fundamental) : dual_const(0.0);
+            }
+            break;
+    }
+}
+
+static double wrap_error(double e) {
+    return e - 2 * M_PI * floor(e / (2 * M_PI) + 0.5); // To [-pi, pi)
+}
+
+// Error signal of the metric at time t, after the step; pll_angle is the estimate for t
+static Dual ad_metric_error(const ADMetricState *m, const InverterParams *params, double t, Dual pll_angle,
+                            Dual current, double grid_frequency) {
+    if (m->metric == AD_METRIC_PLL_ITAE || m->metric == AD_METRIC_PLL_SETTLING) {
+        Dual e = dual_scale(pll_angle, -1.0);
+        e.v = wrap_error(timebase_angle(grid_frequency, t) - pll_angle.v);
+        return e;
+    }
+    double ref = params->control_ref_current * sin(timebase_angle(params->frequency, t) + params->phase);
+    return dual_sub(dual_const(ref), current);
+}
+
+static gboolean ad_supported(const InverterParams *params) {
+    if (params->fixed_point) {
+        fprintf(stderr, "[Error] Automatic differentiation: not available in fixed-point emulation\n");
+        return FALSE;
+    }
+    if (params->pll_enabled && params->pll_type != PLL_SRF) {
+        fprintf(stderr, "[Error] Automatic differentiation: only the SRF-PLL is modelled\n");
+        return FALSE;
+    }
+    if (params->control != CONTROL_NONE && params->control != CONTROL_PI) {
+        fprintf(stderr, "[Error] Automatic differentiation: only PI current control is modelled\n");
+        return FALSE;
+    }
+    return TRUE;
+}
+
+double *ad_parameter(InverterParams *params, ADParameter parameter) {
+    switch (parameter) {
+        case AD_PARAM_PLL_KP: return &params->pll_kp;
+        case AD_PARAM_PLL_KI: return &params->pll_ki;
+        case AD_PARAM_CONTROL_KP: return &params->control_kp;
+        case AD_PARAM_CONTROL_KI: return &params->control_ki;
+    }
+    return NULL;
+}
+
+// SRF-PLL (pll_update with PLL_SRF): Clarke and Park of the loaded PCC voltages, PI on the
+// normalised q, angle advanced by the limited frequency. Returns the angle estimate for time.
+static Dual ad_pll_update(ADState *st, InverterParams *params, double time, double dt, double *grid_frequency) {
+    double v_source[3], drop[3], amplitude;
+    grid_pcc_source(params, time, v_source, drop, grid_frequency, &amplitude);
+    Dual v[3];
+    for (int k = 0; k < 3; k++) {
+        gboolean loaded = control_dq_active(params) || (k == 0 && params->control != CONTROL_NONE);
+        v[k] = loaded ? dual_axpy(dual_const(v_source[k]), -drop[k], st->current[k]) : dual_const(v_source[k]);
+    }
+    Dual alpha = dual_scale(dual_sub(dual_sub(dual_scale(v[0], 2.0), v[1]), v[2]), 1.0 / 3.0);
+    Dual beta = dual_scale(dual_sub(v[1], v[2]), 1.0 / sqrt(3.0));
+    Dual s, c;
+    dual_sin_cos(st->pll_angle, &s, &c);
+    Dual d = dual_add(dual_mul(alpha, s), dual_mul(beta, c));
+    Dual q = dual_sub(dual_mul(alpha, c), dual_mul(beta, s));
+    Dual magnitude = dual_hypot(d, q);
+    Dual error = magnitude.v > 1.0 ? dual_div(q, magnitude) : dual_const(0.0);
+
+    Dual kp = dual_scale(st->pll_kp, PLL_KP / PLL_DEFAULT_KP);
+    Dual ki = dual_scale(st->pll_ki, PLL_KI / PLL_DEFAULT_KI);
+    Dual w = dual_pi_update(&st->pll_s1, kp, ki, dt, error);
+    w.v += 2 * M_PI * PLL_NOMINAL_FREQUENCY;
+    w = dual_clamp(w, 2 * M_PI * 0.8 * PLL_NOMINAL_FREQUENCY, 2 * M_PI * 1.2 * PLL_NOMINAL_FREQUENCY);
+
+    // Reported frequency and voltage (pll_publish)
+    Dual f_error = dual_sub(dual_scale(w, 1.0 / (2 * M_PI)), st->pll_frequency);
+    st->pll_frequency = dual_axpy(st->pll_frequency, 1.0 - exp(-dt / PLL_FREQUENCY_TAU), f_error);
+    Dual v_error = dual_sub(dual_scale(magnitude, 1.0 / sqrt(2)), st->pll_voltage);
+    st->pll_voltage = dual_axpy(st->pll_voltage, 1.0 - exp(-dt / PLL_VOLTAGE_TAU), v_error);
+
+    Dual estimate = st->pll_angle;
+    st->pll_angle = dual_axpy(st->pll_angle, dt, w);
+    st->pll_angle.v = wrap_angle(estimate.v + w.v * dt);
+    return estimate;
+}
+
+// Single-phase PI current loop (control_update with CONTROL_PI): grid and reference feed-forward plus
+// the limited PI correction with its gains scaled at coarse steps. estimate is the PLL angle for time.
+static void ad_control_single(ADState *st, InverterParams *params, double time, double dt, Dual estimate) {
+    const double limit = 0.5, gain_limit = 0.75; // CURRENT_CORRECTION_LIMIT, CURRENT_LOOP_GAIN_LIMIT
+    double v_peak = params->voltage * sqrt(2);
+    double angle = timebase_angle(params->frequency, time) + params->phase;
+    double ref_current = params->control_ref_current * sin(angle);
+    Dual v_inv = dual_add(dual_scale(st->control_output, v_peak * sin(angle)), dual_scale(st->harmonic_output, v_peak));
+    double v_source[3], drop[3], grid_frequency, amplitude;
+    grid_pcc_source(params, time, v_source, drop, &grid_frequency, &amplitude);
+    double a, b;
+    plant_coefficients(dt, &a, &b);
+    st->current[0] = dual_add(dual_scale(st->current[0], a), dual_scale(dual_sub(v_inv, dual_const(v_source[0])), b));
+    Dual error = dual_sub(dual_const(ref_current), st->current[0]);
+    Dual kp = st->control_kp, ki = st->control_ki;
+    Dual loop_gain = dual_scale(dual_axpy(kp, 0.5 * dt, ki), v_peak * b);
+    if (loop_gain.v > gain_limit) {
+        Dual scale = dual_div(dual_const(gain_limit), loop_gain);
+        kp = dual_mul(kp, scale);
+        ki = dual_mul(ki, scale);
+    }
+    Dual pi_state = st->pi_s1[0];
+    Dual u = dual_pi_update(&st->pi_s1[0], kp, ki, dt, error);
+    if (fabs(u.v) > limit) {
+        u = dual_const(u.v > 0.0 ? limit : -limit);
+        st->pi_s1[0] = pi_state;
+    }
+
+    // Feed-forward for the next step: the PLL angle advanced by its frequency, or the nominal angle
+    Dual grid_voltage = params->pll_enabled ? st->pll_voltage : dual_const(220.0);
+    Dual grid_angle = params->pll_enabled ? dual_axpy(estimate, 2 * M_PI * dt, st->pll_frequency)
+                                          : dual_const(timebase_angle(params->frequency, time + dt));
+    double angle_next = timebase_angle(params->frequency, time + dt) + params->phase;
+    double ref_next = params->control_ref_current * sin(angle_next);
+    Dual s, c;
+    dual_sin_cos(grid_angle, &s, &c);
+    Dual v_ff = dual_add(dual_scale(dual_mul(grid_voltage, s), sqrt(2)), dual_const((ref_next - a * ref_current) / b));
+    Dual envelope = dual_clamp(dual_scale(grid_voltage, 1.0 / params->voltage), 0.0, 1.0);
+    st->harmonic_output = dual_add(dual_scale(dual_sub(v_ff, dual_scale(envelope, v_peak * sin(angle_next))), 1.0 / v_peak), u);
+    st->control_output = envelope;
+}
+
+// abc -> dq on a dual angle (abc_to_dq_batch)
+static void dual_abc_to_dq(const Dual *x, Dual s, Dual c, Dual *d, Dual *q) {
+    Dual alpha = dual_scale(dual_sub(dual_sub(dual_scale(x[0], 2.0), x[1]), x[2]), 1.0 / 3.0);
+    Dual beta = dual_scale(dual_sub(x[1], x[2]), 1.0 / sqrt(3.0));
+    *d = dual_add(dual_mul(alpha, s), dual_mul(beta, c));
+    *q = dual_sub(dual_mul(alpha, c), dual_mul(beta, s));
+}
+
+// Three-phase dq current loops (dq_current_control)
+static void ad_control_dq(ADState *st, InverterParams *params, double time, double dt) {
+    Dual frequency = params->pll_enabled ? st->pll_frequency : dual_const(params->frequency);
+    Dual w = dual_scale(frequency, 2 * M_PI);
+    Dual theta = dual_timebase_angle(frequency, time);
+    Dual s, c;
+    dual_sin_cos(theta, &s, &c);
+    double v_peak = params->voltage * sqrt(2);
+
+    // Bridge voltages from the previous modulation, grid source phase voltages
+    Dual alpha = dual_add(dual_mul(st->control_dq[0], s), dual_mul(st->control_dq[1], c));
+    Dual beta = dual_sub(dual_mul(st->control_dq[0], c), dual_mul(st->control_dq[1], s));
+    Dual v[3], e[3];
+    v[0] = dual_scale(alpha, v_peak);
+    v[1] = dual_scale(dual_axpy(dual_scale(alpha, -0.5), sqrt(3.0) / 2.0, beta), v_peak);
+    v[2] = dual_scale(dual_axpy(dual_scale(alpha, -0.5), -sqrt(3.0) / 2.0, beta), v_peak);
+    double v_source[3], drop[3], grid_frequency, amplitude;
+    grid_pcc_source(params, time, v_source, drop, &grid_frequency, &amplitude);
+    for (int k = 0; k < 3; k++) {
+        e[k] = dual_const(v_source[k]);
+    }
+    Dual v_n = dual_scale(dual_add(dual_add(dual_sub(v[0], e[0]), dual_sub(v[1], e[1])), dual_sub(v[2], e[2])), 1.0 / 3.0);
+    double a, b;
+    plant_coefficients(dt, &a, &b);
+    for (int k = 0; k < 3; k++) {
+        st->current[k] = dual_add(dual_scale(st->current[k], a), dual_scale(dual_sub(dual_sub(v[k], e[k]), v_n), b));
+    }
+
+    Dual i_d, i_q, e_d, e_q;
+    dual_abc_to_dq(st->current, s, c, &i_d, &i_q);
+    dual_abc_to_dq(e, s, c, &e_d, &e_q);
+    double wc = fmin(2 * M_PI * 500.0, 0.25 / dt);
+    Dual kp = dual_const(PLANT_L * wc), ki = dual_const(PLANT_R * wc);
+    double ref_d = params->control_ref_current * cos(params->phase);
+    double ref_q = params->control_ref_current * sin(params->phase);
+    Dual pi_d = st->pi_s1[0], pi_q = st->pi_s1[1];
+    Dual v_d = dual_add(dual_pi_update(&st->pi_s1[0], kp, ki, dt, dual_sub(dual_const(ref_d), i_d)),
+                        dual_sub(e_d, dual_scale(dual_mul(w, i_q), PLANT_L)));
+    Dual v_q = dual_add(dual_pi_update(&st->pi_s1[1], kp, ki, dt, dual_sub(dual_const(ref_q), i_q)),
+                        dual_add(e_q, dual_scale(dual_mul(w, i_d), PLANT_L)));
+
+    // Modulation limit with anti-windup
+    const double m_max = 2.0 / sqrt(3.0);
+    Dual m_d = dual_scale(v_d, 1.0 / v_peak), m_q = dual_scale(v_q, 1.0 / v_peak);
+    Dual m = dual_hypot(m_d, m_q);
+    if (m.v > m_max) {
+        Dual ratio = dual_div(dual_const(m_max), m);
+        m_d = dual_mul(m_d, ratio);
+        m_q = dual_mul(m_q, ratio);
+        st->pi_s1[0] = pi_d;
+        st->pi_s1[1] = pi_q;
+    }
+    st->control_dq[0] = m_d;
+    st->control_dq[1] = m_q;
+}
+
+gboolean ad_evaluate(const InverterParams *params, ADMetric metric, double duration, double dt, double start,
+                     const ADParameter *wrt, int n, double *cost, double *gradient) {
+    if (!ad_supported(params)) {
+        return FALSE;
+    }
+    if (n < 0 || n > AD_MAX_PARAMETERS) {
+        fprintf(stderr, "[Error] Automatic differentiation: at most %d parameters\n", AD_MAX_PARAMETERS);
+        return FALSE;
+    }
+    InverterParams p = *params;
+    ADState st;
+    memset(&st, 0, sizeof(st));
+    st.pll_kp = dual_const(p.pll_kp);
+    st.pll_ki = dual_const(p.pll_ki);
+    st.control_kp = dual_const(p.control_kp);
+    st.control_ki = dual_const(p.control_ki);
+    for (int j = 0; j < n; j++) {
+        Dual *seed = wrt[j] == AD_PARAM_PLL_KP ? &st.pll_kp : wrt[j] == AD_PARAM_PLL_KI ? &st.pll_ki
+                   : wrt[j] == AD_PARAM_CONTROL_KP ? &st.control_kp : &st.control_ki;
+        seed->d[j] = 1.0;
+    }
+    st.pll_s1 = dual_const(p.pll_pi.s1);
+    st.pll_angle = dual_const(p.pll_angle);
+    st.pll_frequency = dual_const(p.pll_frequency);
+    st.pll_voltage = dual_const(p.pll_voltage);
+    st.pi_s1[0] = dual_const(p.current_pi.s1);
+    st.pi_s1[1] = dual_const(p.current_pi_q.s1);
+    st.control_output = dual_const(p.control_output);
+    st.harmonic_output = dual_const(p.harmonic_output);
+    st.control_dq[0] = dual_const(p.control_dq[0]);
+    st.control_dq[1] = dual_const(p.control_dq[1]);
+    gboolean dq = control_dq_active(&p);
+    for (int k = 0; k < 3; k++) {
+        st.current[k] = dual_const(dq ? p.plant_current_abc[k] : k == 0 ? p.plant_current : 0.0);
+    }
+
+    ADMetricState m;
+    ad_metric_init(&m, metric, p.sim_time, duration, dt, start, p.frequency);
+    int steps = (int)round(duration / dt);
+    double grid_frequency = p.frequency;
+    for (int k = 1; k <= steps; k++) {
+        timebase_advance(&p, dt);
+        Dual estimate = st.pll_angle;
+        if (p.pll_enabled) {
+            estimate = ad_pll_update(&st, &p, p.sim_time, dt, &grid_frequency);
+        }
+        if (dq) {
+            ad_control_dq(&st, &p, p.sim_time, dt);
+        } else if (p.control != CONTROL_NONE) {
+            ad_control_single(&st, &p, p.sim_time, dt, estimate);
+        }
+        Dual error = ad_metric_error(&m, &p, p.sim_time, estimate, st.current[0], grid_frequency);
+        ad_metric_sample(&m, p.sim_time, error, st.current[0], steps - k);
+    }
+    *cost = m.cost.v;
+    for (int j = 0; j < n; j++) gradient[j] = m.cost.d[j];
+    return TRUE;
+}
+
+// Same run and metric on the double-precision modules (pll_update, control_update)
+gboolean ad_cost(const InverterParams *params, ADMetric metric, double duration, double dt, double start, double *cost) {
+    if (!ad_supported(params)) {
+        return FALSE;
+    }
+    InverterParams p = *params;
+    ADMetricState m;
+    ad_metric_init(&m, metric, p.sim_time, duration, dt, start, p.frequency);
+    int steps = (int)round(duration / dt);
+    for (int k = 1; k <= steps; k++) {
+        timebase_advance(&p, dt);
+        double estimate = p.pll_angle, grid_frequency = p.frequency;
+        if (p.pll_enabled) {
+            double v_source[3], drop[3], amplitude;
+            grid_pcc_source(&p, p.sim_time, v_source, drop, &grid_frequency, &amplitude);
+            pll_update(&p, p.sim_time, dt);
+        }
+        if (p.control != CONTROL_NONE) {
+            control_update(&p, p.sim_time, dt);
+        }
+        Dual error = ad_metric_error(&m, &p, p.sim_time, dual_const(estimate), dual_const(p.plant_current), grid_frequency);
+        ad_metric_sample(&m, p.sim_time, error, dual_const(p.plant_current), steps - k);
+    }
+    *cost = m.cost.v;
+    return TRUE;
+}
+
+// Headless mode: --ad-bench [seconds]
+// Cost and gradient from one dual run against the double-precision model and central
+// finite differences on it (two runs per parameter).
+typedef struct {
+    const char *name;
+    InverterType type;
+    ControlType control;
+    GridCondition grid;
+    ADMetric metric;
+    double start; // Metric window start (s)
+    int n;
+    ADParameter wrt[AD_MAX_PARAMETERS];
+} ADBenchCase;
+
+static const char *ad_parameter_names[] = { "pll_kp", "pll_ki", "control_kp", "control_ki" };
+
+// Gradient mismatch relative to |fd|, but never to less than AD_GRADIENT_FLOOR of the
+// cost per unit relative change of the parameter: derivatives below that are zero to
+// within the finite-difference noise, and the plain ratio of two such numbers is meaningless
+#define AD_GRADIENT_FLOOR 1e-6
+
+static double ad_gradient_error(double ad, double fd, double cost, double x) {
+    double scale = AD_GRADIENT_FLOOR * fabs(cost) / fmax(fabs(x), 1e-12);
+    return fabs(ad - fd) / fmax(fabs(fd), fmax(scale, 1e-300));
+}
+
+int ad_bench_main(int argc, char *argv[]) {
+    double duration = argc > 2 ? atof(argv[2]) : 1.6;
+    const double dt = 50e-6;
+    const ADBenchCase cases[] = {
+        { "PLL ITAE, 52 Hz shift at 1 s", SINGLE_PHASE, CONTROL_NONE, GRID_FAULT_FREQ_SHIFT, AD_METRIC_PLL_ITAE, 0.0,
+          2, { AD_PARAM_PLL_KP, AD_PARAM_PLL_KI } },
+        { "PLL settling, 52 Hz shift at 1 s", SINGLE_PHASE, CONTROL_NONE, GRID_FAULT_FREQ_SHIFT, AD_METRIC_PLL_SETTLING,
+          1.0, 2, { AD_PARAM_PLL_KP, AD_PARAM_PLL_KI } },
+        { "Single-phase PI ITAE, 50% sag", SINGLE_PHASE, CONTROL_PI, GRID_FAULT_SAG, AD_METRIC_CURRENT_ITAE, 0.0, 4,
+          { AD_PARAM_PLL_KP, AD_PARAM_PLL_KI, AD_PARAM_CONTROL_KP, AD_PARAM_CONTROL_KI } },
+        { "Three-phase dq THD, harmonic grid", THREE_PHASE, CONTROL_PI, GRID_FAULT_HARMONICS, AD_METRIC_CURRENT_THD, 0.0,
+          2, { AD_PARAM_PLL_KP, AD_PARAM_PLL_KI } },
+    };
+    printf("Forward-mode AD of the closed loop, %.2f s at 20 kHz (SRF-PLL on)\n", duration);
+    for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+        const ADBenchCase *bc = &cases[c];
+        InverterParams params;
+        inverter_init(&params);
+        params.running = TRUE;
+        params.type = bc->type;
+        params.control = bc->control;
+        params.grid_condition = bc->grid;
+        params.pll_enabled = TRUE;
+        params.control_ref_current = 5.0;
+
+        double cost, reference, gradient[AD_MAX_PARAMETERS];
+        gint64 t0 = g_get_monotonic_time();
+        ad_cost(&params, bc->metric, duration, dt, bc->start, &reference);
+        gint64 t1 = g_get_monotonic_time();
+        ad_evaluate(&params, bc->metric, duration, dt, bc->start, bc->wrt, bc->n, &cost, gradient);
+        gint64 t2 = g_get_monotonic_time();
+        double fd[AD_MAX_PARAMETERS], x[AD_MAX_PARAMETERS];
+        for (int j = 0; j < bc->n; j++) {
+            InverterParams perturbed = params;
+            double *p = ad_parameter(&perturbed, bc->wrt[j]);
+            double h = 1e-6 * fabs(*p), up, down;
+            x[j] = *p;
+            *p = x[j] + h;
+            ad_cost(&perturbed, bc->metric, duration, dt, bc->start, &up);
+            *p = x[j] - h;
+            ad_cost(&perturbed, bc->metric, duration, dt, bc->start, &down);
+            fd[j] = (up - down) / (2 * h);
+        }
+        gint64 t3 = g_get_monotonic_time();
+
+        printf("\n%s\n", bc->name);
+        printf("  cost: AD %.6g, double model %.6g (relative difference %.1e)\n", cost, reference,
+               fabs(cost - reference) / fmax(fabs(reference), 1e-12));
+        printf("  %12s %14s %14s %10s\n", "parameter", "AD", "finite diff.", "rel. diff");
+        for (int j = 0; j < bc->n; j++) {
+            printf("  %12s %14.6e %14.6e %10.1e\n", ad_parameter_names[bc->wrt[j]], gradient[j], fd[j],
+                   ad_gradient_error(gradient[j], fd[j], reference, x[j]));
+        }
+        double run = (t1 - t0) * 1e-3;
+        printf("  time: single run %.1f ms, AD run %.1f ms (%.1fx), finite differences %.1f ms (%.1fx)\n", run,
+               (t2 - t1) * 1e-3, (t2 - t1) * 1e-3 / run, (t3 - t2) * 1e-3, (t3 - t2) * 1e-3 / run);
+    }
+    return 0;
+}
\ No newline at end of file
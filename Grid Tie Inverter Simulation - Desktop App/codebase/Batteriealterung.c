@@ -0,0 +1,287 @@
+#include "inverter.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Battery aging
+// Capacity fade is the sum of calendar and cycle aging. Calendar fade follows k * t^z with a stress k
+// from SoC and temperature (Arrhenius); when the stress changes, the fade continues from the equivalent
+// time at the new stress. Cycle fade comes from a streaming rainflow count of the SoC trajectory and a
+// Wöhler curve: a cycle of depth D uses D^beta / N100 of the cycle life. Resistance growth is
+// proportional to both fades. The aging model runs on a coarse step (one hour) over the samples of the
+// fast battery model and writes the fade and growth back into its parameters.
+
+typedef struct {
+    double k_calendar; // Calendar fade after one year at 25 °C and 50% SoC
+    double z; // Time exponent of calendar fade
+    double soc_stress; // Calendar stress factor exp(soc_stress * (SoC - 0.5))
+    double ea_calendar, ea_cycle; // Activation energies (J/mol)
+    double n_full; // Cycles to end of life at 100% depth and 25 °C
+    double beta; // Wöhler exponent of the cycle depth
+    double r_calendar, r_cycle; // Resistance growth per unit of calendar and cycle fade
+} BatteryAgingModel;
+
+static const BatteryAgingModel battery_aging_models[2] = {
+    { 0.025, 0.5, 1.5, 50000.0, 30000.0, 3500.0, 1.4, 2.0, 1.2 }, // Li-ion (NMC): SEI growth, high SoC ages faster
+    { 0.040, 0.8, -2.0, 40000.0, 20000.0, 600.0, 1.2, 1.5, 1.0 }, // Lead-acid: corrosion, sulfation at low SoC
+};
+
+static double battery_arrhenius(double ea, double temperature) {
+    return exp(-ea / 8.314 * (1.0 / (temperature + 273.15) - 1.0 / 298.15));
+}
+
+void rainflow_init(RainflowCounter *rf, double gate) {
+    memset(rf, 0, sizeof(*rf));
+    rf->gate = gate;
+}
+
+// Three-point rule on the reversal stack: a range X (newest pair) that reaches the range Y before it closes
+// Y as a full cycle, or as a half cycle when Y contains the oldest reversal. Every reversal is pushed and
+// removed once, so the cost per sample is O(1) amortised.
+static void rainflow_reversal(RainflowCounter *rf, double x, RainflowSink sink, gpointer data) {
+    if (rf->n == RAINFLOW_STACK) { // Residue full: count the oldest range as a half cycle
+        sink(fabs(rf->stack[1] - rf->stack[0]), 0.5 * (rf->stack[1] + rf->stack[0]), 0.5, data);
+        memmove(rf->stack, rf->stack + 1, (RAINFLOW_STACK - 1) * sizeof(double));
+        rf->n--;
+    }
+    rf->stack[rf->n++] = x;
+    while (rf->n >= 3) {
+        double *s = rf->stack + rf->n - 3;
+        double range_x = fabs(s[2] - s[1]), range_y = fabs(s[1] - s[0]);
+        if (range_x < range_y) break;
+        if (rf->n == 3) {
+            sink(range_y, 0.5 * (s[0] + s[1]), 0.5, data);
+            rf->stack[0] = s[1];
+            rf->stack[1] = s[2];
+            rf->n = 2;
+        } else {
+            sink(range_y, 0.5 * (s[0] + s[1]), 1.0, data);
+            s[0] = s[2];
+            rf->n -= 2;
+        }
+    }
+}
+
+void rainflow_push(RainflowCounter *rf, double x, RainflowSink sink, gpointer data) {
+    if (rf->n == 0) { // First sample starts the history
+        rf->stack[rf->n++] = x;
+        rf->candidate = x;
+        return;
+    }
+    if (rf->direction == 0) {
+        if (fabs(x - rf->stack[0]) >= rf->gate) {
+            rf->direction = x > rf->stack[0] ? 1 : -1;
+            rf->candidate = x;
+        }
+    } else if ((x - rf->candidate) * rf->direction >= 0.0) {
+        rf->candidate = x; // Still moving the same way
+    } else if (fabs(x - rf->candidate) >= rf->gate) {
+        rainflow_reversal(rf, rf->candidate, sink, data); // The running extreme was a reversal
+        rf->direction = -rf->direction;
+        rf->candidate = x;
+    }
+}
+
+// Ends the history: the last extreme becomes a reversal and the residue counts as half cycles
+void rainflow_flush(RainflowCounter *rf, RainflowSink sink, gpointer data) {
+    if (rf->direction != 0) rainflow_reversal(rf, rf->candidate, sink, data);
+    for (int i = 0; i + 1 < rf->n; i++) {
+        sink(fabs(rf->stack[i + 1] - rf->stack[i]), 0.5 * (rf->stack[i + 1] + rf->stack[i]), 0.5, data);
+    }
+    rainflow_init(rf, rf->gate);
+}
+
+void battery_aging_init(BatteryAging *aging, int type) {
+    memset(aging, 0, sizeof(*aging));
+    aging->type = type == 1 ? 1 : 0;
+    rainflow_init(&aging->rainflow, 0.005); // Swings below 0.5% SoC are noise
+    aging->temperature = 25.0;
+}
+
+static void battery_aging_cycle(double range, double mean, double count, gpointer data) {
+    BatteryAging *aging = (BatteryAging *)data;
+    const BatteryAgingModel *m = &battery_aging_models[aging->type];
+    aging->cycles += count;
+    aging->full_cycles += count * range;
+    aging->cycle_fade += count * BATTERY_END_OF_LIFE * pow(range, m->beta) / m->n_full *
+                         battery_arrhenius(m->ea_cycle, aging->temperature);
+}
+
+// Fast-rate input: one SoC sample of the battery model at its cell temperature, at the end of a step
+// of length dt. The means of the coarse step weight every sample by its step, so adaptive steps do not
+// bias them towards the fast transients.
+void battery_aging_sample(BatteryAging *aging, double soc, double temperature, double dt) {
+    aging->temperature = temperature;
+    rainflow_push(&aging->rainflow, soc, battery_aging_cycle, aging);
+    aging->soc_sum += soc * dt;
+    aging->temperature_sum += temperature * dt;
+    aging->elapsed += dt;
+}
+
+// Coarse step: calendar aging over dt at the time-weighted mean SoC and temperature of the samples, then the fade and
+// resistance growth of the fast model
+void battery_aging_update(BatteryAging *aging, BatteryState *battery, double dt) {
+    const BatteryAgingModel *m = &battery_aging_models[aging->type];
+    if (aging->elapsed > 0.0) {
+        double soc = aging->soc_sum / aging->elapsed;
+        double temperature = aging->temperature_sum / aging->elapsed;
+        double k = m->k_calendar * exp(m->soc_stress * (soc - 0.5)) * battery_arrhenius(m->ea_calendar, temperature);
+        double years = pow(aging->calendar_fade / k, 1.0 / m->z); // Equivalent age at the present stress
+        aging->calendar_fade = k * pow(years + dt / (3600.0 * 8760.0), m->z);
+    }
+    aging->soc_sum = aging->temperature_sum = 0.0;
+    aging->elapsed = 0.0;
+    battery->capacity_fade = fmin(aging->calendar_fade + aging->cycle_fade, 0.95);
+    battery->resistance_growth = m->r_calendar * aging->calendar_fade + m->r_cycle * aging->cycle_fade;
+}
+
+// Lifetime simulation
+// PV-coupled storage: the battery charges from the midday PV surplus (scaled by season and a daily
+// cloudiness draw, with minute-scale cloud noise), discharges in the evening (more in winter) and feeds a
+// small night load. The fast model steps at dt within each hour and feeds every SoC sample to the rainflow
+// counter; the hourly coarse step updates calendar aging and the fast model's parameters. A battery is
+// retired at end of life. Every chemistry and climate is one task on all cores.
+
+#define BATTERY_LIFE_MAX_YEARS 40
+
+static const struct {
+    const char *name;
+    double mean, seasonal, daily; // Cell temperature: mean, seasonal and daily amplitude (°C)
+} battery_life_climates[] = {
+    { "indoor", 20.0, 3.0, 1.0 },
+    { "outdoor", 22.0, 10.0, 4.0 },
+};
+#define BATTERY_LIFE_CLIMATES (int)(sizeof(battery_life_climates) / sizeof(battery_life_climates[0]))
+#define BATTERY_LIFE_TASKS (2 * BATTERY_LIFE_CLIMATES)
+
+typedef struct {
+    int years;
+    double dt; // Fast step (s)
+    double fade[BATTERY_LIFE_TASKS][BATTERY_LIFE_MAX_YEARS]; // Capacity fade at the end of each year, < 0 = retired
+    double growth[BATTERY_LIFE_TASKS]; // Resistance growth at the end of the run
+    double calendar[BATTERY_LIFE_TASKS], cycle[BATTERY_LIFE_TASKS]; // Fade shares at the end of the run
+    double end_of_life[BATTERY_LIFE_TASKS]; // Years to BATTERY_END_OF_LIFE fade, < 0 = not reached
+    double cycles[BATTERY_LIFE_TASKS], full_cycles[BATTERY_LIFE_TASKS];
+    double ns_step[BATTERY_LIFE_TASKS]; // Wall time per fast step, aging included (ns)
+} BatteryLifeWork;
+
+static double battery_life_random(guint32 *rng) {
+    *rng ^= *rng << 13;
+    *rng ^= *rng >> 17;
+    *rng ^= *rng << 5;
+    return (*rng >> 8) / 16777216.0; // 0 to 1
+}
+
+// Battery current in C-rate at an hour of the day, positive = discharge
+static double battery_life_current(double hour, double summer, double clear, guint32 *rng) {
+    if (hour >= 8.0 && hour < 16.0) {
+        double surplus = clear * (0.4 + 0.6 * summer) * sin(M_PI * (hour - 8.0) / 8.0);
+        return -0.12 * surplus + 0.03 * (1.0 - clear) * (battery_life_random(rng) * 2.0 - 1.0);
+    }
+    if (hour >= 17.0 && hour < 23.0) return 0.1 * (1.2 - 0.4 * summer);
+    return 0.01;
+}
+
+static void battery_life_task(int n, gpointer data) {
+    BatteryLifeWork *work = (BatteryLifeWork *)data;
+    int type = n / BATTERY_LIFE_CLIMATES, climate = n % BATTERY_LIFE_CLIMATES;
+    InverterParams p;
+    inverter_init(&p);
+    p.battery_type = type;
+    BatteryAging aging;
+    battery_aging_init(&aging, type);
+    guint32 rng = 0xB477E21u;
+    int per_hour = (int)lround(3600.0 / work->dt);
+    long hours = (long)work->years * 8760;
+    double clear = 1.0, summer = 0.0;
+    work->end_of_life[n] = -1.0;
+    for (int y = 0; y < work->years; y++) work->fade[n][y] = -1.0;
+    long steps = 0;
+
+    gint64 start = g_get_monotonic_time();
+    for (long h = 0; h < hours; h++) {
+        long day = h / 24;
+        int hour = (int)(h % 24);
+        if (hour == 0) {
+            summer = 0.5 - 0.5 * cos(2.0 * M_PI * (day % 365 - 172 + 182.5) / 365.0); // 1 at the June solstice
+            clear = 0.2 + 0.8 * battery_life_random(&rng);
+        }
+        p.battery_temperature = battery_life_climates[climate].mean +
+                                battery_life_climates[climate].seasonal * (2.0 * summer - 1.0) +
+                                battery_life_climates[climate].daily * sin(2.0 * M_PI * (hour - 9) / 24.0);
+        for (int k = 0; k < per_hour; k++) {
+            double c_rate = battery_life_current(hour + (k + 0.5) / per_hour, summer, clear, &rng);
+            battery_update(&p, c_rate * p.battery_capacity, work->dt);
+            battery_aging_sample(&aging, p.battery_soc, p.battery_temperature, work->dt);
+        }
+        steps += per_hour;
+        battery_aging_update(&aging, &p.battery, 3600.0);
+        if ((h + 1) % 8760 == 0) work->fade[n][h / 8760] = p.battery.capacity_fade;
+        if (p.battery.capacity_fade >= BATTERY_END_OF_LIFE) {
+            work->end_of_life[n] = (h + 1) / 8760.0;
+            break;
+        }
+    }
+    rainflow_flush(&aging.rainflow, battery_aging_cycle, &aging);
+    work->ns_step[n] = (g_get_monotonic_time() - start) * 1e3 / steps;
+    work->growth[n] = p.battery.resistance_growth;
+    work->calendar[n] = aging.calendar_fade;
+    work->cycle[n] = aging.cycle_fade;
+    work->cycles[n] = aging.cycles;
+    work->full_cycles[n] = aging.full_cycles;
+}
+
+// Headless mode: --battery-life [years] [fast step in s]
+int battery_life_main(int argc, char *argv[]) {
+    BatteryLifeWork *work = g_new0(BatteryLifeWork, 1);
+    work->years = argc > 2 ? atoi(argv[2]) : 20;
+    work->dt = argc > 3 ? atof(argv[3]) : 60.0;
+    if (work->years < 1 || work->years > BATTERY_LIFE_MAX_YEARS) {
+        fprintf(stderr, "[Error] Battery life: years must be 1 to %d\n", BATTERY_LIFE_MAX_YEARS);
+        g_free(work);
+        return 1;
+    }
+    if (work->dt <= 0.0 || fabs(3600.0 / work->dt - round(3600.0 / work->dt)) > 1e-9) {
+        fprintf(stderr, "[Error] Battery life: the fast step must divide one hour\n");
+        g_free(work);
+        return 1;
+    }
+
+    int n_threads = (int)g_get_num_processors();
+    if (n_threads > BATTERY_LIFE_TASKS) n_threads = BATTERY_LIFE_TASKS;
+    printf("Battery lifetime: %d years of PV-coupled storage, 100 Ah, fast step %g s, hourly aging step, %d threads\n",
+           work->years, work->dt, n_threads);
+    gint64 start = g_get_monotonic_time();
+    parallel_for(BATTERY_LIFE_TASKS, battery_life_task, work);
+    double wall = (g_get_monotonic_time() - start) * 1e-6;
+
+    static const char *chemistries[2] = { "Li-ion", "Lead-acid" };
+    int marks[4] = { work->years / 4, work->years / 2, 3 * work->years / 4, work->years };
+    printf("\n%-10s %-8s", "chemistry", "climate");
+    for (int i = 0; i < 4; i++) {
+        if (marks[i] > 0) printf("   cap. %2dy", marks[i]);
+    }
+    printf(" %9s %9s %9s %8s %9s %9s %9s\n", "R growth", "calendar", "cycling", "EOL (y)", "cycles", "EFC",
+           "ns/step");
+    for (int n = 0; n < BATTERY_LIFE_TASKS; n++) {
+        printf("%-10s %-8s", chemistries[n / BATTERY_LIFE_CLIMATES], battery_life_climates[n % BATTERY_LIFE_CLIMATES].name);
+        for (int i = 0; i < 4; i++) {
+            if (marks[i] <= 0) continue;
+            if (work->fade[n][marks[i] - 1] < 0.0) printf(" %10s", "retired");
+            else printf(" %9.1f%%", (1.0 - work->fade[n][marks[i] - 1]) * 100);
+        }
+        char eol[16] = "-";
+        if (work->end_of_life[n] >= 0.0) snprintf(eol, sizeof(eol), "%.1f", work->end_of_life[n]);
+        printf(" %8.0f%% %8.1f%% %8.1f%% %8s %9.0f %9.0f %9.1f\n", work->growth[n] * 100,
+               work->calendar[n] * 100, work->cycle[n] * 100, eol, work->cycles[n], work->full_cycles[n],
+               work->ns_step[n]);
+    }
+
+    // What the same lifetime costs at the interactive simulation's largest step
+    double ns = 0.0;
+    for (int n = 0; n < BATTERY_LIFE_TASKS; n++) ns += work->ns_step[n] / BATTERY_LIFE_TASKS;
+    printf("\nWall %.2f s for %d lifetimes; one lifetime at 10 ms steps would take about %.1f h at the same cost per step\n",
+           wall, BATTERY_LIFE_TASKS, work->years * 8760.0 * 3600.0 / 0.010 * ns * 1e-9 / 3600.0);
+    g_free(work);
+    return 0;
+}
\ No newline at end of file
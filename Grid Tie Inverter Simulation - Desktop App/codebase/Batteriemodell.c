@@ -0,0 +1,228 @@
+#include "inverter.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Battery equivalent circuit
+// Two-RC Thevenin model per cell: open-circuit voltage OCV(SoC, T), series resistance R0 and two RC
+// branches (fast charge transfer, slow diffusion), scaled to the pack by the series cell count and the
+// capacity. Resistances are tabulated per unit capacity (Ω·Ah) over SoC at 25 °C and scaled by a
+// temperature factor; the OCV carries an entropic coefficient. With the current held over a step the RC
+// branches have the exact solution v' = d * v + R * (1 - d) * I, d = exp(-dt / tau), so the step size only
+// changes the sampling, not the result. The decay factors are cached for the last step size. Aging
+// (Batteriealterung.c) shrinks the capacity and scales the resistances through capacity_fade and
+// resistance_growth.
+
+typedef struct {
+    int cells; // Cells in series per pack
+    double ocv[BATTERY_SOC_POINTS]; // Cell open-circuit voltage at 25 °C (V)
+    double docv_dt[BATTERY_SOC_POINTS]; // Entropic coefficient dOCV/dT (mV/K)
+    double r0[BATTERY_SOC_POINTS]; // Series resistance at 25 °C (Ω·Ah)
+    double r1[BATTERY_SOC_POINTS]; // Fast RC branch resistance at 25 °C (Ω·Ah)
+    double r2[BATTERY_SOC_POINTS]; // Slow RC branch resistance at 25 °C (Ω·Ah)
+    double r_temp[BATTERY_TEMP_POINTS]; // Resistance factor over temperature (1 at 25 °C)
+    double tau1, tau2; // RC time constants (s)
+    double eta_charge, eta_discharge; // Coulombic efficiencies
+} BatteryChemistry;
+
+static const double battery_temps[BATTERY_TEMP_POINTS] = { -10.0, 0.0, 10.0, 25.0, 40.0 };
+
+static const BatteryChemistry battery_chemistries[2] = {
+    { // Li-ion (NMC), 13 cells: 48 V nominal
+        13,
+        { 3.00, 3.45, 3.55, 3.62, 3.67, 3.72, 3.79, 3.87, 3.95, 4.05, 4.18 },
+        { -0.40, -0.30, -0.20, -0.10, 0.00, 0.05, 0.05, 0.00, -0.05, -0.10, -0.10 },
+        { 0.120, 0.085, 0.072, 0.066, 0.063, 0.061, 0.060, 0.060, 0.061, 0.063, 0.066 },
+        { 0.060, 0.040, 0.035, 0.032, 0.030, 0.030, 0.030, 0.030, 0.031, 0.032, 0.035 },
+        { 0.080, 0.050, 0.040, 0.036, 0.034, 0.033, 0.033, 0.034, 0.035, 0.037, 0.040 },
+        { 4.0, 2.4, 1.6, 1.0, 0.8 },
+        10.0, 400.0,
+        0.95, 0.98,
+    },
+    { // Lead-acid, 6 cells: 12 V nominal
+        6,
+        { 1.93, 1.95, 1.97, 1.99, 2.01, 2.03, 2.05, 2.07, 2.09, 2.11, 2.13 },
+        { 0.20, 0.20, 0.20, 0.20, 0.20, 0.20, 0.20, 0.20, 0.20, 0.20, 0.20 },
+        { 0.200, 0.140, 0.110, 0.095, 0.088, 0.084, 0.082, 0.080, 0.080, 0.082, 0.086 },
+        { 0.100, 0.070, 0.060, 0.052, 0.048, 0.046, 0.045, 0.045, 0.046, 0.048, 0.052 },
+        { 0.160, 0.110, 0.090, 0.080, 0.074, 0.070, 0.068, 0.068, 0.070, 0.074, 0.080 },
+        { 2.5, 1.8, 1.35, 1.0, 0.85 },
+        20.0, 900.0,
+        0.95 * 0.9, 0.98 * 0.9,
+    },
+};
+
+// Per-cell table values at a state of charge and temperature: OCV (V) and R0, R1, R2 (Ω·Ah)
+static void battery_lookup(const BatteryChemistry *chem, double soc, double temperature, double *ocv, double *r) {
+    double x = fmin(fmax(soc, 0.0), 1.0) * (BATTERY_SOC_POINTS - 1);
+    int k = (int)x;
+    if (k > BATTERY_SOC_POINTS - 2) k = BATTERY_SOC_POINTS - 2;
+    double u = x - k;
+
+    int j = 0;
+    while (j < BATTERY_TEMP_POINTS - 2 && temperature > battery_temps[j + 1]) j++;
+    double w = (temperature - battery_temps[j]) / (battery_temps[j + 1] - battery_temps[j]);
+    w = fmin(fmax(w, 0.0), 1.0); // Held at the ends of the table
+    double factor = chem->r_temp[j] + w * (chem->r_temp[j + 1] - chem->r_temp[j]);
+
+    *ocv = chem->ocv[k] + u * (chem->ocv[k + 1] - chem->ocv[k]) +
+           (chem->docv_dt[k] + u * (chem->docv_dt[k + 1] - chem->docv_dt[k])) * 1e-3 * (temperature - 25.0);
+    r[0] = factor * (chem->r0[k] + u * (chem->r0[k + 1] - chem->r0[k]));
+    r[1] = factor * (chem->r1[k] + u * (chem->r1[k + 1] - chem->r1[k]));
+    r[2] = factor * (chem->r2[k] + u * (chem->r2[k + 1] - chem->r2[k]));
+}
+
+void battery_reset(InverterParams *params) {
+    memset(&params->battery, 0, sizeof(params->battery));
+    params->battery.cache_dt = -1.0;
+}
+
+// Coulombic efficiencies of a chemistry (0 = Li-ion, 1 = Lead-acid)
+void battery_efficiency(int type, double *eta_charge, double *eta_discharge) {
+    const BatteryChemistry *chem = &battery_chemistries[type == 1 ? 1 : 0];
+    *eta_charge = chem->eta_charge;
+    *eta_discharge = chem->eta_discharge;
+}
+
+// Advances the battery by dt at a constant current (positive = discharge) and returns the terminal voltage.
+// The BMS stops discharging at BATTERY_SOC_MIN and charging at BATTERY_SOC_MAX; dt = 0 only re-evaluates.
+double battery_update(InverterParams *params, double current, double dt) {
+    BatteryState *s = &params->battery;
+    int type = params->battery_type == 1 ? 1 : 0;
+    const BatteryChemistry *chem = &battery_chemistries[type];
+    if (dt != s->cache_dt || type != s->cache_type) {
+        s->decay1 = exp(-dt / chem->tau1);
+        s->decay2 = exp(-dt / chem->tau2);
+        s->cache_dt = dt;
+        s->cache_type = type;
+    }
+
+    if ((current > 0.0 && params->battery_soc <= BATTERY_SOC_MIN) ||
+        (current < 0.0 && params->battery_soc >= BATTERY_SOC_MAX)) {
+        current = 0.0;
+    }
+    // Coulomb counting: charge is stored with eta_charge, discharge draws 1 / eta_discharge
+    double eta = current < 0.0 ? chem->eta_charge : 1.0 / chem->eta_discharge;
+    double capacity = params->battery_capacity * (1.0 - s->capacity_fade); // Aged capacity (Ah)
+    double dsoc = -current * eta * dt / (3600.0 * capacity);
+    double ocv, r[3];
+    double scale = chem->cells * (1.0 + s->resistance_growth) / params->battery_capacity; // Ω·Ah per cell to Ω per pack
+    // RC resistances at the mid-step SoC keep the update second order in the SoC drift over the step
+    battery_lookup(chem, params->battery_soc + 0.5 * dsoc, params->battery_temperature, &ocv, r);
+    s->v1 = s->decay1 * s->v1 + scale * r[1] * (1.0 - s->decay1) * current;
+    s->v2 = s->decay2 * s->v2 + scale * r[2] * (1.0 - s->decay2) * current;
+    params->battery_soc = fmin(fmax(params->battery_soc + dsoc, BATTERY_SOC_MIN), BATTERY_SOC_MAX);
+
+    battery_lookup(chem, params->battery_soc, params->battery_temperature, &ocv, r);
+    s->current = current;
+    s->ocv = chem->cells * ocv;
+    s->r0 = scale * r[0];
+    return s->ocv - s->r0 * current - s->v1 - s->v2;
+}
+
+// Battery cycling benchmark
+// Four-hour cycles: 90 min discharge at 0.3 C with a 1 C pulse of one minute every 15 minutes, a 0.5 C
+// charge that returns the discharged charge through both efficiencies (whole minutes), then rest, so
+// the SoC stays inside the BMS limits. The current changes only on whole minutes, so every step size
+// below holds it exactly. The exact model at 0.1 s is the reference; forward Euler on the same tables
+// shows what the exact RC update buys at large steps.
+
+#define BATTERY_BENCH_SAMPLE 60.0 // Comparison grid (s)
+
+static double battery_bench_current(const BatteryChemistry *chem, double t, double capacity) {
+    double discharge = (90.0 * 0.3 + 6.0 * 0.7) / 60.0; // C·h drawn per cycle
+    double charge_min = round(discharge / (chem->eta_charge * chem->eta_discharge) / 0.5 * 60.0);
+    double u = fmod(t, 4.0 * 3600.0) / 60.0; // Minute of the cycle
+    if (u < 90.0) return (fmod(u, 15.0) >= 14.0 ? 1.0 : 0.3) * capacity;
+    if (u < 90.0 + charge_min) return -0.5 * capacity;
+    return 0.0;
+}
+
+// Forward Euler on the same model: v' = v + dt / tau * (R * I - v)
+static double battery_bench_euler(InverterParams *params, double current, double dt) {
+    const BatteryChemistry *chem = &battery_chemistries[params->battery_type == 1 ? 1 : 0];
+    BatteryState *s = &params->battery;
+    if ((current > 0.0 && params->battery_soc <= BATTERY_SOC_MIN) ||
+        (current < 0.0 && params->battery_soc >= BATTERY_SOC_MAX)) {
+        current = 0.0;
+    }
+    double ocv, r[3];
+    double scale = chem->cells / params->battery_capacity;
+    battery_lookup(chem, params->battery_soc, params->battery_temperature, &ocv, r);
+    s->v1 += dt / chem->tau1 * (scale * r[1] * current - s->v1);
+    s->v2 += dt / chem->tau2 * (scale * r[2] * current - s->v2);
+    double eta = current < 0.0 ? chem->eta_charge : 1.0 / chem->eta_discharge;
+    params->battery_soc -= current * eta * dt / (3600.0 * params->battery_capacity);
+    params->battery_soc = fmin(fmax(params->battery_soc, BATTERY_SOC_MIN), BATTERY_SOC_MAX);
+    battery_lookup(chem, params->battery_soc, params->battery_temperature, &ocv, r);
+    return chem->cells * ocv - scale * r[0] * current - s->v1 - s->v2;
+}
+
+// Runs the cycles at one step size and records terminal voltage and SoC on the comparison grid
+static double battery_bench_run(int type, double temperature, double hours, double dt, gboolean exact, double *v,
+                                double *soc) {
+    InverterParams p;
+    inverter_init(&p);
+    p.battery_type = type;
+    p.battery_temperature = temperature;
+    p.battery_soc = 0.85;
+    long steps = lround(hours * 3600.0 / dt);
+    long per_sample = lround(BATTERY_BENCH_SAMPLE / dt);
+    gint64 start = g_get_monotonic_time();
+    for (long k = 0; k < steps; k++) {
+        double current = battery_bench_current(&battery_chemistries[type], k * dt, p.battery_capacity);
+        double voltage = exact ? battery_update(&p, current, dt) : battery_bench_euler(&p, current, dt);
+        if ((k + 1) % per_sample == 0) {
+            v[(k + 1) / per_sample - 1] = voltage;
+            soc[(k + 1) / per_sample - 1] = p.battery_soc;
+        }
+    }
+    return (g_get_monotonic_time() - start) * 1e3 / steps;
+}
+
+// Headless mode: --battery-bench [hours] [temperature]
+int battery_bench_main(int argc, char *argv[]) {
+    double hours = argc > 2 ? atof(argv[2]) : 24.0;
+    double temperature = argc > 3 ? atof(argv[3]) : 25.0;
+    if (hours < 3.0 || hours > 1000.0) {
+        fprintf(stderr, "[Error] Battery bench: hours must be 3 to 1000\n");
+        return 1;
+    }
+    static const double steps[] = { 1.0, 10.0, 60.0 };
+    static const char *names[2] = { "Li-ion 48 V", "Lead-acid 12 V" };
+    int samples = (int)lround(hours * 3600.0 / BATTERY_BENCH_SAMPLE);
+    double *v_ref = g_new(double, samples), *soc_ref = g_new(double, samples);
+    double *v = g_new(double, samples), *soc = g_new(double, samples);
+
+    printf("Battery benchmark: %.0f h of 4 h charge/discharge cycles at %.0f °C, 100 Ah, reference: exact at 0.1 s\n",
+           hours, temperature);
+    for (int type = 0; type < 2; type++) {
+        double ref_ns = battery_bench_run(type, temperature, hours, 0.1, TRUE, v_ref, soc_ref);
+        double v_min = INFINITY, v_max = -INFINITY;
+        for (int i = 0; i < samples; i++) {
+            v_min = fmin(v_min, v_ref[i]);
+            v_max = fmax(v_max, v_ref[i]);
+        }
+        printf("\n%s: terminal voltage %.2f to %.2f V, SoC at end %.1f%%, %.1f ns/step at 0.1 s\n", names[type], v_min,
+               v_max, soc_ref[samples - 1] * 100, ref_ns);
+        printf("%-7s %7s %14s %14s %12s %16s\n", "method", "dt (s)", "max dV (mV)", "max dSoC (%)", "ns/step",
+               "sim h per ms");
+        for (int m = 0; m < 2; m++) {
+            for (int i = 0; i < (int)(sizeof(steps) / sizeof(steps[0])); i++) {
+                double ns = battery_bench_run(type, temperature, hours, steps[i], m == 0, v, soc);
+                double dv = 0.0, dsoc = 0.0;
+                for (int j = 0; j < samples; j++) {
+                    dv = fmax(dv, fabs(v[j] - v_ref[j]));
+                    dsoc = fmax(dsoc, fabs(soc[j] - soc_ref[j]));
+                }
+                printf("%-7s %7.0f %14.3g %14.3g %12.1f %16.1f\n", m == 0 ? "exact" : "Euler", steps[i],
+                       isfinite(dv) ? dv * 1e3 : INFINITY, dsoc * 100, ns, steps[i] / 3600.0 / (ns * 1e-6));
+            }
+        }
+    }
+    g_free(v_ref);
+    g_free(soc_ref);
+    g_free(v);
+    g_free(soc);
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,246 @@
+#include "inverter.h"
+#include <math.h>
+#include <string.h>
+
+// Discrete controller library
+// Every controller is a second-order section designed from its continuous prototype
+// H(s) = (b2*s^2 + b1*s + b0) / (a2*s^2 + a1*s + a0). Discrete coefficients are
+// computed once per sample time and reused until dt or the prototype changes; the
+// update itself is a branch-free transposed direct form II.
+
+void biquad_design(Biquad *bq, const double num[3], const double den[3], DiscretizationMethod method, double prewarp) {
+    if (bq->method == method && bq->prewarp == prewarp &&
+        memcmp(bq->num, num, sizeof(bq->num)) == 0 && memcmp(bq->den, den, sizeof(bq->den)) == 0) {
+        return; // Same prototype: keep cached coefficients and state
+    }
+    memcpy(bq->num, num, sizeof(bq->num));
+    memcpy(bq->den, den, sizeof(bq->den));
+    bq->method = method;
+    bq->prewarp = prewarp;
+    bq->dt = 0.0; // Invalidate cached coefficients
+}
+
+void biquad_reset(Biquad *bq) {
+    bq->s1 = 0.0;
+    bq->s2 = 0.0;
+}
+
+// Matrix exponential of a 3x3 matrix (scaling and squaring with a Taylor series)
+static void expm3(const double m[3][3], double out[3][3]) {
+    double norm = 0.0;
+    for (int i = 0; i < 3; i++) {
+        double row = fabs(m[i][0]) + fabs(m[i][1]) + fabs(m[i][2]);
+        if (row > norm) norm = row;
+    }
+    int squarings = norm > 0.5 ? (int)ceil(log2(norm / 0.5)) : 0;
+    double scale = ldexp(1.0, -squarings);
+    double a[3][3], term[3][3], next[3][3];
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) {
+            a[i][j] = m[i][j] * scale;
+            out[i][j] = (i == j) ? 1.0 : 0.0;
+            term[i][j] = out[i][j];
+        }
+    }
+    for (int k = 1; k <= 12; k++) {
+        for (int i = 0; i < 3; i++) {
+            for (int j = 0; j < 3; j++) {
+                next[i][j] = (term[i][0] * a[0][j] + term[i][1] * a[1][j] + term[i][2] * a[2][j]) / k;
+            }
+        }
+        for (int i = 0; i < 3; i++) {
+            for (int j = 0; j < 3; j++) {
+                term[i][j] = next[i][j];
+                out[i][j] += term[i][j];
+            }
+        }
+    }
+    for (int s = 0; s < squarings; s++) {
+        for (int i = 0; i < 3; i++) {
+            for (int j = 0; j < 3; j++) {
+                next[i][j] = out[i][0] * out[0][j] + out[i][1] * out[1][j] + out[i][2] * out[2][j];
+            }
+        }
+        memcpy(out, next, sizeof(next));
+    }
+}
+
+// Tustin / forward Euler: substitute s = K * (z - 1) / (z + 1) or s = (z - 1) / dt
+static void discretize_bilinear(const Biquad *bq, double dt, double z_num[3], double z_den[3]) {
+    const double *b = bq->num;
+    const double *a = bq->den;
+    gboolean second_order = (a[2] != 0.0 || b[2] != 0.0);
+    if (bq->method == DISCRETIZE_TUSTIN) {
+        double k = 2.0 / dt;
+        if (bq->prewarp > 0.0) {
+            k = bq->prewarp / tan(bq->prewarp * dt / 2.0); // Exact match at the pre-warp frequency
+        }
+        if (second_order) {
+            // Multiply through by (z + 1)^2; coefficients of z^2, z^1, z^0
+            z_num[0] = b[2] * k * k + b[1] * k + b[0];
+            z_num[1] = 2.0 * (b[0] - b[2] * k * k);
+            z_num[2] = b[2] * k * k - b[1] * k + b[0];
+            z_den[0] = a[2] * k * k + a[1] * k + a[0];
+            z_den[1] = 2.0 * (a[0] - a[2] * k * k);
+            z_den[2] = a[2] * k * k - a[1] * k + a[0];
+        } else {
+            // First order: multiply by (z + 1) only, avoiding a cancelled pole at z = -1
+            z_num[0] = b[1] * k + b[0];
+            z_num[1] = b[0] - b[1] * k;
+            z_num[2] = 0.0;
+            z_den[0] = a[1] * k + a[0];
+            z_den[1] = a[0] - a[1] * k;
+            z_den[2] = 0.0;
+        }
+    } else {
+        if (second_order) {
+            // Multiply through by dt^2
+            z_num[0] = b[2];
+            z_num[1] = b[1] * dt - 2.0 * b[2];
+            z_num[2] = b[2] - b[1] * dt + b[0] * dt * dt;
+            z_den[0] = a[2];
+            z_den[1] = a[1] * dt - 2.0 * a[2];
+            z_den[2] = a[2] - a[1] * dt + a[0] * dt * dt;
+        } else {
+            z_num[0] = b[1];
+            z_num[1] = b[0] * dt - b[1];
+            z_num[2] = 0.0;
+            z_den[0] = a[1];
+            z_den[1] = a[0] * dt - a[1];
+            z_den[2] = 0.0;
+        }
+    }
+}
+
+// Zero-order hold: exact step-invariant discretisation via the state-space form
+static void discretize_zoh(const Biquad *bq, double dt, double z_num[3], double z_den[3]) {
+    const double *b = bq->num;
+    const double *a = bq->den;
+    if (a[2] != 0.0) {
+        // H = d + (c1*s + c0) / (s^2 + a1*s + a0) in controllable canonical form
+        double a1 = a[1] / a[2], a0 = a[0] / a[2];
+        double d = b[2] / a[2];
+        double c1 = b[1] / a[2] - d * a1;
+        double c0 = b[0] / a[2] - d * a0;
+        double m[3][3] = { { 0.0, dt, 0.0 }, { -a0 * dt, -a1 * dt, dt }, { 0.0, 0.0, 0.0 } };
+        double e[3][3];
+        expm3(m, e); // [[Phi, Gamma], [0, 1]]
+        double p = e[0][0], q = e[0][1], r = e[1][0], s = e[1][1];
+        double g0 = e[0][2], g1 = e[1][2];
+        z_den[0] = 1.0;
+        z_den[1] = -(p + s);
+        z_den[2] = p * s - q * r;
+        z_num[0] = d;
+        z_num[1] = d * z_den[1] + c0 * g0 + c1 * g1;
+        z_num[2] = d * z_den[2] + c0 * (q * g1 - s * g0) + c1 * (r * g0 - p * g1);
+    } else {
+        // H = d + c0 / (s + a0)
+        double a0 = a[0] / a[1];
+        double d = b[1] / a[1];
+        double c0 = b[0] / a[1] - d * a0;
+        double phi = exp(-a0 * dt);
+        double gamma = (a0 != 0.0) ? (1.0 - phi) / a0 : dt;
+        z_den[0] = 1.0;
+        z_den[1] = -phi;
+        z_den[2] = 0.0;
+        z_num[0] = d;
+        z_num[1] = c0 * gamma - d * phi;
+        z_num[2] = 0.0;
+    }
+}
+
+void biquad_set_rate(Biquad *bq, double dt) {
+    if (dt == bq->dt || dt <= 0.0) {
+        return; // Coefficients already computed for this sample time
+    }
+    double z_num[3], z_den[3];
+    if (bq->den[1] == 0.0 && bq->den[2] == 0.0) {
+        // Static gain b0 / a0: nothing to discretise, and every method would divide by a zero leading term
+        z_num[0] = bq->num[0] / bq->den[0];
+        z_num[1] = z_num[2] = 0.0;
+        z_den[0] = 1.0;
+        z_den[1] = z_den[2] = 0.0;
+    } else if (bq->method == DISCRETIZE_ZOH) {
+        discretize_zoh(bq, dt, z_num, z_den);
+    } else {
+        discretize_bilinear(bq, dt, z_num, z_den);
+    }
+    double norm = 1.0 / z_den[0];
+    bq->b0 = z_num[0] * norm;
+    bq->b1 = z_num[1] * norm;
+    bq->b2 = z_num[2] * norm;
+    bq->a1 = z_den[1] * norm;
+    bq->a2 = z_den[2] * norm;
+    bq->dt = dt;
+    bq->version = bq->version + 1 != 0 ? bq->version + 1 : 1; // Fixed-point copies requantise on the next sample
+}
+
+double biquad_update(Biquad *bq, double x) {
+    double y = bq->b0 * x + bq->s1;
+    bq->s1 = bq->b1 * x - bq->a1 * y + bq->s2;
+    bq->s2 = bq->b2 * x - bq->a2 * y;
+    return y;
+}
+
+double biquad_cascade_update(Biquad *sections, int n, double x) {
+    for (int i = 0; i < n; i++) {
+        x = biquad_update(&sections[i], x);
+    }
+    return x;
+}
+
+// Standard controller prototypes
+
+void biquad_pi(Biquad *bq, double kp, double ki, DiscretizationMethod method) {
+    // (kp*s + ki) / s
+    const double num[3] = { ki, kp, 0.0 };
+    const double den[3] = { 0.0, 1.0, 0.0 };
+    biquad_design(bq, num, den, method, 0.0);
+}
+
+void biquad_resonant(Biquad *bq, double kr, double w0, double wc, DiscretizationMethod method) {
+    // 2*kr*wc*s / (s^2 + 2*wc*s + w0^2), pre-warped so the peak stays at w0
+    const double num[3] = { 0.0, 2.0 * kr * wc, 0.0 };
+    const double den[3] = { w0 * w0, 2.0 * wc, 1.0 };
+    biquad_design(bq, num, den, method, method == DISCRETIZE_TUSTIN ? w0 : 0.0);
+}
+
+void biquad_lead_lag(Biquad *bq, double k, double wz, double wp, DiscretizationMethod method) {
+    // k * (s/wz + 1) / (s/wp + 1)
+    const double num[3] = { k, k / wz, 0.0 };
+    const double den[3] = { 1.0, 1.0 / wp, 0.0 };
+    biquad_design(bq, num, den, method, 0.0);
+}
+
+// Batched sections: one lane per instance, structure-of-arrays layout
+
+void biquad_bank_load(BiquadBank *bank, int lane, const Biquad *bq) {
+    bank->b0[lane] = bq->b0;
+    bank->b1[lane] = bq->b1;
+    bank->b2[lane] = bq->b2;
+    bank->a1[lane] = bq->a1;
+    bank->a2[lane] = bq->a2;
+    if (lane >= bank->n) bank->n = lane + 1;
+}
+
+void biquad_bank_update(BiquadBank *bank, const double *in, double *out) {
+    for (int i = 0; i < bank->n; i++) {
+        double x = in[i];
+        double y = bank->b0[i] * x + bank->s1[i];
+        bank->s1[i] = bank->b1[i] * x - bank->a1[i] * y + bank->s2[i];
+        bank->s2[i] = bank->b2[i] * x - bank->a2[i] * y;
+        out[i] = y;
+    }
+}
+
+// All lanes driven by the same input, outputs summed (parallel sections of one controller)
+double biquad_bank_sum(BiquadBank *bank, double x) {
+    double sum = 0.0;
+    for (int i = 0; i < bank->n; i++) {
+        double y = bank->b0[i] * x + bank->s1[i];
+        bank->s1[i] = bank->b1[i] * x - bank->a1[i] * y + bank->s2[i];
+        bank->s2[i] = bank->b2[i] * x - bank->a2[i] * y;
+        sum += y;
+    }
+    return sum;
+}
\ No newline at end of file
@@ -0,0 +1,358 @@
+#include "inverter.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Fixed-point emulation of the controller firmware
+// Samples are Q15 fractions of a full scale (FIXED_*_FS), coefficients Q31 with a few
+// integer bits (Q(31 - shift)), products and section state are kept in 64 bits and every
+// section output is rounded and saturated back to Q15, as on the target. The feedback uses
+// the unrounded output: the rounding residue goes back through a1 and a2 (error feedback),
+// without which the Q15 rounding noise is amplified by the Q of the resonant sections. The controllers
+// still design their coefficients in double precision (DiskreteRegler.c); they are
+// quantised here whenever the floating-point design changes. All arithmetic below is
+// integer, so results are bit-identical on every host, and the batched kernel processes
+// lanes in plain structure-of-arrays loops the compiler can vectorise.
+
+#define Q15_MAX 32767
+#define Q15_MIN (-32768)
+
+static gint16 q15_saturate(gint64 x) {
+    return (gint16)(x > Q15_MAX ? Q15_MAX : x < Q15_MIN ? Q15_MIN : x);
+}
+
+// Round half away from zero with saturation (no libm call on the sample path)
+gint16 q15_from_double(double x, double full_scale) {
+    double v = x * (32768.0 / full_scale);
+    if (v >= Q15_MAX) return Q15_MAX;
+    if (v <= Q15_MIN) return Q15_MIN;
+    return (gint16)(v + (v >= 0.0 ? 0.5 : -0.5));
+}
+
+double q15_to_double(gint16 x, double full_scale) {
+    return x * (full_scale / 32768.0);
+}
+
+gint16 q15_sub_sat(gint16 a, gint16 b) {
+    return q15_saturate((gint32)a - b);
+}
+
+// Sine of a 32-bit phase (2^32 = one turn), fifth-order polynomial on the folded quarter
+// wave: sin(z*pi/2) = z*(pi/2 - z^2*((2*pi - 5)/2 - z^2*(pi - 3)/2)), error below 4e-4
+static gint16 q15_sin(guint32 angle) {
+    gint64 a = (gint32)angle; // -pi .. pi as -2^31 .. 2^31
+    if (a > (1 << 30)) a = ((gint64)1 << 31) - a; // Fold onto -pi/2 .. pi/2
+    if (a < -(1 << 30)) a = -((gint64)1 << 31) - a;
+    gint32 z = (gint32)(a >> 15); // Q15, -1 .. 1 over the quarter wave
+    gint32 z2 = (z * z) >> 15;
+    gint32 t = 21024 - ((2320 * z2) >> 15); // (2*pi - 5)/2 and (pi - 3)/2 in Q15
+    t = 51472 - ((t * z2) >> 15); // pi/2 in Q15
+    return q15_saturate(((gint64)z * t) >> 15);
+}
+
+void q15_sin_cos(guint32 angle, gint16 *s, gint16 *c) {
+    *s = q15_sin(angle);
+    *c = q15_sin(angle + (1u << 30));
+}
+
+// Integer square root (bitwise, exact floor)
+guint32 q_isqrt(guint64 x) {
+    guint64 root = 0, bit = (guint64)1 << 62;
+    while (bit > x) bit >>= 2;
+    while (bit != 0) {
+        if (x >= root + bit) {
+            x -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return (guint32)root;
+}
+
+// Integer bits needed so that every coefficient fits Q(31 - shift)
+static int coefficient_shift(const double *c, int n) {
+    double m = 0.0;
+    for (int i = 0; i < n; i++) {
+        m = fmax(m, fabs(c[i]));
+    }
+    int shift = 0;
+    while (shift < 16 && m >= ldexp(1.0, shift) * (1.0 - ldexp(1.0, -31))) shift++;
+    return shift;
+}
+
+static gint32 q31_coefficient(double c, int shift) {
+    double v = round(ldexp(c, 31 - shift));
+    return (gint32)(v > 2147483647.0 ? 2147483647.0 : v < -2147483648.0 ? -2147483648.0 : v);
+}
+
+// Keep the state value when the coefficient format changes
+static gint64 rescale_state(gint64 s, int from_shift, int to_shift) {
+    return to_shift >= from_shift ? s >> (to_shift - from_shift) : s * ((gint64)1 << (from_shift - to_shift));
+}
+
+static void fixed_biquad_quantize(FixedBiquad *fq, const Biquad *bq, double gain) {
+    const double scaled[5] = { bq->b0 * gain, bq->b1 * gain, bq->b2 * gain, bq->a1, bq->a2 };
+    int shift = coefficient_shift(scaled, 5);
+    fq->s1 = rescale_state(fq->s1, fq->shift, shift);
+    fq->s2 = rescale_state(fq->s2, fq->shift, shift);
+    fq->shift = shift;
+    fq->b0 = q31_coefficient(scaled[0], shift);
+    fq->b1 = q31_coefficient(scaled[1], shift);
+    fq->b2 = q31_coefficient(scaled[2], shift);
+    fq->a1 = q31_coefficient(scaled[3], shift);
+    fq->a2 = q31_coefficient(scaled[4], shift);
+    fq->version = bq->version;
+    fq->gain = gain;
+}
+
+// One Q15 sample through the section; gain = input full scale / output full scale
+gint16 fixed_biquad_update(FixedBiquad *fq, const Biquad *bq, double gain, gint16 x) {
+    if (fq->version != bq->version || fq->gain != gain) {
+        fixed_biquad_quantize(fq, bq, gain); // Design or sample time changed
+    }
+    int frac = 31 - fq->shift;
+    gint64 acc = (gint64)fq->b0 * x + fq->s1;
+    gint64 r = (acc + ((gint64)1 << (frac - 1))) >> frac;
+    gint16 y = q15_saturate(r);
+    gint32 residue = y == r ? (gint32)(acc - r * ((gint64)1 << frac)) : 0; // Saturated outputs feed back as they are
+    fq->s1 = (gint64)fq->b1 * x - (gint64)fq->a1 * y - (((gint64)fq->a1 * residue) >> frac) + fq->s2;
+    fq->s2 = (gint64)fq->b2 * x - (gint64)fq->a2 * y - (((gint64)fq->a2 * residue) >> frac);
+    return y;
+}
+
+// Controller step in physical units: ADC-style quantisation in, DAC-style out
+double fixed_controller_update(FixedBiquad *fq, const Biquad *bq, double x, double in_fs, double out_fs) {
+    gint16 y = fixed_biquad_update(fq, bq, in_fs / out_fs, q15_from_double(x, in_fs));
+    return q15_to_double(y, out_fs);
+}
+
+static void fixed_bank_quantize(FixedBiquadBank *fb, const BiquadBank *bank, double gain) {
+    double c[5 * BIQUAD_BANK_SIZE];
+    for (int i = 0; i < bank->n; i++) {
+        c[5 * i + 0] = bank->b0[i] * gain;
+        c[5 * i + 1] = bank->b1[i] * gain;
+        c[5 * i + 2] = bank->b2[i] * gain;
+        c[5 * i + 3] = bank->a1[i];
+        c[5 * i + 4] = bank->a2[i];
+    }
+    int shift = coefficient_shift(c, 5 * bank->n);
+    for (int i = 0; i < BIQUAD_BANK_SIZE; i++) {
+        gboolean off = i >= bank->n || (c[5 * i] == 0.0 && c[5 * i + 1] == 0.0 && c[5 * i + 2] == 0.0);
+        fb->s1[i] = off ? 0 : rescale_state(fb->s1[i], fb->shift, shift); // Lanes switched off lose their state
+        fb->s2[i] = off ? 0 : rescale_state(fb->s2[i], fb->shift, shift);
+        fb->b0[i] = off ? 0 : q31_coefficient(c[5 * i + 0], shift);
+        fb->b1[i] = off ? 0 : q31_coefficient(c[5 * i + 1], shift);
+        fb->b2[i] = off ? 0 : q31_coefficient(c[5 * i + 2], shift);
+        fb->a1[i] = off ? 0 : q31_coefficient(c[5 * i + 3], shift);
+        fb->a2[i] = off ? 0 : q31_coefficient(c[5 * i + 4], shift);
+    }
+    fb->n = bank->n;
+    fb->shift = shift;
+    fb->gain = gain;
+    fb->valid = TRUE;
+}
+
+// All lanes in one pass; lane i is bit-identical to fixed_biquad_update with the same format
+void fixed_bank_update(FixedBiquadBank *fb, const BiquadBank *bank, double gain, const gint16 *in, gint16 *out) {
+    if (!fb->valid || fb->n != bank->n || fb->gain != gain) {
+        fixed_bank_quantize(fb, bank, gain);
+    }
+    const int frac = 31 - fb->shift;
+    const gint64 round = (gint64)1 << (frac - 1);
+    for (int i = 0; i < fb->n; i++) {
+        gint64 acc = (gint64)fb->b0[i] * in[i] + fb->s1[i];
+        gint64 r = (acc + round) >> frac;
+        gint64 y = r > Q15_MAX ? Q15_MAX : r < Q15_MIN ? Q15_MIN : r;
+        gint32 residue = y == r ? (gint32)(acc - r * ((gint64)1 << frac)) : 0;
+        fb->s1[i] = (gint64)fb->b1[i] * in[i] - (gint64)fb->a1[i] * y - (((gint64)fb->a1[i] * residue) >> frac) + fb->s2[i];
+        fb->s2[i] = (gint64)fb->b2[i] * in[i] - (gint64)fb->a2[i] * y - (((gint64)fb->a2[i] * residue) >> frac);
+        out[i] = (gint16)y;
+    }
+}
+
+// One input broadcast to all lanes, outputs summed in 32 bits (same lane arithmetic as fixed_bank_update)
+gint32 fixed_bank_sum(FixedBiquadBank *fb, const BiquadBank *bank, double gain, gint16 x) {
+    if (!fb->valid || fb->n != bank->n || fb->gain != gain) {
+        fixed_bank_quantize(fb, bank, gain);
+    }
+    const int frac = 31 - fb->shift;
+    const gint64 round = (gint64)1 << (frac - 1);
+    gint32 sum = 0;
+    for (int i = 0; i < fb->n; i++) {
+        gint64 acc = (gint64)fb->b0[i] * x + fb->s1[i];
+        gint64 r = (acc + round) >> frac;
+        gint64 y = r > Q15_MAX ? Q15_MAX : r < Q15_MIN ? Q15_MIN : r;
+        gint32 residue = y == r ? (gint32)(acc - r * ((gint64)1 << frac)) : 0;
+        fb->s1[i] = (gint64)fb->b1[i] * x - (gint64)fb->a1[i] * y - (((gint64)fb->a1[i] * residue) >> frac) + fb->s2[i];
+        fb->s2[i] = (gint64)fb->b2[i] * x - (gint64)fb->a2[i] * y - (((gint64)fb->a2[i] * residue) >> frac);
+        sum += (gint32)y;
+    }
+    return sum;
+}
+
+// Closed-loop scenario for the benchmark: float and fixed runs of the same controller
+typedef struct {
+    const char *name;
+    InverterType type;
+    ControlType control;
+    int harmonic_order;
+    gboolean pll;
+} FixedBenchCase;
+
+static void fixed_bench_run(const FixedBenchCase *bc, gboolean fixed_point, double seconds, double *ns, double *rms,
+                            double *trace, InverterParams *final) {
+    const double dt = 50e-6;
+    InverterParams params;
+    inverter_init(&params);
+    params.running = TRUE;
+    params.type = bc->type;
+    params.control = bc->control;
+    params.harmonic_order = bc->harmonic_order;
+    params.pll_enabled = bc->pll;
+    params.grid_condition = bc->control == CONTROL_PR ? GRID_FAULT_HARMONICS : GRID_NORMAL;
+    params.control_ref_current = bc->type == SINGLE_PHASE ? 10.0 : 3.0;
+    params.fixed_point = fixed_point;
+    params.grid_rng_state = 1u;
+    int steps = (int)(seconds / dt), window = (int)(10 * 0.02 / dt);
+    double t = 0.0, sum = 0.0;
+    gint64 start = g_get_monotonic_time();
+    for (int k = 0; k < steps; k++) {
+        t += dt;
+        if (bc->pll) {
+            pll_update(&params, t, dt);
+            trace[k] = params.pll_angle;
+        } else {
+            control_update(&params, t, dt);
+            trace[k] = params.plant_current;
+        }
+    }
+    *ns = (g_get_monotonic_time() - start) * 1e3 / steps;
+    // Tracking error of the current loop
+    t = 0.0;
+    for (int k = 0; k < steps; k++) {
+        t += dt;
+        double error = params.control_ref_current * sin(timebase_angle(params.frequency, t) + params.phase) - trace[k];
+        if (k >= steps - window && !bc->pll) sum += error * error;
+    }
+    *rms = sqrt(sum / window);
+    *final = params;
+}
+
+// Headless mode: --fixed-bench [seconds]
+// Bit-exactness of the batched Q31 kernel against the scalar section, then float and
+// fixed-point runs of the current loops and the SRF-PLL: cost per step, tracking error
+// and the deviation quantisation causes.
+int fixed_bench_main(int argc, char *argv[]) {
+    double seconds = argc > 2 ? atof(argv[2]) : 1.0;
+    const double dt = 50e-6;
+
+    // Kernel: the 25-lane harmonic bank on pseudo-random Q15 input
+    InverterParams params;
+    inverter_init(&params);
+    params.harmonic_order = HARMONIC_MAX_ORDER;
+    harmonic_bank_tune(&params, 50.0, dt);
+    const double gain = FIXED_CURRENT_FS / FIXED_DUTY_FS;
+    gint16 probe_in[BIQUAD_BANK_SIZE] = { 0 }, probe_out[BIQUAD_BANK_SIZE];
+    fixed_bank_update(&params.harmonic_bank_fixed, &params.harmonic_bank, gain, probe_in, probe_out); // Quantise
+    FixedBiquadBank *fb = &params.harmonic_bank_fixed;
+    FixedBiquad lanes[BIQUAD_BANK_SIZE];
+    const Biquad lanes_design = { .version = 1 }; // Stands for the bank's design: the lanes never requantise
+    for (int i = 0; i < fb->n; i++) {
+        memset(&lanes[i], 0, sizeof(lanes[i]));
+        lanes[i].b0 = fb->b0[i];
+        lanes[i].b1 = fb->b1[i];
+        lanes[i].b2 = fb->b2[i];
+        lanes[i].a1 = fb->a1[i];
+        lanes[i].a2 = fb->a2[i];
+        lanes[i].shift = fb->shift;
+        lanes[i].version = lanes_design.version;
+        lanes[i].gain = gain;
+    }
+    const int samples = 1000000;
+    gint16 *input = g_new(gint16, samples);
+    guint32 rng = 0x2545F491u;
+    for (int k = 0; k < samples; k++) {
+        rng ^= rng << 13;
+        rng ^= rng >> 17;
+        rng ^= rng << 5;
+        input[k] = (gint16)((gint32)(rng >> 16) - 32768) / 8; // +-1/8 of full scale
+    }
+    // Bit-exactness: every lane of the batched kernels against the scalar section
+    FixedBiquadBank timed = *fb, summed = *fb;
+    long mismatches = 0;
+    for (int k = 0; k < samples; k++) {
+        gint16 in[BIQUAD_BANK_SIZE], out[BIQUAD_BANK_SIZE];
+        gint32 sum = 0;
+        for (int i = 0; i < fb->n; i++) in[i] = input[k];
+        fixed_bank_update(fb, &params.harmonic_bank, gain, in, out);
+        for (int i = 0; i < fb->n; i++) {
+            gint16 ref = fixed_biquad_update(&lanes[i], &lanes_design, gain, in[i]);
+            mismatches += out[i] != ref;
+            sum += ref;
+        }
+        mismatches += fixed_bank_sum(&summed, &params.harmonic_bank, gain, input[k]) != sum;
+    }
+
+    // Cost per sample of the fixed and the double bank on the same input, summed as in the PR loop
+    volatile gint64 sink = 0;
+    gint64 start = g_get_monotonic_time();
+    for (int k = 0; k < samples; k++) {
+        sink += fixed_bank_sum(&timed, &params.harmonic_bank, gain, input[k]);
+    }
+    double fixed_ns = (g_get_monotonic_time() - start) * 1e3 / samples;
+    start = g_get_monotonic_time();
+    for (int k = 0; k < samples; k++) {
+        sink += (gint64)biquad_bank_sum(&params.harmonic_bank, input[k] * (FIXED_CURRENT_FS / 32768.0));
+    }
+    double float_ns = (g_get_monotonic_time() - start) * 1e3 / samples;
+    printf("Q31 harmonic bank, %d lanes, Q(%d) coefficients, %d samples\n", fb->n, 31 - fb->shift, samples);
+    printf("  fixed bank: %6.1f ns/sample, double bank: %6.1f ns/sample\n", fixed_ns, float_ns);
+    printf("  lane outputs differing from the scalar reference: %ld\n\n", mismatches);
+    g_free(input);
+
+    // Closed loop at 20 kHz
+    const FixedBenchCase cases[] = {
+        { "PI single-phase", SINGLE_PHASE, CONTROL_PI, 1, FALSE },
+        { "PR order 49", SINGLE_PHASE, CONTROL_PR, HARMONIC_MAX_ORDER, FALSE },
+        { "dq PI three-phase", THREE_PHASE, CONTROL_PI, 1, FALSE },
+        { "SRF-PLL", SINGLE_PHASE, CONTROL_NONE, 1, TRUE },
+    };
+    int steps = (int)(seconds / dt);
+    double *trace_float = g_new(double, steps), *trace_fixed = g_new(double, steps), *trace_repeat = g_new(double, steps);
+    printf("Closed loop, %.1f s at 20 kHz (rms over the last 10 periods; deviation = max |fixed - float|)\n", seconds);
+    printf("%20s %12s %12s %12s %12s %14s %10s\n", "case", "float ns", "fixed ns", "float rms", "fixed rms", "deviation",
+           "repeatable");
+    for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+        double ns_float, ns_fixed, rms_float, rms_fixed, ns_repeat, rms_repeat;
+        InverterParams end_float, end_fixed, end_repeat;
+        fixed_bench_run(&cases[c], FALSE, seconds, &ns_float, &rms_float, trace_float, &end_float);
+        fixed_bench_run(&cases[c], TRUE, seconds, &ns_fixed, &rms_fixed, trace_fixed, &end_fixed);
+        fixed_bench_run(&cases[c], TRUE, seconds, &ns_repeat, &rms_repeat, trace_repeat, &end_repeat);
+        double deviation = 0.0;
+        gboolean repeatable = TRUE;
+        for (int k = 0; k < steps; k++) {
+            double d = trace_fixed[k] - trace_float[k];
+            if (cases[c].pll) d = remainder(d, 2 * M_PI) * 180.0 / M_PI;
+            deviation = fmax(deviation, fabs(d));
+            repeatable &= trace_fixed[k] == trace_repeat[k];
+        }
+        repeatable &= memcmp(&end_fixed.current_pi_fixed, &end_repeat.current_pi_fixed, sizeof(FixedBiquad)) == 0 &&
+                      memcmp(&end_fixed.pll_pi_fixed, &end_repeat.pll_pi_fixed, sizeof(FixedBiquad)) == 0;
+        char dev[32];
+        snprintf(dev, sizeof(dev), cases[c].pll ? "%.4f deg" : "%.4f A", deviation);
+        if (cases[c].pll) {
+            printf("%20s %12.1f %12.1f %12s %12s %14s %10s\n", cases[c].name, ns_float, ns_fixed, "-", "-", dev,
+                   repeatable ? "yes" : "NO");
+        } else {
+            printf("%20s %12.1f %12.1f %12.4f %12.4f %14s %10s\n", cases[c].name, ns_float, ns_fixed, rms_float,
+                   rms_fixed, dev, repeatable ? "yes" : "NO");
+        }
+    }
+    g_free(trace_float);
+    g_free(trace_fixed);
+    g_free(trace_repeat);
+    return 0;
+}
\ No newline at end of file
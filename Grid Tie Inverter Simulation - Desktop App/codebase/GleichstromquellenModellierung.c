@@ -2,115 +2,247 @@
 #include <math.h>
 #include <stdlib.h>
 
-static double pv_current(AppData *app, double V) {
-    // PV parameters (per panel, e.g., 250W module)
-    const double Isc = 8.21; // Short-circuit current (A) at STC
-    const double Voc = 37.6; // Open-circuit voltage (V) at STC
-    const double Ki = 0.00065; // Current temp coefficient (A/°C)
-    const double Kv = -0.123; // Voltage temp coefficient (V/°C)
-    const double Gref = 1000.0; // Reference irradiance (W/m²)
-    const double Tref = 25.0; // Reference temperature (°C)
+PVDiode pv_diode(double irradiance, double temperature) {
     const double q = 1.602e-19; // Electron charge (C)
     const double k = 1.381e-23; // Boltzmann constant (J/K)
-    const double n = 1.3; // Diode ideality factor
-    const double Rs = 0.221; // Series resistance (Ω)
-    const double Rsh = 415.405; // Shunt resistance (Ω)
-
-    double G = app->params.pv_irradiance;
-    double T = app->params.pv_temperature + 273.15; // Convert to K
-    int Ns = app->params.pv_ns;
-    int Np = app->params.pv_np;
-
-    // Adjust for temperature and irradiance
-    double Iph = (Isc + Ki * (T - 273.15 - Tref)) * (G / Gref) * Np;
-    double Vt = Ns * n * k * T / q; // Thermal voltage
-    double Io = Isc / (exp((Voc + Kv * (T - 273.15 - Tref)) / Vt) - 1); // Saturation current
-
-    // Solve I = Iph - Io * [exp((V + I*Rs)/(n*Vt)) - 1] - (V + I*Rs)/Rsh
-    // Use approximation for simplicity
-    double I = Iph;
-    for (int i = 0; i < 5; i++) { // Newton-Raphson iteration
-        double V_Rs = V / Ns + I * Rs;
-        double exp_term = exp(V_Rs / Vt);
-        I = Iph - Io * (exp_term - 1) - V_Rs / Rsh;
-    }
-    return I * Np;
-}
-
-static double battery_voltage(AppData *app, double I) {
-    // Battery parameters (Li-ion, 48V nominal)
-    double Vnom = 48.0; // Nominal voltage
-    double capacity = app->params.battery_capacity; // Ah
-    double SoC = app->params.battery_soc;
-    double eta = app->params.battery_charging ? 0.95 : 0.98; // Charge/discharge efficiency
-    int battery_type = gtk_drop_down_get_selected(GTK_DROP_DOWN(app->dc_battery_type_dropdown));
-    if (battery_type == 1) { // Lead-acid
-        Vnom = 12.0;
-        eta *= 0.9;
-    }
-
-    // Kinetic battery model approximation
-    double V0 = Vnom * (1.0 + 0.1 * (SoC - 0.5)); // Open-circuit voltage
-    double R_int = 0.05 * (1.0 / SoC); // Internal resistance
-    double V = V0 - I * R_int;
-
-    // Update SoC
-    double dt = 0.05; // 50ms step
-    double dAh = (app->params.battery_charging ? I * eta : -I / eta) * (dt / 3600.0);
-    app->params.battery_soc += dAh / capacity;
-    if (app->params.battery_soc > 0.9) app->params.battery_soc = 0.9; // Prevent overcharge
-    if (app->params.battery_soc < 0.2) app->params.battery_soc = 0.2; // Prevent deep discharge
-
-    return V;
-}
-
-static double fuel_cell_voltage(AppData *app, double I) {
-    // PEM fuel cell parameters
-    const double V0 = 48.0; // Nominal stack voltage
-    const double A = 0.06; // Tafel slope
-    const double R = 0.01; // Ohmic resistance
-    const double m = 0.05; // Mass transport coefficient
-    const double n = 0.0001; // Mass transport constant
-
-    double P_demand = app->params.fuel_cell_power;
-    double V = V0 - A * log(I + 1.0) - I * R - m * exp(n * I);
-    if (V * I > P_demand) {
-        I = P_demand / V; // Limit to demanded power
-        V = V0 - A * log(I + 1.0) - I * R - m * exp(n * I);
-    }
-    return V;
-}
-
-void dc_source_update(AppData *app) {
+    double dT = temperature - PV_TREF;
+    PVDiode d;
+    d.a = PV_IDEALITY * PV_CELLS * k * (temperature + 273.15) / q;
+    d.iph = (PV_ISC + PV_KI * dT) * (irradiance / PV_GREF);
+    d.io = (PV_ISC + PV_KI * dT) / expm1((PV_VOC + PV_KV * dT) / d.a);
+    return d;
+}
+
+// Wright omega function w(x) = W(e^x): principal Lambert W of an exponential,
+// evaluated without forming e^x (the single-diode argument overflows a double)
+double wright_omega(double x) {
+    if (x < -700.0) return exp(x); // W(z) = z to double precision
+    double w = x > 1.0 ? x - log(x) : exp(x) / (1.0 + exp(x)); // Within 30% everywhere
+    for (int iter = 0; iter < 8; iter++) { // Halley on f(w) = w + ln(w) - x, cubic convergence
+        double f = w + log(w) - x;
+        double f1 = 1.0 + 1.0 / w;
+        double step = f / (f1 + f / (2.0 * w * w * f1));
+        w -= step;
+        if (fabs(step) <= 1e-15 * w) break;
+    }
+    return w;
+}
+
+// Module current solving I = Iph - Io * (exp((V + I*Rs) / a) - 1) - (V + I*Rs) / Rsh in closed form
+static double pv_module_current(const PVDiode *d, double v) {
+    double g = PV_RS + PV_RSH;
+    double log_theta = log(PV_RS * PV_RSH * d->io / (d->a * g)) + PV_RSH * (PV_RS * (d->iph + d->io) + v) / (d->a * g);
+    return (PV_RSH * (d->iph + d->io) - v) / g - d->a / PV_RS * wright_omega(log_theta);
+}
+
+// Module open-circuit voltage: the same equation at I = 0
+static double pv_module_voc(const PVDiode *d) {
+    double x = PV_RSH * (d->iph + d->io) / d->a;
+    return PV_RSH * (d->iph + d->io) - d->a * wright_omega(log(PV_RSH * d->io / d->a) + x);
+}
+
+// Array current at the array voltage: Ns modules in series per string, Np strings in parallel
+double pv_array_current_exact(const InverterParams *params, double voltage) {
+    PVDiode d = pv_diode(params->pv_irradiance, params->pv_temperature);
+    return params->pv_np * pv_module_current(&d, voltage / params->pv_ns);
+}
+
+// Samples the I-V curve from short circuit to open circuit with monotone cubic slopes
+static void pv_curve_build(PVCurve *curve, const InverterParams *params) {
+    PVDiode d = pv_diode(params->pv_irradiance, params->pv_temperature);
+    int n = PV_CURVE_POINTS;
+    curve->irradiance = params->pv_irradiance;
+    curve->temperature = params->pv_temperature;
+    curve->ns = params->pv_ns;
+    curve->np = params->pv_np;
+    curve->voc = params->pv_ns * pv_module_voc(&d);
+    for (int k = 0; k < n; k++) {
+        double s = 1.0 - (double)k / (n - 1);
+        curve->v[k] = curve->voc * (1.0 - s * s); // Spacing shrinks towards the knee and voc
+        curve->i[k] = params->pv_np * pv_module_current(&d, curve->v[k] / params->pv_ns);
+    }
+    curve->i[n - 1] = 0.0;
+
+    // Fritsch-Carlson: harmonic mean of the neighbouring secants keeps each segment monotone
+    double secant[PV_CURVE_POINTS];
+    for (int k = 0; k < n - 1; k++) {
+        secant[k] = (curve->i[k + 1] - curve->i[k]) / (curve->v[k + 1] - curve->v[k]);
+    }
+    curve->slope[0] = secant[0];
+    curve->slope[n - 1] = secant[n - 2];
+    for (int k = 1; k < n - 1; k++) {
+        double h0 = curve->v[k] - curve->v[k - 1], h1 = curve->v[k + 1] - curve->v[k];
+        if (secant[k - 1] * secant[k] <= 0.0) {
+            curve->slope[k] = 0.0;
+        } else {
+            double w0 = 2.0 * h1 + h0, w1 = h1 + 2.0 * h0;
+            curve->slope[k] = (w0 + w1) / (w0 / secant[k - 1] + w1 / secant[k]);
+        }
+    }
+}
+
+// Array current from the cached curve, rebuilt only when irradiance, temperature or layout change
+double pv_array_current(InverterParams *params, double voltage) {
+    PVCurve *curve = &params->pv_curve;
+    if (curve->ns != params->pv_ns || curve->np != params->pv_np || curve->irradiance != params->pv_irradiance ||
+        curve->temperature != params->pv_temperature) {
+        pv_curve_build(curve, params);
+    }
+    if (!(voltage >= 0.0 && voltage < curve->voc)) {
+        return pv_array_current_exact(params, voltage); // Reverse or beyond open circuit: off the table
+    }
+
+    // Invert the sample spacing v = voc * (1 - (1 - k / (n - 1))^2) to find the segment
+    int n = PV_CURVE_POINTS;
+    int k = (int)((1.0 - sqrt(1.0 - voltage / curve->voc)) * (n - 1));
+    if (k > n - 2) k = n - 2;
+    if (voltage < curve->v[k]) k--; // Rounding at a sample
+    else if (voltage >= curve->v[k + 1]) k++;
+
+    // Cubic Hermite segment
+    double h = curve->v[k + 1] - curve->v[k];
+    double t = (voltage - curve->v[k]) / h;
+    double t2 = t * t, t3 = t2 * t;
+    return (2.0 * t3 - 3.0 * t2 + 1.0) * curve->i[k] + (t3 - 2.0 * t2 + t) * h * curve->slope[k] +
+           (-2.0 * t3 + 3.0 * t2) * curve->i[k + 1] + (t3 - t2) * h * curve->slope[k + 1];
+}
+
+// PEM fuel cell polarisation curve: open-circuit, activation (Tafel), ohmic and mass-transport terms
+double fuel_cell_voltage(double current) {
+    return FUEL_CELL_V0 - FUEL_CELL_TAFEL * log(current + 1.0) - FUEL_CELL_R * current -
+           FUEL_CELL_M * exp(FUEL_CELL_N * current);
+}
+
+// dV/dI of the polarisation curve
+static double fuel_cell_slope(double current) {
+    return -FUEL_CELL_TAFEL / (current + 1.0) - FUEL_CELL_R - FUEL_CELL_M * FUEL_CELL_N * exp(FUEL_CELL_N * current);
+}
+
+// Maximum power point of the stack, where d(V * I)/dI = V + I * dV/dI = 0
+static double fuel_cell_mpp_current;
+static double fuel_cell_mpp_power;
+
+// Stack current over output power, tabulated on a uniform grid with exact slopes dI/dP = 1 / (V + I * dV/dI)
+static double fuel_cell_table_i[FUEL_CELL_TABLE_POINTS];
+static double fuel_cell_table_slope[FUEL_CELL_TABLE_POINTS];
+
+// Newton on f(I) = I * V(I) - P on the rising branch [0, I_mpp], falling back to bisection whenever a step
+// leaves the bracket. Demands above the maximum power get I_mpp.
+static double fuel_cell_solve(double power, int *iterations) {
+    int iter = 0;
+    double current = fuel_cell_mpp_current;
+    if (power <= 0.0) {
+        current = 0.0;
+    } else if (power < fuel_cell_mpp_power) {
+        double lo = 0.0, hi = fuel_cell_mpp_current;
+        current = power / FUEL_CELL_V0; // Below the root: V(I) < V0
+        for (iter = 1; iter <= 60; iter++) {
+            double f = current * fuel_cell_voltage(current) - power;
+            if (f < 0.0) lo = current;
+            else hi = current;
+            double next = current - f / (fuel_cell_voltage(current) + current * fuel_cell_slope(current));
+            if (!(next > lo && next < hi)) next = 0.5 * (lo + hi);
+            double step = next - current;
+            current = next;
+            if (fabs(step) <= 1e-13 * current) break;
+        }
+    }
+    if (iterations) *iterations = iter;
+    return current;
+}
+
+// Finds the maximum power point by Newton on V + I * dV/dI and fills the table, once for all threads
+static void fuel_cell_init(void) {
+    static gsize ready;
+    if (!g_once_init_enter(&ready)) return;
+    double current = FUEL_CELL_V0 / (2.0 * FUEL_CELL_R); // Ohmic-only maximum
+    for (int iter = 0; iter < 50; iter++) {
+        double g = fuel_cell_voltage(current) + current * fuel_cell_slope(current);
+        double curvature = FUEL_CELL_TAFEL / ((current + 1.0) * (current + 1.0)) -
+                           FUEL_CELL_M * FUEL_CELL_N * FUEL_CELL_N * exp(FUEL_CELL_N * current);
+        double step = g / (2.0 * fuel_cell_slope(current) + current * curvature);
+        current -= step;
+        if (fabs(step) < 1e-12 * current) break;
+    }
+    fuel_cell_mpp_current = current;
+    fuel_cell_mpp_power = current * fuel_cell_voltage(current);
+    const double h = FUEL_CELL_TABLE_POWER / (FUEL_CELL_TABLE_POINTS - 1);
+    for (int k = 0; k < FUEL_CELL_TABLE_POINTS; k++) {
+        double i = fuel_cell_solve(k * h, NULL);
+        fuel_cell_table_i[k] = i;
+        fuel_cell_table_slope[k] = 1.0 / (fuel_cell_voltage(i) + i * fuel_cell_slope(i));
+    }
+    g_once_init_leave(&ready, 1);
+}
+
+// Stack current delivering an output power, solved to full precision
+double fuel_cell_current_exact(double power, int *iterations) {
+    fuel_cell_init();
+    return fuel_cell_solve(power, iterations);
+}
+
+double fuel_cell_max_power(void) {
+    fuel_cell_init();
+    return fuel_cell_mpp_power;
+}
+
+// Hot-path stack current: cubic Hermite interpolation of the table, the exact solve above its range
+double fuel_cell_current(double power) {
+    const double h = FUEL_CELL_TABLE_POWER / (FUEL_CELL_TABLE_POINTS - 1);
+    fuel_cell_init();
+    if (power <= 0.0) return 0.0;
+    if (power >= FUEL_CELL_TABLE_POWER) return fuel_cell_solve(power, NULL);
+    double x = power / h;
+    int k = (int)x;
+    double t = x - k;
+    double t2 = t * t, t3 = t2 * t;
+    return (2.0 * t3 - 3.0 * t2 + 1.0) * fuel_cell_table_i[k] + (t3 - 2.0 * t2 + t) * h * fuel_cell_table_slope[k] +
+           (-2.0 * t3 + 3.0 * t2) * fuel_cell_table_i[k + 1] + (t3 - t2) * h * fuel_cell_table_slope[k + 1];
+}
+
+// Feeds the battery's SoC to the aging model every step and applies the fade on each hourly boundary
+static void dc_source_battery_aging(InverterParams *params, double dt) {
+    if (dt <= 0.0) return; // Re-evaluation only: no time has passed
+    battery_aging_sample(&params->battery_aging, params->battery_soc, params->battery_temperature, dt);
+    params->battery_aging_time += dt;
+    while (params->battery_aging_time >= 3600.0) {
+        battery_aging_update(&params->battery_aging, &params->battery, 3600.0);
+        params->battery_aging_time -= 3600.0;
+    }
+}
+
+void dc_source_update(AppData *app, double dt) {
     double V = app->params.mppt_voltage; // Use MPPT voltage if active
     double I = 0.0;
 
     switch (app->params.dc_source) {
         case DC_SOURCE_PV:
-            I = pv_current(app, V);
+            I = pv_array_current(&app->params, V);
             app->params.dc_voltage = V;
             app->params.dc_current = I;
             break;
         case DC_SOURCE_BATTERY:
-            app->params.dc_voltage = battery_voltage(app, I);
-            app->params.dc_current = app->params.control_ref_current; // Assume inverter demand
+            I = app->params.control_ref_current; // Assume inverter demand
+            app->params.dc_voltage = battery_update(&app->params, app->params.battery_charging ? -I : I, dt);
+            app->params.dc_current = fabs(app->params.battery.current);
+            dc_source_battery_aging(&app->params, dt);
             break;
         case DC_SOURCE_FUEL_CELL:
-            I = app->params.fuel_cell_power / V;
-            app->params.dc_voltage = fuel_cell_voltage(app, I);
+            I = fuel_cell_current(app->params.fuel_cell_power); // Solves V(I) * I = P_demand
+            app->params.dc_voltage = fuel_cell_voltage(I);
             app->params.dc_current = I;
             break;
-        case DC_SOURCE_HYBRID:
-            // Hybrid: Fuel cell provides base, battery handles transient
-            I = app->params.fuel_cell_power / V;
-            app->params.dc_voltage = fuel_cell_voltage(app, I);
-            app->params.dc_current = I;
-            double I_extra = app->params.control_ref_current - I;
-            if (I_extra > 0) {
-                app->params.dc_voltage = battery_voltage(app, I_extra);
-                app->params.dc_current += I_extra;
-            }
+        case DC_SOURCE_HYBRID: {
+            // Hybrid: the fuel cell delivers its set power through its converter, the battery on the DC bus
+            // balances the inverter's AC power at the reference current
+            double p_fuel_cell = fmin(app->params.fuel_cell_power, fuel_cell_max_power());
+            double p_inverter = app->params.voltage * app->params.control_ref_current / sqrt(2.0);
+            double v_bus = app->params.battery.ocv > 0.0 ? app->params.battery.ocv : battery_update(&app->params, 0.0, 0.0);
+            app->params.dc_voltage = battery_update(&app->params, (p_inverter - p_fuel_cell) / v_bus, dt);
+            app->params.dc_current = p_inverter / app->params.dc_voltage;
+            dc_source_battery_aging(&app->params, dt);
             break;
+        }
     }
 }
 
@@ -123,7 +255,19 @@ static void on_dc_param_changed(GtkRange *range, gpointer user_data) {
     app->params.battery_soc = gtk_range_get_value(GTK_RANGE(app->dc_soc_scale)) / 100.0;
     app->params.fuel_cell_power = gtk_range_get_value(GTK_RANGE(app->dc_fuel_cell_power_scale));
     if (app->params.running) {
-        dc_source_update(app);
+        dc_source_update(app, 0.0); // Re-evaluate without advancing time
+    }
+}
+
+static void on_dc_battery_type_changed(GtkDropDown *dropdown, GParamSpec *pspec, gpointer user_data) {
+    AppData *app = (AppData *)user_data;
+    app->params.battery_type = gtk_drop_down_get_selected(dropdown);
+    // A different chemistry is a new battery: restart its aging
+    battery_aging_init(&app->params.battery_aging, app->params.battery_type);
+    app->params.battery_aging_time = 0.0;
+    app->params.battery.capacity_fade = app->params.battery.resistance_growth = 0.0;
+    if (app->params.running) {
+        dc_source_update(app, 0.0); // Re-evaluate without advancing time
     }
 }
 
@@ -131,7 +275,7 @@ static void on_dc_charge_toggled(GtkToggleButton *button, gpointer user_data) {
     AppData *app = (AppData *)user_data;
     app->params.battery_charging = gtk_toggle_button_get_active(button);
     if (app->params.running) {
-        dc_source_update(app);
+        dc_source_update(app, 0.0); // Re-evaluate without advancing time
     }
 }
 
@@ -141,10 +285,22 @@ static void on_dc_fuel_cell_toggled(GtkSwitch *switch_widget, gboolean state, gp
         gtk_switch_set_active(switch_widget, FALSE); // Disable if not applicable
     }
     if (app->params.running) {
-        dc_source_update(app);
+        dc_source_update(app, 0.0); // Re-evaluate without advancing time
     }
 }
 
+static void on_dc_link_model_changed(GtkDropDown *dropdown, GParamSpec *pspec, gpointer user_data) {
+    AppData *app = (AppData *)user_data;
+    app->params.dc_link_model = gtk_drop_down_get_selected(dropdown);
+    dc_link_reset(&app->params); // Start at the setpoint
+}
+
+static void on_dc_link_capacitance_changed(GtkRange *range, gpointer user_data) {
+    AppData *app = (AppData *)user_data;
+    app->params.dc_link.capacitance = gtk_range_get_value(range) * 1e-3;
+    dc_link_reset(&app->params); // Restart at the setpoint with the new capacitor
+}
+
 void dc_source_window_create(AppData *app) {
     app->dc_source_window = gtk_window_new();
     gtk_window_set_title(GTK_WINDOW(app->dc_source_window), "DC Source Configuration");
@@ -195,7 +351,7 @@ void dc_source_window_create(AppData *app) {
     gtk_box_append(GTK_BOX(box), battery_type_label);
     const char *battery_types[] = { "Li-ion", "Lead-acid", NULL };
     app->dc_battery_type_dropdown = gtk_drop_down_new_from_strings(battery_types);
-    gtk_drop_down_set_selected(GTK_DROP_DOWN(app->dc_battery_type_dropdown), 0);
+    gtk_drop_down_set_selected(GTK_DROP_DOWN(app->dc_battery_type_dropdown), app->params.battery_type);
     gtk_box_append(GTK_BOX(box), app->dc_battery_type_dropdown);
 
     // SoC
@@ -226,6 +382,21 @@ void dc_source_window_create(AppData *app) {
     gtk_range_set_value(GTK_RANGE(app->dc_fuel_cell_power_scale), app->params.fuel_cell_power);
     gtk_box_append(GTK_BOX(box), app->dc_fuel_cell_power_scale);
 
+    // DC link configuration
+    GtkWidget *dc_link_label = gtk_label_new("DC Link / Boost Stage:");
+    gtk_box_append(GTK_BOX(box), dc_link_label);
+    const char *dc_link_models[] = { "None", "Averaged", "Switching", NULL };
+    app->dc_link_dropdown = gtk_drop_down_new_from_strings(dc_link_models);
+    gtk_drop_down_set_selected(GTK_DROP_DOWN(app->dc_link_dropdown), app->params.dc_link_model);
+    gtk_box_append(GTK_BOX(box), app->dc_link_dropdown);
+
+    // Capacitance
+    GtkWidget *capacitance_label = gtk_label_new("DC-Link Capacitance (mF):");
+    gtk_box_append(GTK_BOX(box), capacitance_label);
+    app->dc_link_capacitance_scale = gtk_scale_new_with_range(GTK_ORIENTATION_HORIZONTAL, 0.25, 5.0, 0.05);
+    gtk_range_set_value(GTK_RANGE(app->dc_link_capacitance_scale), app->params.dc_link.capacitance * 1e3);
+    gtk_box_append(GTK_BOX(box), app->dc_link_capacitance_scale);
+
     // Connect signals
     g_signal_connect(app->dc_irradiance_scale, "value-changed", G_CALLBACK(on_dc_param_changed), app);
     g_signal_connect(app->dc_temperature_scale, "value-changed", G_CALLBACK(on_dc_param_changed), app);
@@ -233,6 +404,9 @@ void dc_source_window_create(AppData *app) {
     g_signal_connect(app->dc_np_scale, "value-changed", G_CALLBACK(on_dc_param_changed), app);
     g_signal_connect(app->dc_soc_scale, "value-changed", G_CALLBACK(on_dc_param_changed), app);
     g_signal_connect(app->dc_fuel_cell_power_scale, "value-changed", G_CALLBACK(on_dc_param_changed), app);
+    g_signal_connect(app->dc_battery_type_dropdown, "notify::selected", G_CALLBACK(on_dc_battery_type_changed), app);
     g_signal_connect(app->dc_charge_button, "toggled", G_CALLBACK(on_dc_charge_toggled), app);
     g_signal_connect(app->dc_fuel_cell_switch, "state-set", G_CALLBACK(on_dc_fuel_cell_toggled), app);
+    g_signal_connect(app->dc_link_dropdown, "notify::selected", G_CALLBACK(on_dc_link_model_changed), app);
+    g_signal_connect(app->dc_link_capacitance_scale, "value-changed", G_CALLBACK(on_dc_link_capacitance_changed), app);
 }
\ No newline at end of file
@@ -1,13 +1,58 @@
 #include "inverter.h"
-#include <stdlib.h>
-#include <time.h>
 
-double grid_simulation_voltage(InverterParams *params, double t, double inverter_current, double *frequency, double *amplitude, gboolean *grid_connected) {
-    static gboolean initialized = FALSE;
-    if (!initialized) {
-        srand((unsigned int)time(NULL));
-        initialized = TRUE;
+// Per-run xorshift generator: reproducible from the saved state and safe to run in parallel
+static guint32 grid_random(InverterParams *params) {
+    guint32 x = params->grid_rng_state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    params->grid_rng_state = x;
+    return x;
+}
+
+// Harmonics of the harmonic-fault grid: order and amplitude per unit of the fundamental peak
+static const struct {
+    int order;
+    double amplitude;
+} grid_harmonics[] = { { 3, 0.05 }, { 5, 0.03 }, { 7, 0.02 } };
+
+// Low-order distortion of the harmonic-fault grid, per unit of the fundamental peak
+double grid_harmonic_distortion(InverterParams *params, double frequency, double t) {
+    if (params->grid_condition != GRID_FAULT_HARMONICS) {
+        return 0.0;
+    }
+    double d = 0.0;
+    for (size_t i = 0; i < sizeof(grid_harmonics) / sizeof(grid_harmonics[0]); i++) {
+        d += grid_harmonics[i].amplitude * sin(timebase_angle(grid_harmonics[i].order * frequency, t));
+    }
+    return d;
+}
+
+// Source phasors per phase (per unit of the nominal peak): phase k = re*sin(wt) + im*cos(wt).
+// Balanced phases sit at 0, +120 and +240 deg; the asymmetric faults follow the usual
+// dip types at the PCC: single-phase (type B) and phase-to-phase (type C).
+static void grid_phase_phasors(InverterParams *params, double t, double fault_factor, double *re, double *im) {
+    for (int k = 0; k < 3; k++) {
+        re[k] = fault_factor * cos(k * 2 * M_PI / 3);
+        im[k] = fault_factor * sin(k * 2 * M_PI / 3);
+    }
+    if (t < 1.0 || t > 1.5) {
+        return;
     }
+    if (params->grid_condition == GRID_FAULT_SINGLE_PHASE) {
+        re[0] *= 0.2; // Phase a dips to 20%
+        im[0] *= 0.2;
+    } else if (params->grid_condition == GRID_FAULT_PHASE_TO_PHASE) {
+        im[1] *= 0.5; // b and c collapse towards each other, a is unaffected
+        im[2] *= 0.5;
+    }
+}
+
+// Open-circuit PCC phase voltages (b at +120 deg, c at +240 deg) for the present grid state,
+// without the random disconnection draw, and the drop per ampere of each phase current:
+// v_pcc[k] = v_source[k] - drop[k] * i[k]. amplitude returns the RMS voltage of phase a.
+void grid_pcc_source(InverterParams *params, double t, double *v_source, double *drop, double *frequency,
+                     double *amplitude) {
 
     // Grid impedance (R + jX)
     double R, L, X;
@@ -23,45 +68,71 @@ double grid_simulation_voltage(InverterParams *params, double t, double inverter
     // Nominal grid voltage and frequency
     double V_nom = 220.0; // RMS
     double f_nom = 50.0; // Hz
-    *amplitude = V_nom;
-    *frequency = f_nom;
 
-    // Random grid disconnection (5% chance per second)
-    if (rand() % 100 < 5 && t > 1.0) {
-        *grid_connected = FALSE;
-    }
-
-    if (!*grid_connected) {
+    if (!params->grid_connected) {
         *frequency = 50.0; // Local load frequency
         *amplitude = 220.0; // Local load voltage
-        return *amplitude * sqrt(2) * sin(2 * M_PI * *frequency * t);
+        for (int k = 0; k < 3; k++) {
+            v_source[k] = *amplitude * sqrt(2) * sin(timebase_angle(*frequency, t + k / (3.0 * *frequency)));
+            drop[k] = 0.0;
+        }
+        return;
     }
 
     // Grid faults
     double fault_factor = 1.0;
     double freq_shift = 0.0;
-    double harmonic = 0.0;
     if (params->grid_condition == GRID_FAULT_SAG && t >= 1.0 && t <= 1.5) {
         fault_factor = 0.5; // 50% voltage sag
     } else if (params->grid_condition == GRID_FAULT_SWELL && t >= 1.0 && t <= 1.5) {
         fault_factor = 1.2; // 120% voltage swell
-    } else if (params->grid_condition == GRID_FAULT_HARMONICS) {
-        harmonic = 0.05 * sin(3 * 2 * M_PI * f_nom * t) + // 3rd harmonic
-                   0.03 * sin(5 * 2 * M_PI * f_nom * t) + // 5th harmonic
-                   0.02 * sin(7 * 2 * M_PI * f_nom * t);  // 7th harmonic
     } else if (params->grid_condition == GRID_FAULT_FREQ_SHIFT && t >= 1.0 && t <= 1.5) {
         freq_shift = 2.0; // +2 Hz shift
     }
 
-    // Grid voltage source
-    *amplitude = V_nom * fault_factor;
+    // Grid voltage source, one phasor per phase
+    double re[3], im[3];
+    grid_phase_phasors(params, t, fault_factor, re, im);
+    *amplitude = V_nom * hypot(re[0], im[0]);
     *frequency = f_nom + freq_shift;
-    double V_grid = *amplitude * sqrt(2) * sin(2 * M_PI * *frequency * t) + harmonic;
+    double theta = timebase_angle(*frequency, t);
+    double s = sin(theta), c = cos(theta);
+    for (int k = 0; k < 3; k++) {
+        // Harmonics: phase k is phase a advanced by k/3 of a period, so each keeps its own sequence
+        double harmonic = V_nom * sqrt(2) * grid_harmonic_distortion(params, f_nom, t + k / (3.0 * f_nom)); // 5% / 3% / 2% of the peak
+        v_source[k] = V_nom * sqrt(2) * (re[k] * s + im[k] * c) + harmonic;
 
-    // Voltage drop due to grid impedance: V_pcc = V_grid - I * (R + jX)
-    double V_drop = inverter_current * R; // Resistive drop (in-phase)
-    V_drop += inverter_current * X * cos(2 * M_PI * *frequency * t); // Reactive drop (90° phase)
-    double V_pcc = V_grid - V_drop;
+        // Voltage drop due to grid impedance: V_pcc = V_grid - I * (R + jX)
+        double angle = theta + k * 2 * M_PI / 3; // Nominal angle of phase k
+        drop[k] = R + X * cos(angle); // Resistive (in-phase) plus reactive (90° phase) drop per ampere
+    }
+}
+
+// PCC phase voltages loaded by the inverter phase currents inverter_current (A)
+void grid_pcc_voltages(InverterParams *params, double t, const double *inverter_current, double *v_pcc,
+                       double *frequency, double *amplitude) {
+    double v_source[3], drop[3];
+    grid_pcc_source(params, t, v_source, drop, frequency, amplitude);
+    for (int k = 0; k < 3; k++) {
+        v_pcc[k] = v_source[k] - drop[k] * inverter_current[k];
+    }
+}
+
+double grid_simulation_voltage(InverterParams *params, double t, double inverter_current, double *frequency, double *amplitude, gboolean *grid_connected) {
+    // Random grid disconnection (5% chance per second)
+    if (grid_random(params) % 100 < 5 && t > 1.0) {
+        *grid_connected = FALSE;
+    }
+
+    if (!*grid_connected) {
+        *frequency = 50.0; // Local load frequency
+        *amplitude = 220.0; // Local load voltage
+        return *amplitude * sqrt(2) * sin(timebase_angle(*frequency, t));
+    }
 
-    return V_pcc;
+    // Single-phase view: the inverter current flows in phase a
+    const double currents[3] = { inverter_current, 0.0, 0.0 };
+    double v_pcc[3];
+    grid_pcc_voltages(params, t, currents, v_pcc, frequency, amplitude);
+    return v_pcc[0];
 }
\ No newline at end of file
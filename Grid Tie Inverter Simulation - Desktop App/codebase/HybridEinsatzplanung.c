@@ -0,0 +1,351 @@
+#include "inverter.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Hybrid fuel cell / battery dispatch
+// A fuel cell behind a DC/DC converter and a Li-ion battery on the DC bus supply a load over one day in
+// fixed stages. The fuel cell runs at one of DISPATCH_LEVELS set points (off or 5% to 100% of its rating),
+// its balance of plant draws a fixed plus a proportional share while it runs, and the stack current for the
+// gross power comes from the tabulated polarisation solve. Hydrogen is priced per kWh of lower heating value
+// (1.25 V per cell and stack ampere); the battery is charged for its throughput and every start costs
+// stack wear. Load the battery cannot serve is priced as unserved energy. The stored energy left at the end
+// of the day relative to the start is credited (or charged) at its replacement cost: hydrogen through the
+// most efficient set point and the charge efficiency.
+// Dynamic programming solves the day backwards on a uniform SoC grid for both fuel cell states. For a set
+// point, the SoC change is the same at every grid point, so inside the grid the next state sits at a fixed
+// index offset and interpolation weight: the stage cost is a contiguous, branch-free loop over the grid.
+// Only the points where the battery would leave its SoC window take the general scalar path.
+
+#define DISPATCH_SOC_POINTS 141 // SoC grid from BATTERY_SOC_MIN to BATTERY_SOC_MAX (0.5% steps)
+#define DISPATCH_LEVELS 21 // Fuel cell set points: off, then 5% to 100% of the rating
+#define DISPATCH_MAX_STAGES 288 // Up to 5-minute stages
+#define DISPATCH_RATED_POWER 1000.0 // Fuel cell net rating (W)
+#define DISPATCH_BOP_FIXED 20.0 // Balance of plant while running (W)
+#define DISPATCH_BOP_SHARE 0.03 // Balance of plant per W of net output
+#define DISPATCH_LHV_VOLTAGE 60.0 // Hydrogen LHV per stack ampere: 48 cells at 1.25 V (W/A)
+#define DISPATCH_H2_PRICE 0.30 // Hydrogen (EUR per kWh LHV, 10 EUR/kg)
+#define DISPATCH_WEAR_PRICE 0.03 // Battery wear (EUR per kWh throughput)
+#define DISPATCH_START_PRICE 0.10 // Fuel cell start-up wear (EUR per start)
+#define DISPATCH_UNSERVED_PRICE 5.0 // Unserved load (EUR per kWh)
+#define DISPATCH_SOC_START 0.5
+
+typedef enum {
+    DISPATCH_LOAD_FOLLOWING, // Fuel cell always on, follows the load with a SoC correction
+    DISPATCH_THERMOSTAT, // Fuel cell at rated power between SoC 35% and 85% (hysteresis)
+    DISPATCH_OPTIMAL, // Dynamic programming over the day
+    DISPATCH_STRATEGIES
+} DispatchStrategy;
+
+static const char *dispatch_names[DISPATCH_STRATEGIES] = { "Load following", "Thermostat", "DP optimal" };
+
+typedef struct {
+    int stages;
+    double dt_h; // Stage length (h)
+    double capacity_wh; // Battery energy (Wh)
+    double eta_charge, eta_discharge; // Battery efficiencies
+    double level_power[DISPATCH_LEVELS]; // Net fuel cell power of each set point (W)
+    double level_fuel[DISPATCH_LEVELS]; // Hydrogen per stage at each set point (Wh LHV)
+    double stored_value; // Stored energy at the end of the day (EUR per kWh)
+} DispatchModel;
+
+typedef struct {
+    double cost; // EUR, end-of-day stored energy credited
+    double fuel_wh; // Hydrogen (Wh LHV)
+    double unserved_wh;
+    double throughput_wh; // Battery throughput, stored side
+    double on_hours;
+    double stored_wh; // Stored energy gained over the day
+    int starts;
+} DispatchResult;
+
+static double dispatch_fuel_wh(const DispatchModel *m, double p_fuel_cell) {
+    if (p_fuel_cell <= 0.0) return 0.0;
+    double gross = p_fuel_cell * (1.0 + DISPATCH_BOP_SHARE) + DISPATCH_BOP_FIXED;
+    return fuel_cell_current(gross) * DISPATCH_LHV_VOLTAGE * m->dt_h;
+}
+
+// SoC change of one stage at a battery power (positive = discharge), before the SoC limits
+static double dispatch_soc_change(const DispatchModel *m, double p_battery) {
+    return p_battery >= 0.0 ? -p_battery * m->dt_h / (m->eta_discharge * m->capacity_wh)
+                            : -p_battery * m->eta_charge * m->dt_h / m->capacity_wh;
+}
+
+// General stage transition from a continuous SoC: cost without the future, next SoC, optional statistics
+static double dispatch_stage(const DispatchModel *m, double soc, double load, double p_fuel_cell, double fuel_wh,
+                             gboolean was_on, double *soc_next, DispatchResult *r) {
+    double raw = soc + dispatch_soc_change(m, load - p_fuel_cell);
+    double next = fmin(fmax(raw, BATTERY_SOC_MIN), BATTERY_SOC_MAX);
+    double unserved = fmax(BATTERY_SOC_MIN - raw, 0.0) * m->capacity_wh * m->eta_discharge;
+    double throughput = fabs(next - soc) * m->capacity_wh;
+    gboolean start = p_fuel_cell > 0.0 && !was_on;
+    *soc_next = next;
+    if (r) {
+        r->fuel_wh += fuel_wh;
+        r->unserved_wh += unserved;
+        r->throughput_wh += throughput;
+        r->on_hours += p_fuel_cell > 0.0 ? m->dt_h : 0.0;
+        r->starts += start;
+    }
+    return (fuel_wh * DISPATCH_H2_PRICE + throughput * DISPATCH_WEAR_PRICE + unserved * DISPATCH_UNSERVED_PRICE) / 1000.0 +
+           (start ? DISPATCH_START_PRICE : 0.0);
+}
+
+static double dispatch_terminal(const DispatchModel *m, double soc) {
+    return -(soc - DISPATCH_SOC_START) * m->capacity_wh / 1000.0 * m->stored_value;
+}
+
+static double dispatch_interpolate(const double *value, double soc) {
+    double x = (soc - BATTERY_SOC_MIN) / (BATTERY_SOC_MAX - BATTERY_SOC_MIN) * (DISPATCH_SOC_POINTS - 1);
+    int j = (int)x;
+    if (j > DISPATCH_SOC_POINTS - 2) j = DISPATCH_SOC_POINTS - 2;
+    if (j < 0) j = 0;
+    double w = x - j;
+    return (1.0 - w) * value[j] + w * value[j + 1];
+}
+
+// Backward pass: value[(k * 2 + on) * DISPATCH_SOC_POINTS + i] is the cheapest cost from stage k on with the
+// fuel cell state on at grid SoC i
+static void dispatch_solve(const DispatchModel *m, const double *load, double *value) {
+    const int S = DISPATCH_SOC_POINTS;
+    const double h = (BATTERY_SOC_MAX - BATTERY_SOC_MIN) / (S - 1);
+    double candidate[DISPATCH_SOC_POINTS];
+    for (int on = 0; on < 2; on++) {
+        for (int i = 0; i < S; i++) value[(m->stages * 2 + on) * S + i] = dispatch_terminal(m, BATTERY_SOC_MIN + i * h);
+    }
+    for (int k = m->stages - 1; k >= 0; k--) {
+        for (int on = 0; on < 2; on++) {
+            double *best = value + (k * 2 + on) * S;
+            for (int i = 0; i < S; i++) best[i] = INFINITY;
+            for (int u = 0; u < DISPATCH_LEVELS; u++) {
+                const double *next = value + ((k + 1) * 2 + (u > 0)) * S;
+                double p_fuel_cell = m->level_power[u];
+                double dsoc = dispatch_soc_change(m, load[k] - p_fuel_cell);
+                double offset = dsoc / h; // Grid steps, the same from every point
+                int shift = (int)floor(offset);
+                double w = offset - shift;
+                double c = (m->level_fuel[u] * DISPATCH_H2_PRICE + fabs(dsoc) * m->capacity_wh * DISPATCH_WEAR_PRICE) / 1000.0 +
+                           (u > 0 && !on ? DISPATCH_START_PRICE : 0.0);
+                // Interior: next state at i + shift + w stays on the grid
+                int i_lo = shift < 0 ? -shift : 0;
+                int i_hi = S - 1 - shift < S ? S - 1 - shift : S;
+                if (i_hi < i_lo) i_hi = i_lo;
+                for (int i = i_lo; i < i_hi; i++) {
+                    candidate[i] = c + (1.0 - w) * next[i + shift] + w * next[i + shift + 1];
+                }
+                // Edges: the SoC limits cut the transition
+                for (int i = 0; i < i_lo; i++) {
+                    double soc_next;
+                    candidate[i] = dispatch_stage(m, BATTERY_SOC_MIN + i * h, load[k], p_fuel_cell, m->level_fuel[u], on,
+                                                  &soc_next, NULL) + dispatch_interpolate(next, soc_next);
+                }
+                for (int i = i_hi; i < S; i++) {
+                    double soc_next;
+                    candidate[i] = dispatch_stage(m, BATTERY_SOC_MIN + i * h, load[k], p_fuel_cell, m->level_fuel[u], on,
+                                                  &soc_next, NULL) + dispatch_interpolate(next, soc_next);
+                }
+                for (int i = 0; i < S; i++) best[i] = fmin(best[i], candidate[i]);
+            }
+        }
+    }
+}
+
+// Simulates one day under a strategy; the optimal strategy picks each set point by one-step lookahead on the
+// value function from the continuous SoC
+static DispatchResult dispatch_simulate(const DispatchModel *m, const double *load, DispatchStrategy strategy,
+                                        const double *value) {
+    DispatchResult r = { 0 };
+    double soc = DISPATCH_SOC_START;
+    gboolean on = FALSE, hysteresis = FALSE;
+    for (int k = 0; k < m->stages; k++) {
+        double p_fuel_cell = 0.0, fuel_wh = 0.0;
+        switch (strategy) {
+            case DISPATCH_LOAD_FOLLOWING:
+                p_fuel_cell = fmin(fmax(load[k] + 2.0 * (0.6 - soc) * DISPATCH_RATED_POWER, 0.1 * DISPATCH_RATED_POWER),
+                                   DISPATCH_RATED_POWER);
+                fuel_wh = dispatch_fuel_wh(m, p_fuel_cell);
+                break;
+            case DISPATCH_THERMOSTAT:
+                if (soc < 0.35) hysteresis = TRUE;
+                else if (soc > 0.85) hysteresis = FALSE;
+                p_fuel_cell = hysteresis ? DISPATCH_RATED_POWER : 0.0;
+                fuel_wh = dispatch_fuel_wh(m, p_fuel_cell);
+                break;
+            case DISPATCH_OPTIMAL: {
+                double best = INFINITY;
+                for (int u = 0; u < DISPATCH_LEVELS; u++) {
+                    double soc_next;
+                    double c = dispatch_stage(m, soc, load[k], m->level_power[u], m->level_fuel[u], on, &soc_next, NULL) +
+                               dispatch_interpolate(value + ((k + 1) * 2 + (u > 0)) * DISPATCH_SOC_POINTS, soc_next);
+                    if (c < best) {
+                        best = c;
+                        p_fuel_cell = m->level_power[u];
+                        fuel_wh = m->level_fuel[u];
+                    }
+                }
+                break;
+            }
+            case DISPATCH_STRATEGIES:
+                break;
+        }
+        r.cost += dispatch_stage(m, soc, load[k], p_fuel_cell, fuel_wh, on, &soc, &r);
+        on = p_fuel_cell > 0.0;
+    }
+    r.cost += dispatch_terminal(m, soc);
+    r.stored_wh = (soc - DISPATCH_SOC_START) * m->capacity_wh;
+    return r;
+}
+
+// Load day: base load, morning and evening peaks and short appliance spikes, drawn from the day index
+static void dispatch_load_day(int day, int stages, double *load) {
+    guint32 rng = 0x10AD0000u ^ (guint32)(day * 2654435761u);
+    if (rng == 0) rng = 1;
+    double draw[4];
+    for (int i = 0; i < 4; i++) {
+        rng ^= rng << 13;
+        rng ^= rng >> 17;
+        rng ^= rng << 5;
+        draw[i] = (rng >> 8) / 16777216.0;
+    }
+    double base = 150.0 + 150.0 * draw[0], morning = 200.0 + 400.0 * draw[1], evening = 400.0 + 900.0 * draw[2];
+    double evening_start = 17.0 + 2.0 * draw[3];
+    for (int k = 0; k < stages; k++) {
+        double hour = (k + 0.5) * 24.0 / stages;
+        double p = base;
+        if (hour >= 6.5 && hour < 9.0) p += morning * sin(M_PI * (hour - 6.5) / 2.5);
+        if (hour >= evening_start && hour < evening_start + 5.0) p += evening * sin(M_PI * (hour - evening_start) / 5.0);
+        rng ^= rng << 13;
+        rng ^= rng >> 17;
+        rng ^= rng << 5;
+        double spike = (rng >> 8) / 16777216.0;
+        if (hour >= 7.0 && hour < 23.0 && spike < 0.06) p += 500.0 + 1500.0 * (spike / 0.06); // Kettle, oven, pump
+        load[k] = p;
+    }
+}
+
+typedef struct {
+    DispatchModel model;
+    int days;
+    DispatchResult *results; // [day * DISPATCH_STRATEGIES + strategy]
+    double solve_us; // Total backward-pass time (us)
+    GMutex lock;
+} DispatchWork;
+
+// One load day: value table, then every strategy on it
+static void dispatch_task(int day, gpointer data) {
+    DispatchWork *work = (DispatchWork *)data;
+    const DispatchModel *m = &work->model;
+    double *value = g_new(double, (m->stages + 1) * 2 * DISPATCH_SOC_POINTS);
+    double load[DISPATCH_MAX_STAGES];
+    dispatch_load_day(day, m->stages, load);
+    gint64 start = g_get_monotonic_time();
+    dispatch_solve(m, load, value);
+    gint64 solve_us = g_get_monotonic_time() - start;
+    for (int s = 0; s < DISPATCH_STRATEGIES; s++) {
+        work->results[day * DISPATCH_STRATEGIES + s] = dispatch_simulate(m, load, (DispatchStrategy)s, value);
+    }
+    g_mutex_lock(&work->lock);
+    work->solve_us += solve_us;
+    g_mutex_unlock(&work->lock);
+    g_free(value);
+}
+
+// Headless mode: --dispatch-bench [days] [stage minutes]
+int dispatch_bench_main(int argc, char *argv[]) {
+    int days = argc > 2 ? atoi(argv[2]) : 2000;
+    double minutes = argc > 3 ? atof(argv[3]) : 15.0;
+    int stages = minutes > 0.0 ? (int)lround(24.0 * 60.0 / minutes) : 0;
+    if (days < 1 || days > 1000000 || stages < 1 || stages > DISPATCH_MAX_STAGES ||
+        fabs(stages * minutes - 24.0 * 60.0) > 1e-6) {
+        fprintf(stderr, "[Error] Dispatch bench: need 1 to 1000000 days and a stage of at least 5 min that divides 24 h\n");
+        return 1;
+    }
+
+    // Polarisation solve: Newton against the table on the hot path
+    const int sweep = 100000;
+    double table_error = 0.0, residual = 0.0;
+    long newton_iterations = 0;
+    for (int k = 0; k <= sweep; k++) {
+        double p = FUEL_CELL_TABLE_POWER * k / sweep;
+        int iterations;
+        double exact = fuel_cell_current_exact(p, &iterations);
+        newton_iterations += iterations;
+        table_error = fmax(table_error, fabs(fuel_cell_current(p) - exact));
+        residual = fmax(residual, fabs(exact * fuel_cell_voltage(exact) - p));
+    }
+    double sink = 0.0;
+    gint64 start = g_get_monotonic_time();
+    for (int k = 0; k < sweep; k++) sink += fuel_cell_current_exact(FUEL_CELL_TABLE_POWER * (k + 0.5) / sweep, NULL);
+    double newton_ns = (g_get_monotonic_time() - start) * 1e3 / sweep;
+    start = g_get_monotonic_time();
+    for (int k = 0; k < sweep; k++) sink += fuel_cell_current(FUEL_CELL_TABLE_POWER * (k + 0.5) / sweep);
+    double table_ns = (g_get_monotonic_time() - start) * 1e3 / sweep;
+    printf("Fuel cell: maximum power %.0f W; on 0-%.0f W Newton needs %.1f iterations on average (residual %.1e W, %.0f ns),\n"
+           "the %d-point table is within %.1e A of it (%.1f ns)%s\n",
+           fuel_cell_max_power(), FUEL_CELL_TABLE_POWER, (double)newton_iterations / (sweep + 1), residual, newton_ns,
+           FUEL_CELL_TABLE_POINTS, table_error, table_ns, sink < 0.0 ? " " : "");
+
+    DispatchWork *work = g_new0(DispatchWork, 1);
+    DispatchModel *m = &work->model;
+    InverterParams p;
+    inverter_init(&p);
+    m->stages = stages;
+    m->dt_h = minutes / 60.0;
+    m->capacity_wh = 48.0 * p.battery_capacity;
+    battery_efficiency(0, &m->eta_charge, &m->eta_discharge);
+    double best_efficiency = 0.0;
+    for (int u = 0; u < DISPATCH_LEVELS; u++) {
+        m->level_power[u] = DISPATCH_RATED_POWER * u / (DISPATCH_LEVELS - 1);
+        m->level_fuel[u] = dispatch_fuel_wh(m, m->level_power[u]);
+        if (u > 0) best_efficiency = fmax(best_efficiency, m->level_power[u] * m->dt_h / m->level_fuel[u]);
+    }
+    m->stored_value = DISPATCH_H2_PRICE / (best_efficiency * m->eta_charge);
+    work->days = days;
+    work->results = g_new0(DispatchResult, (gsize)days * DISPATCH_STRATEGIES);
+    g_mutex_init(&work->lock);
+
+    int n_threads = (int)g_get_num_processors();
+    if (n_threads > days) n_threads = days;
+    printf("\nDispatch: %d load days, %d stages of %g min, %d SoC points x %d set points x 2 states, %.1f kWh battery, "
+           "%.0f W fuel cell, %d threads\n",
+           days, stages, minutes, DISPATCH_SOC_POINTS, DISPATCH_LEVELS, m->capacity_wh / 1000.0, DISPATCH_RATED_POWER,
+           n_threads);
+    start = g_get_monotonic_time();
+    parallel_for(days, dispatch_task, work);
+    double wall = (g_get_monotonic_time() - start) * 1e-6;
+
+    printf("\n%-15s %11s %11s %12s %11s %9s %9s %14s\n", "strategy", "EUR/day", "H2 g/day", "fuel cell eff.",
+           "unserved", "starts", "FC hours", "battery kWh");
+    double load_wh = 0.0;
+    double load[DISPATCH_MAX_STAGES];
+    for (int d = 0; d < days; d++) {
+        dispatch_load_day(d, stages, load);
+        for (int k = 0; k < stages; k++) load_wh += load[k] * m->dt_h;
+    }
+    for (int s = 0; s < DISPATCH_STRATEGIES; s++) {
+        DispatchResult sum = { 0 };
+        for (int d = 0; d < days; d++) {
+            const DispatchResult *r = &work->results[d * DISPATCH_STRATEGIES + s];
+            sum.cost += r->cost;
+            sum.fuel_wh += r->fuel_wh;
+            sum.unserved_wh += r->unserved_wh;
+            sum.throughput_wh += r->throughput_wh;
+            sum.on_hours += r->on_hours;
+            sum.stored_wh += r->stored_wh;
+            sum.starts += r->starts;
+        }
+        double h2_g = sum.fuel_wh / 33.3; // 33.3 Wh LHV per gram
+        printf("%-15s %11.3f %11.1f %11.1f%% %8.1f Wh %9.2f %9.2f %14.2f\n", dispatch_names[s], sum.cost / days,
+               h2_g / days, 100.0 * (load_wh - sum.unserved_wh + sum.stored_wh) / sum.fuel_wh, sum.unserved_wh / days,
+               (double)sum.starts / days, sum.on_hours / days, sum.throughput_wh / 1000.0 / days);
+    }
+    printf("\nMean load %.2f kWh/day; fuel cell eff. = served load plus stored energy gained over hydrogen LHV\n"
+           "(battery losses included); stored energy valued at %.3f EUR/kWh\n",
+           load_wh / days / 1000.0, m->stored_value);
+    printf("DP backward pass %.3f ms/day, all strategies %.0f days/s, wall %.2f s\n", work->solve_us * 1e-3 / days,
+           days / wall, wall);
+    g_mutex_clear(&work->lock);
+    g_free(work->results);
+    g_free(work);
+    return 0;
+}
\ No newline at end of file
@@ -1,13 +1,31 @@
 #include "inverter.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// PV source the trackers operate on: the mismatched plant if one is attached, the uniform array otherwise
+double pv_source_current(InverterParams *params, double voltage) {
+    return params->pv_field ? pv_field_current(params->pv_field, voltage) : pv_array_current(params, voltage);
+}
+
+double pv_source_voc(InverterParams *params) {
+    if (params->pv_field) return params->pv_field->array_voc;
+    pv_array_current(params, 0.0); // Rebuilds the cached curve if irradiance, temperature or layout changed
+    return params->pv_curve.voc;
+}
 
 // DC source power calculation
 double dc_source_get_power(AppData *app, double voltage, double *current) {
     // Call dc_source_update to get Vdc and Idc
-    dc_source_update(app);
+    dc_source_update(app, 0.0);
     *current = app->params.dc_current;
     // If voltage is specified (e.g., by MPPT), adjust current accordingly
     if (voltage > 0.0 && app->params.dc_voltage > 0.0) {
-        *current *= voltage / app->params.dc_voltage;
+        if (app->params.dc_source == DC_SOURCE_PV) {
+            *current = pv_source_current(&app->params, voltage); // Follow the I-V curve
+        } else {
+            *current *= voltage / app->params.dc_voltage;
+        }
     }
     return voltage * (*current);
 }
@@ -18,34 +36,49 @@ double pv_model_power(double voltage) {
     return voltage * 10.0; // 10A constant current (simplified)
 }
 
-void mppt_perturb_observe(InverterParams *params) {
-    const double delta_v = 1.0; // Voltage perturbation (V)
-    double power = params->mppt_voltage * params->control_ref_current; // Current power
-    if (power > params->prev_power) {
-        // Moving towards MPP, continue in same direction
-        params->mppt_voltage += (params->mppt_voltage > params->prev_voltage) ? delta_v : -delta_v;
-    } else {
-        // Moving away from MPP, reverse direction
-        params->mppt_voltage += (params->mppt_voltage > params->prev_voltage) ? -delta_v : delta_v;
-    }
-    // Update previous values
+// Power at the voltage applied since the last MPPT call
+static double mppt_measure(InverterParams *params) {
+    params->mppt_state.evaluations++;
+    return params->mppt_voltage * pv_source_current(params, params->mppt_voltage);
+}
+
+static void mppt_limit(InverterParams *params, double voc) {
+    if (params->mppt_voltage < 0.1 * voc) params->mppt_voltage = 0.1 * voc;
+    if (params->mppt_voltage > voc) params->mppt_voltage = voc;
+}
+
+// Perturb and observe: keep the direction while power rises, reverse it when power falls
+static void mppt_hill_climb(InverterParams *params, double power, double voc) {
+    double delta_v = MPPT_STEP * voc;
+    double dv = params->mppt_voltage - params->prev_voltage;
+    double dp = power - params->prev_power;
     params->prev_power = power;
     params->prev_voltage = params->mppt_voltage;
-    // Limit voltage
-    if (params->mppt_voltage < 100.0) params->mppt_voltage = 100.0;
-    if (params->mppt_voltage > 300.0) params->mppt_voltage = 300.0;
+    params->mppt_voltage += (dp >= 0.0) == (dv >= 0.0) ? delta_v : -delta_v;
+    mppt_limit(params, voc);
+}
+
+void mppt_perturb_observe(InverterParams *params) {
+    double voc = pv_source_voc(params);
+    mppt_hill_climb(params, mppt_measure(params), voc);
 }
 
 void mppt_incremental_conductance(InverterParams *params) {
-    const double delta_v = 1.0; // Voltage step
-    double i = params->control_ref_current;
+    double voc = pv_source_voc(params);
+    double delta_v = MPPT_STEP * voc; // Voltage step
     double v = params->mppt_voltage;
-    double delta_i = i - params->prev_power / params->prev_voltage; // Approximate dI
+    if (v < MPPT_MIN_VOLTAGE) {
+        // No conductance to compare at zero voltage (dark array): hold the reference, only clamp it to the range
+        mppt_limit(params, voc);
+        return;
+    }
+    double i = mppt_measure(params) / v;
+    double delta_i = params->prev_voltage > 0.0 ? i - params->prev_power / params->prev_voltage : 0.0; // dI
     double delta_v_actual = v - params->prev_voltage; // dV
-    if (fabs(delta_v_actual) > 0.01) {
+    if (fabs(delta_v_actual) > 1e-9) {
         double g_inc = delta_i / delta_v_actual; // Incremental conductance
         double g = i / v; // Conductance
-        if (fabs(g_inc + g) < 0.01) {
+        if (fabs(g_inc + g) < 0.01 * g) {
             // At MPP
         } else if (g_inc + g > 0) {
             // Left of MPP
@@ -54,14 +87,417 @@ void mppt_incremental_conductance(InverterParams *params) {
             // Right of MPP
             params->mppt_voltage -= delta_v;
         }
-    } else {
-        // Small voltage change, perturb
-        params->mppt_voltage += delta_v;
+    } else if (fabs(delta_i) > 1e-9) {
+        // Irradiance changed at constant voltage
+        params->mppt_voltage += delta_i > 0.0 ? delta_v : -delta_v;
     }
     // Update previous values
     params->prev_power = i * v;
     params->prev_voltage = v;
-    // Limit voltage
-    if (params->mppt_voltage < 100.0) params->mppt_voltage = 100.0;
-    if (params->mppt_voltage > 300.0) params->mppt_voltage = 300.0;
+    mppt_limit(params, voc);
+}
+
+// Global searches: every MPPT_SCAN_INTERVAL the tracker leaves perturb and observe, applies one search point per
+// call, jumps to the best point found and hill-climbs from there. Each call measures the point applied last.
+
+static gboolean mppt_search_due(const InverterParams *params) {
+    const MPPTState *s = &params->mppt_state;
+    return s->searches == 0 || params->sim_time - s->last_search >= MPPT_SCAN_INTERVAL;
+}
+
+static void mppt_search_begin(InverterParams *params) {
+    MPPTState *s = &params->mppt_state;
+    s->searching = TRUE;
+    s->step = 0;
+    s->best_p = -1.0;
+    s->last_search = params->sim_time;
+    s->searches++;
+}
+
+static void mppt_search_record(MPPTState *s, double v, double p) {
+    if (p > s->best_p) {
+        s->best_p = p;
+        s->best_v = v;
+    }
+}
+
+static void mppt_search_apply(InverterParams *params, double v) {
+    params->mppt_voltage = v;
+    params->mppt_state.step++;
+    params->mppt_state.search_evaluations++;
+}
+
+static void mppt_search_end(InverterParams *params) {
+    MPPTState *s = &params->mppt_state;
+    s->searching = FALSE;
+    params->mppt_voltage = s->best_v;
+    params->prev_voltage = s->best_v; // Hill climbing restarts upwards from the best point
+    params->prev_power = s->best_p;
+}
+
+// Periodic sweep: evenly spaced points from 10% to 95% of the open-circuit voltage
+void mppt_sweep(InverterParams *params) {
+    MPPTState *s = &params->mppt_state;
+    double voc = pv_source_voc(params);
+    double power = mppt_measure(params);
+    if (s->searching) {
+        mppt_search_record(s, params->mppt_voltage, power);
+        if (s->step == MPPT_SWEEP_POINTS) {
+            mppt_search_end(params);
+            return;
+        }
+    } else if (mppt_search_due(params)) {
+        mppt_search_begin(params);
+    } else {
+        mppt_hill_climb(params, power, voc);
+        return;
+    }
+    mppt_search_apply(params, voc * (0.1 + 0.85 * s->step / (MPPT_SWEEP_POINTS - 1)));
+}
+
+static double mppt_random(MPPTState *s) {
+    s->rng ^= s->rng << 13;
+    s->rng ^= s->rng >> 17;
+    s->rng ^= s->rng << 5;
+    return (s->rng >> 8) / 16777216.0; // 0 to 1
+}
+
+// Particle swarm: particles start evenly spread and are evaluated one per call; a generation moves them
+// towards their own and the swarm's best point. The search ends after MPPT_PSO_GENERATIONS or once the
+// swarm has collapsed to within two perturbation steps.
+void mppt_pso(InverterParams *params) {
+    const double inertia = 0.4, c_personal = 1.2, c_global = 1.6;
+    MPPTState *s = &params->mppt_state;
+    double voc = pv_source_voc(params);
+    double power = mppt_measure(params);
+    if (s->searching) {
+        int particle = (s->step - 1) % MPPT_SWARM;
+        mppt_search_record(s, params->mppt_voltage, power);
+        if (power > s->personal_p[particle]) {
+            s->personal_p[particle] = power;
+            s->personal_v[particle] = params->mppt_voltage;
+        }
+        if (particle == MPPT_SWARM - 1) {
+            double lo = voc, hi = 0.0;
+            for (int i = 0; i < MPPT_SWARM; i++) {
+                lo = fmin(lo, s->position[i]);
+                hi = fmax(hi, s->position[i]);
+            }
+            if (s->step / MPPT_SWARM == MPPT_PSO_GENERATIONS || hi - lo < 2.0 * MPPT_STEP * voc) {
+                mppt_search_end(params);
+                return;
+            }
+            for (int i = 0; i < MPPT_SWARM; i++) {
+                s->velocity[i] = inertia * s->velocity[i] +
+                                 c_personal * mppt_random(s) * (s->personal_v[i] - s->position[i]) +
+                                 c_global * mppt_random(s) * (s->best_v - s->position[i]);
+                s->position[i] = fmin(fmax(s->position[i] + s->velocity[i], 0.1 * voc), 0.95 * voc);
+            }
+        }
+    } else if (mppt_search_due(params)) {
+        mppt_search_begin(params);
+        if (s->rng == 0) s->rng = 0x9E3779B9u;
+        for (int i = 0; i < MPPT_SWARM; i++) {
+            s->position[i] = voc * (0.1 + 0.85 * (i + 0.5) / MPPT_SWARM);
+            s->velocity[i] = 0.0;
+            s->personal_p[i] = -1.0;
+        }
+    } else {
+        mppt_hill_climb(params, power, voc);
+        return;
+    }
+    mppt_search_apply(params, s->position[s->step % MPPT_SWARM]);
+}
+
+// Golden section: a coarse scan picks the best of MPPT_GOLDEN_SEGMENTS segments, and golden-section steps
+// (the limit of Fibonacci search) shrink the bracket around it to two perturbation steps
+void mppt_golden(InverterParams *params) {
+    const double phi = 0.6180339887498949; // (sqrt(5) - 1) / 2
+    MPPTState *s = &params->mppt_state;
+    double voc = pv_source_voc(params);
+    double width = 0.85 * voc / MPPT_GOLDEN_SEGMENTS;
+    double power = mppt_measure(params);
+    if (!s->searching) {
+        if (!mppt_search_due(params)) {
+            mppt_hill_climb(params, power, voc);
+            return;
+        }
+        mppt_search_begin(params);
+        mppt_search_apply(params, voc * 0.1 + width * 0.5);
+        return;
+    }
+
+    mppt_search_record(s, params->mppt_voltage, power);
+    if (s->step < MPPT_GOLDEN_SEGMENTS) {
+        mppt_search_apply(params, voc * 0.1 + width * (s->step + 0.5));
+        return;
+    }
+    if (s->step == MPPT_GOLDEN_SEGMENTS) { // Coarse scan done: bracket the best segment
+        s->lo = fmax(s->best_v - width, 0.1 * voc);
+        s->hi = fmin(s->best_v + width, voc);
+        s->x1 = s->hi - phi * (s->hi - s->lo);
+        s->x2 = s->lo + phi * (s->hi - s->lo);
+        mppt_search_apply(params, s->x1);
+        return;
+    }
+    if (params->mppt_voltage == s->x1) s->p1 = power;
+    else s->p2 = power;
+    if (s->step == MPPT_GOLDEN_SEGMENTS + 1) {
+        mppt_search_apply(params, s->x2);
+        return;
+    }
+    double next; // Interior point to measure
+    if (s->p1 > s->p2) {
+        s->hi = s->x2;
+        s->x2 = s->x1;
+        s->p2 = s->p1;
+        s->x1 = next = s->hi - phi * (s->hi - s->lo);
+    } else {
+        s->lo = s->x1;
+        s->x1 = s->x2;
+        s->p1 = s->p2;
+        s->x2 = next = s->lo + phi * (s->hi - s->lo);
+    }
+    if (s->hi - s->lo < 2.0 * MPPT_STEP * voc) {
+        mppt_search_end(params);
+        return;
+    }
+    mppt_search_apply(params, next);
+}
+
+void mppt_update(InverterParams *params) {
+    switch (params->mppt) {
+        case MPPT_PERTURB_OBSERVE:
+            mppt_perturb_observe(params);
+            break;
+        case MPPT_INCREMENTAL_CONDUCTANCE:
+            mppt_incremental_conductance(params);
+            break;
+        case MPPT_SWEEP:
+            mppt_sweep(params);
+            break;
+        case MPPT_PSO:
+            mppt_pso(params);
+            break;
+        case MPPT_GOLDEN:
+            mppt_golden(params);
+            break;
+        case MPPT_NONE:
+            break;
+    }
+}
+
+
+// EN 50530-style dynamic MPPT efficiency benchmark
+// Irradiance ramps between two levels (10-50% and 30-100% of STC) at the standard slopes, each ramp
+// repeated twice with dwell times, on a mismatched plant with uniform irradiance and under a row shadow
+// that leaves two substrings of half the modules at 40% of the irradiance, which puts a local power peak
+// near the open-circuit voltage and the global one at about two thirds of it. Every profile runs on its own
+// thread with all trackers side by side on the same curve, sampled at the MPPT rate.
+
+#define MPPT_BENCH_PERIOD 0.1 // MPPT call interval (s)
+#define MPPT_BENCH_DWELL 10.0 // Dwell at each irradiance level (s)
+#define MPPT_BENCH_REPEATS 2
+#define MPPT_BENCH_G_STEP 2.0 // Irradiance resolution of the plant curve (W/m²)
+
+static const struct {
+    const char *name;
+    MPPTType mppt;
+} mppt_bench_trackers[] = {
+    { "P&O", MPPT_PERTURB_OBSERVE },
+    { "IncCond", MPPT_INCREMENTAL_CONDUCTANCE },
+    { "Sweep", MPPT_SWEEP },
+    { "PSO", MPPT_PSO },
+    { "Golden", MPPT_GOLDEN },
+};
+#define MPPT_BENCH_TRACKERS (int)(sizeof(mppt_bench_trackers) / sizeof(mppt_bench_trackers[0]))
+
+static const struct {
+    double low, high; // Irradiance levels (W/m²)
+    double slope; // Ramp slope (W/m² per s)
+} mppt_bench_profiles[] = {
+    { 100.0, 500.0, 0.5 }, { 100.0, 500.0, 1.0 }, { 100.0, 500.0, 2.0 }, { 100.0, 500.0, 3.0 }, { 100.0, 500.0, 5.0 },
+    { 300.0, 1000.0, 10.0 }, { 300.0, 1000.0, 14.0 }, { 300.0, 1000.0, 20.0 }, { 300.0, 1000.0, 30.0 },
+    { 300.0, 1000.0, 50.0 }, { 300.0, 1000.0, 100.0 },
+};
+#define MPPT_BENCH_PROFILES (int)(sizeof(mppt_bench_profiles) / sizeof(mppt_bench_profiles[0]))
+
+typedef struct {
+    int strings, modules;
+    double energy[2][MPPT_BENCH_PROFILES][MPPT_BENCH_TRACKERS]; // Harvested energy per shading case (J)
+    double energy_mpp[2][MPPT_BENCH_PROFILES]; // Energy at the true MPP (J)
+    MPPTState state[2][MPPT_BENCH_PROFILES][MPPT_BENCH_TRACKERS]; // Tracker counters at the end of the run
+} MPPTBenchWork;
+
+// Sets the plant irradiance with the fixed per-module mismatch and the optional row shadow
+static void mppt_bench_irradiance(PVField *field, double g, gboolean shaded) {
+    guint32 rng = 0x5EED1234u;
+    for (int m = 0; m < field->strings * field->modules; m++) {
+        rng ^= rng << 13;
+        rng ^= rng >> 17;
+        rng ^= rng << 5;
+        double mismatch = 1.0 + 0.02 * ((rng >> 8) / 16777216.0 * 2.0 - 1.0); // +-2%
+        for (int j = 0; j < PV_SUBSTRINGS; j++) field->irradiance[m * PV_SUBSTRINGS + j] = g * mismatch;
+        if (shaded && m % field->modules < field->modules / 2) {
+            field->irradiance[m * PV_SUBSTRINGS] = field->irradiance[m * PV_SUBSTRINGS + 1] = 0.4 * g;
+        }
+    }
+}
+
+// True maximum power of the last pv_field_update: best curve sample refined by golden section
+static double mppt_bench_pmax(const PVField *field) {
+    int best = 0;
+    for (int j = 1; j < PV_FIELD_POINTS; j++) {
+        if (field->array_v[j] * field->array_i[j] > field->array_v[best] * field->array_i[best]) best = j;
+    }
+    double step = field->array_voc / (PV_FIELD_POINTS - 1);
+    double lo = fmax(field->array_v[best] - step, 0.0), hi = fmin(field->array_v[best] + step, field->array_voc);
+    for (int iter = 0; iter < 40; iter++) {
+        double x1 = hi - 0.6180339887498949 * (hi - lo), x2 = lo + 0.6180339887498949 * (hi - lo);
+        if (x1 * pv_field_current(field, x1) > x2 * pv_field_current(field, x2)) hi = x2;
+        else lo = x1;
+    }
+    double v = 0.5 * (lo + hi);
+    return v * pv_field_current(field, v);
+}
+
+static double mppt_bench_irradiance_at(int profile, double t) {
+    double low = mppt_bench_profiles[profile].low, high = mppt_bench_profiles[profile].high;
+    double ramp = (high - low) / mppt_bench_profiles[profile].slope;
+    double cycle = 2.0 * (MPPT_BENCH_DWELL + ramp);
+    double u = fmod(t, cycle);
+    if (u < MPPT_BENCH_DWELL) return low;
+    u -= MPPT_BENCH_DWELL;
+    if (u < ramp) return low + (high - low) * u / ramp;
+    u -= ramp;
+    if (u < MPPT_BENCH_DWELL) return high;
+    return high - (high - low) * (u - MPPT_BENCH_DWELL) / ramp;
+}
+
+static void mppt_bench_task(int n, gpointer data) {
+    MPPTBenchWork *work = (MPPTBenchWork *)data;
+    int shaded = n / MPPT_BENCH_PROFILES, profile = n % MPPT_BENCH_PROFILES;
+    PVField *field = pv_field_new(work->strings, work->modules);
+    for (int m = 0; m < work->strings * work->modules; m++) field->temperature[m] = PV_TREF;
+    InverterParams *trackers = g_new(InverterParams, MPPT_BENCH_TRACKERS);
+
+    double ramp = (mppt_bench_profiles[profile].high - mppt_bench_profiles[profile].low) /
+                  mppt_bench_profiles[profile].slope;
+    double duration = MPPT_BENCH_REPEATS * 2.0 * (MPPT_BENCH_DWELL + ramp) + MPPT_BENCH_DWELL;
+    int steps = (int)round(duration / MPPT_BENCH_PERIOD);
+    double g_curve = -1.0, p_max = 0.0;
+    for (int k = 0; k <= steps; k++) {
+        double t = k * MPPT_BENCH_PERIOD;
+        double g = round(mppt_bench_irradiance_at(profile, t) / MPPT_BENCH_G_STEP) * MPPT_BENCH_G_STEP;
+        if (g != g_curve) {
+            mppt_bench_irradiance(field, g, shaded);
+            pv_field_update(field);
+            p_max = mppt_bench_pmax(field);
+            g_curve = g;
+        }
+        if (k == 0) {
+            for (int a = 0; a < MPPT_BENCH_TRACKERS; a++) {
+                inverter_init(&trackers[a]);
+                trackers[a].pv_field = field;
+                trackers[a].mppt = mppt_bench_trackers[a].mppt;
+                trackers[a].mppt_voltage = 0.8 * field->array_voc;
+                trackers[a].prev_voltage = trackers[a].mppt_voltage;
+            }
+            continue;
+        }
+        // Energy of the period just ended at the voltage each tracker applied, then its next decision
+        work->energy_mpp[shaded][profile] += p_max * MPPT_BENCH_PERIOD;
+        for (int a = 0; a < MPPT_BENCH_TRACKERS; a++) {
+            InverterParams *p = &trackers[a];
+            work->energy[shaded][profile][a] += p->mppt_voltage * pv_field_current(field, p->mppt_voltage) * MPPT_BENCH_PERIOD;
+            p->sim_time = t;
+            mppt_update(p);
+        }
+    }
+    for (int a = 0; a < MPPT_BENCH_TRACKERS; a++) work->state[shaded][profile][a] = trackers[a].mppt_state;
+    g_free(trackers);
+    pv_field_free(field);
+}
+
+// CPU cost of one tracker decision on a frozen shaded curve, timed as a whole loop
+static double mppt_bench_decision_ns(const PVField *field, MPPTType mppt) {
+    InverterParams p;
+    inverter_init(&p);
+    p.pv_field = field;
+    p.mppt = mppt;
+    p.mppt_voltage = 0.8 * field->array_voc;
+    const int calls = 200000;
+    gint64 start = g_get_monotonic_time();
+    for (int k = 1; k <= calls; k++) {
+        p.sim_time = k * MPPT_BENCH_PERIOD;
+        mppt_update(&p);
+    }
+    return (g_get_monotonic_time() - start) * 1e3 / calls;
+}
+
+// Headless mode: --mppt-bench [strings] [modules per string]
+int mppt_bench_main(int argc, char *argv[]) {
+    MPPTBenchWork *work = g_new0(MPPTBenchWork, 1);
+    work->strings = argc > 2 ? atoi(argv[2]) : 3;
+    work->modules = argc > 3 ? atoi(argv[3]) : 12;
+    if (work->strings < 1 || work->modules < 2) {
+        fprintf(stderr, "[Error] MPPT bench: need at least 1 string of 2 modules\n");
+        g_free(work);
+        return 1;
+    }
+
+    int tasks = 2 * MPPT_BENCH_PROFILES;
+    int n_threads = (int)g_get_num_processors();
+    if (n_threads > tasks) n_threads = tasks;
+    printf("MPPT benchmark: %d x %d module plant, EN 50530-style ramps, MPPT at %.0f Hz, %d profiles on %d threads\n",
+           work->strings, work->modules, 1.0 / MPPT_BENCH_PERIOD, tasks, n_threads);
+    gint64 start = g_get_monotonic_time();
+    parallel_for(tasks, mppt_bench_task, work);
+    double wall = (g_get_monotonic_time() - start) * 1e-6;
+
+    static const char *cases[2] = { "uniform irradiance", "row shadow on half the modules (two substrings at 40%)" };
+    for (int c = 0; c < 2; c++) {
+        printf("\nDynamic MPPT efficiency (%%), %s\n%-22s", cases[c], "profile");
+        for (int a = 0; a < MPPT_BENCH_TRACKERS; a++) printf(" %8s", mppt_bench_trackers[a].name);
+        printf("\n");
+        for (int pr = 0; pr < MPPT_BENCH_PROFILES; pr++) {
+            char name[32];
+            snprintf(name, sizeof(name), "%.0f-%.0f @ %g W/m2/s", mppt_bench_profiles[pr].low,
+                     mppt_bench_profiles[pr].high, mppt_bench_profiles[pr].slope);
+            printf("%-22s", name);
+            for (int a = 0; a < MPPT_BENCH_TRACKERS; a++) {
+                printf(" %8.2f", work->energy[c][pr][a] / work->energy_mpp[c][pr] * 100);
+            }
+            printf("\n");
+        }
+    }
+
+    // Cost per decision on the shaded plant at 800 W/m²
+    PVField *field = pv_field_new(work->strings, work->modules);
+    mppt_bench_irradiance(field, 800.0, TRUE);
+    pv_field_update(field);
+    printf("\n%-9s %10s %10s %12s %12s %14s %16s\n", "tracker", "eta unif.", "eta shaded", "ns/decision",
+           "points/scan", "scan share", "MWh per CPU-s");
+    for (int a = 0; a < MPPT_BENCH_TRACKERS; a++) {
+        double e[2] = { 0.0, 0.0 }, e_mpp[2] = { 0.0, 0.0 };
+        long evaluations = 0, searches = 0, search_evaluations = 0;
+        for (int c = 0; c < 2; c++) {
+            for (int pr = 0; pr < MPPT_BENCH_PROFILES; pr++) {
+                e[c] += work->energy[c][pr][a];
+                e_mpp[c] += work->energy_mpp[c][pr];
+                evaluations += work->state[c][pr][a].evaluations;
+                searches += work->state[c][pr][a].searches;
+                search_evaluations += work->state[c][pr][a].search_evaluations;
+            }
+        }
+        double ns = mppt_bench_decision_ns(field, mppt_bench_trackers[a].mppt);
+        double cpu = evaluations * ns * 1e-9; // Tracker CPU time over all profiles (s)
+        printf("%-9s %9.2f%% %9.2f%% %12.1f %12.1f %13.1f%% %16.1f\n", mppt_bench_trackers[a].name, e[0] / e_mpp[0] * 100,
+               e[1] / e_mpp[1] * 100, ns, searches ? (double)search_evaluations / searches : 1.0,
+               evaluations ? 100.0 * search_evaluations / evaluations : 0.0, (e[0] + e[1]) / 3.6e9 / cpu);
+    }
+    printf("\nWall %.2f s\n", wall);
+    pv_field_free(field);
+    g_free(work);
+    return 0;
 }
\ No newline at end of file
@@ -2,7 +2,7 @@
 
 void npc_inverter_output(InverterParams *params, double time, double *output) {
     double peak_voltage = params->voltage * sqrt(2); // Convert RMS to peak
-    double angle = fmod(2 * M_PI * params->frequency * time + params->phase, 2 * M_PI);
+    double angle = fmod(timebase_angle(params->frequency, time) + params->phase, 2 * M_PI);
     // 3-level NPC: -V, 0, +V
     double level;
     if (angle < M_PI / 3 || angle >= 5 * M_PI / 3) {
@@ -19,7 +19,7 @@ void npc_inverter_output(InverterParams *params, double time, double *output) {
 
 void flying_capacitor_output(InverterParams *params, double time, double *output) {
     double peak_voltage = params->voltage * sqrt(2); // Convert RMS to peak
-    double angle = fmod(2 * M_PI * params->frequency * time + params->phase, 2 * M_PI);
+    double angle = fmod(timebase_angle(params->frequency, time) + params->phase, 2 * M_PI);
     // 5-level Flying Capacitor: -V, -V/2, 0, V/2, V
     double level;
     if (angle < M_PI / 5 || angle >= 9 * M_PI / 5) {
@@ -43,7 +43,7 @@ void cascaded_h_bridge_output(InverterParams *params, double time, double *outpu
     // 3-level per phase for simplicity (can be extended to more levels)
     double angles[3] = {params->phase, params->phase + 2 * M_PI / 3, params->phase + 4 * M_PI / 3};
     for (int i = 0; i < 3; i++) {
-        double angle = fmod(2 * M_PI * params->frequency * time + angles[i], 2 * M_PI);
+        double angle = fmod(timebase_angle(params->frequency, time) + angles[i], 2 * M_PI);
         if (angle < M_PI / 3 || angle >= 5 * M_PI / 3) {
             output[i] = -peak_voltage;
         } else if (angle >= 2 * M_PI / 3 && angle < 4 * M_PI / 3) {
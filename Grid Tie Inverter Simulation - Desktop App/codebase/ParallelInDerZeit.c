@@ -0,0 +1,286 @@
+#include "inverter.h"
+#include <math.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// Parallel-in-time (Parareal) integration of one long scenario
+// The run is cut into time slices. A cheap coarse propagator G sweeps sequentially,
+// the accurate fine propagator F (the adaptive step used by simulation_update) runs on
+// all slices in parallel, and the slice start states are corrected with
+// U[n+1] = G(U_new[n]) + F(U_old[n]) - G(U_old[n]) until they settle.
+// G is a cycle-averaged (envelope) model of the switching simulation: it steps the
+// model over a few fundamental periods only and extrapolates the per-period change of
+// the states over the rest of the slice. States a whole number of periods apart sit at
+// the same point of the 50 Hz waveform, so the extrapolation follows the cycle average
+// and not the ripple. The stepped periods resolve the fundamental with fixed steps
+// and sample the PLL on that step instead of the 20 kHz pll_update rate; lock flags
+// come from F anyway.
+
+#define PARAREAL_COARSE_STEP 5e-4 // Coarse step (s): 40 steps per 50 Hz period
+#define PARAREAL_ENVELOPE_PERIODS 25 // Periods an envelope block steps before it extrapolates
+#define PARAREAL_ENVELOPE_DRIFT 5 // Last periods of a block whose change is extrapolated
+#define PARAREAL_ENVELOPE_SKIP 100 // Most periods one envelope block extrapolates
+#define PARAREAL_FINE_STEP 1e-5 // Headless mode: max_dt of the fine propagator (s)
+#define PARAREAL_TOLERANCE 1e-6 // Relative change of the slice states at convergence
+
+typedef struct {
+    size_t offset; // Offset of a double inside InverterParams
+    gboolean angle; // Wrapped angle: corrections taken modulo 2*pi
+    int count; // Consecutive doubles (arrays of lane states)
+} StateField;
+
+// Continuous states corrected by Parareal. Discrete states (zero-crossing counters,
+// lock flags, generator state) are taken from the fine solution.
+static const StateField state_fields[] = {
+    { offsetof(InverterParams, frequency), FALSE, 1 },
+    { offsetof(InverterParams, mppt_voltage), FALSE, 1 },
+    { offsetof(InverterParams, prev_power), FALSE, 1 },
+    { offsetof(InverterParams, prev_voltage), FALSE, 1 },
+    { offsetof(InverterParams, pll_phase), TRUE, 1 },
+    { offsetof(InverterParams, pll_frequency), FALSE, 1 },
+    { offsetof(InverterParams, pll_voltage), FALSE, 1 },
+    { offsetof(InverterParams, pll_pi.s1), FALSE, 1 },
+    { offsetof(InverterParams, pll_angle), TRUE, 1 },
+    { offsetof(InverterParams, pll_sogi), FALSE, 4 },
+    { offsetof(InverterParams, pll_sogi_input), FALSE, 2 },
+    { offsetof(InverterParams, pll_sequence), FALSE, 4 },
+    { offsetof(InverterParams, control_output), FALSE, 1 },
+    { offsetof(InverterParams, current_pi.s1), FALSE, 1 },
+    { offsetof(InverterParams, current_pi_q.s1), FALSE, 1 },
+    { offsetof(InverterParams, control_dq), FALSE, 2 },
+    { offsetof(InverterParams, plant_current_abc), FALSE, 3 },
+    { offsetof(InverterParams, harmonic_bank.s1), FALSE, BIQUAD_BANK_SIZE },
+    { offsetof(InverterParams, harmonic_bank.s2), FALSE, BIQUAD_BANK_SIZE },
+    { offsetof(InverterParams, harmonic_output), FALSE, 1 },
+    { offsetof(InverterParams, control_prev_error), FALSE, 1 },
+    { offsetof(InverterParams, plant_current), FALSE, 1 },
+    { offsetof(InverterParams, dc_voltage), FALSE, 1 },
+    { offsetof(InverterParams, dc_current), FALSE, 1 },
+    { offsetof(InverterParams, battery_soc), FALSE, 1 },
+    { offsetof(InverterParams, battery.v1), FALSE, 2 },
+    { offsetof(InverterParams, dc_link_state.inductor_current), FALSE, 3 },
+    { offsetof(InverterParams, island_prev_freq), FALSE, 1 },
+};
+#define N_STATE_FIELDS (sizeof(state_fields) / sizeof(state_fields[0]))
+
+static double *state_field(InverterParams *p, int i, int j) {
+    return (double *)((char *)p + state_fields[i].offset) + j;
+}
+
+static double wrap_angle(double a) {
+    a = fmod(a + M_PI, 2 * M_PI);
+    if (a < 0) a += 2 * M_PI;
+    return a - M_PI;
+}
+
+typedef struct {
+    AppData start; // U[n]: slice start state
+    AppData fine; // F(U[n])
+    AppData coarse; // G(U[n])
+    double t_end; // Slice end time (s)
+} PararealSlice;
+
+// Fine propagator: the same adaptive stepping as the interactive run
+static void propagate_fine(AppData *app, double t_end) {
+    while (app->params.sim_time < t_end - 1e-12) {
+        double dt = calculate_time_step(app);
+        if (app->params.sim_time + dt > t_end) {
+            dt = t_end - app->params.sim_time;
+        }
+        simulation_step(app, dt);
+    }
+    timebase_reset(&app->params, t_end); // Align slice boundaries exactly
+}
+
+// Fixed steps that still resolve the fundamental (never finer than the fine run)
+static void step_coarse(AppData *app, double t_end) {
+    double span = t_end - app->params.sim_time;
+    int steps = (int)ceil(span / fmax(PARAREAL_COARSE_STEP, app->params.max_dt));
+    if (steps < 1) steps = 1;
+    double dt = span / steps;
+    double sample_time = app->params.pll_sample_time;
+    app->params.pll_sample_time = fmax(dt, sample_time);
+    for (int k = 0; k < steps; k++) {
+        simulation_step(app, dt);
+    }
+    app->params.pll_sample_time = sample_time;
+    timebase_reset(&app->params, t_end);
+}
+
+// One envelope block: PARAREAL_ENVELOPE_PERIODS periods are stepped so that the transient at the block
+// start decays, and the change over the last of them is extrapolated over `skipped` further periods
+static void envelope_block(AppData *app, double period, int skipped) {
+    double t0 = app->params.sim_time;
+    step_coarse(app, t0 + (PARAREAL_ENVELOPE_PERIODS - PARAREAL_ENVELOPE_DRIFT) * period);
+    InverterParams before = app->params;
+    step_coarse(app, t0 + PARAREAL_ENVELOPE_PERIODS * period);
+    double pll_estimate = timebase_angle(app->params.pll_frequency, app->params.sim_time) + app->params.pll_phase;
+    for (int i = 0; i < (int)N_STATE_FIELDS; i++) {
+        for (int j = 0; j < state_fields[i].count; j++) {
+            double *x = state_field(&app->params, i, j);
+            double drift = *x - *state_field(&before, i, j);
+            *x += skipped * (state_fields[i].angle ? wrap_angle(drift) : drift) / PARAREAL_ENVELOPE_DRIFT;
+            if (state_fields[i].angle) *x = wrap_angle(*x);
+        }
+    }
+    timebase_reset(&app->params, t0 + (PARAREAL_ENVELOPE_PERIODS + skipped) * period);
+    // The grid angle estimate sits at the same point of the waveform whole periods later; pll_phase is
+    // only its offset from the PLL's own frequency and moves with the extrapolated frequency
+    app->params.pll_phase = wrap_angle(pll_estimate - timebase_angle(app->params.pll_frequency, app->params.sim_time));
+}
+
+// Coarse propagator: envelope blocks over the whole periods of the slice, each extrapolating a bounded
+// number of periods so that what is left of a transient is not amplified without limit. The last
+// 25 to 50 periods before t_end are stepped, so the slice ends on the settled waveform of the model
+// and not on an extrapolated state
+static void propagate_coarse(AppData *app, double t_end) {
+    double period = 1.0 / app->params.frequency;
+    int periods;
+    while ((periods = (int)floor((t_end - app->params.sim_time) / period + 1e-9)) > 2 * PARAREAL_ENVELOPE_PERIODS) {
+        int skipped = periods - 2 * PARAREAL_ENVELOPE_PERIODS;
+        envelope_block(app, period, skipped < PARAREAL_ENVELOPE_SKIP ? skipped : PARAREAL_ENVELOPE_SKIP);
+    }
+    step_coarse(app, t_end);
+}
+
+static void fine_task(int task, gpointer data) {
+    PararealSlice *slice = (PararealSlice *)data + task;
+    slice->fine = slice->start;
+    propagate_fine(&slice->fine, slice->t_end);
+}
+
+static void run_fine_parallel(PararealSlice *slices, int first, int last) {
+    parallel_for(last - first, fine_task, slices + first);
+}
+
+// Start of slice n+1 from the fine result corrected by the coarse difference.
+// Returns the largest relative change of the corrected states.
+static double parareal_correct(AppData *next_start, const AppData *fine, const AppData *coarse_new,
+                               const AppData *coarse_old) {
+    double change = 0.0;
+    AppData corrected = *fine;
+    for (int i = 0; i < (int)N_STATE_FIELDS; i++) {
+        for (int j = 0; j < state_fields[i].count; j++) {
+            double f = *state_field((InverterParams *)&fine->params, i, j);
+            double g_new = *state_field((InverterParams *)&coarse_new->params, i, j);
+            double g_old = *state_field((InverterParams *)&coarse_old->params, i, j);
+            double delta = state_fields[i].angle ? wrap_angle(f - g_old) : f - g_old;
+            double value = g_new + delta;
+            double prev = *state_field(&next_start->params, i, j);
+            double diff = state_fields[i].angle ? wrap_angle(value - prev) : value - prev;
+            double rel = fabs(diff) / fmax(1.0, fabs(value));
+            if (rel > change) change = rel;
+            *state_field(&corrected.params, i, j) = value;
+        }
+    }
+    *next_start = corrected;
+    return change;
+}
+
+gboolean parareal_run(AppData *app, double t_end, int slices, int *iterations) {
+    *iterations = 0;
+    double t0 = app->params.sim_time;
+    if (slices < 1 || t_end <= t0) {
+        return FALSE;
+    }
+    PararealSlice *s = g_new0(PararealSlice, slices);
+    AppData *end_state = g_new(AppData, 1);
+
+    // Initial coarse sweep provides the first slice start states
+    s[0].start = *app;
+    for (int n = 0; n < slices; n++) {
+        s[n].t_end = t0 + (t_end - t0) * (n + 1) / slices;
+        s[n].coarse = s[n].start;
+        propagate_coarse(&s[n].coarse, s[n].t_end);
+        if (n + 1 < slices) s[n + 1].start = s[n].coarse;
+    }
+    *end_state = s[slices - 1].coarse;
+
+    gboolean converged = FALSE;
+    for (int k = 0; k < slices && !converged; k++) {
+        // Slices before k are already exact; refine the rest in parallel
+        run_fine_parallel(s, k, slices);
+        (*iterations)++;
+
+        double change = 0.0;
+        AppData *next = (k + 1 < slices) ? &s[k + 1].start : end_state;
+        *next = s[k].fine; // Slice k started from the exact state, so its end is exact
+        for (int n = k + 1; n < slices; n++) {
+            AppData coarse_new = s[n].start;
+            propagate_coarse(&coarse_new, s[n].t_end);
+            AppData *target = (n + 1 < slices) ? &s[n + 1].start : end_state;
+            double c = parareal_correct(target, &s[n].fine, &coarse_new, &s[n].coarse);
+            if (c > change) change = c;
+            s[n].coarse = coarse_new;
+        }
+        converged = (change < PARAREAL_TOLERANCE);
+    }
+
+    app->params = end_state->params;
+    g_free(end_state);
+    g_free(s);
+    return converged;
+}
+
+// Headless mode: --parareal <seconds> [slices] [compare]
+int parareal_main(int argc, char *argv[]) {
+    double t_end = argc > 2 ? atof(argv[2]) : 60.0;
+    int slices = argc > 3 ? atoi(argv[3]) : (int)g_get_num_processors();
+    gboolean compare = argc > 4;
+
+    AppData app = {0};
+    inverter_init(&app.params);
+    app.params.running = TRUE;
+    app.params.control = CONTROL_PI;
+    app.params.pll_enabled = TRUE;
+    app.params.max_dt = PARAREAL_FINE_STEP;
+    AppData reference = app;
+
+    gint64 start = g_get_monotonic_time();
+    int iterations;
+    gboolean converged = parareal_run(&app, t_end, slices, &iterations);
+    double parareal_s = (g_get_monotonic_time() - start) / 1e6;
+    printf("Parareal: %.1f s simulated, fine step %g s, coarse step %g s, %d slices, %d iterations (%s), %.3f s wall\n",
+           t_end, PARAREAL_FINE_STEP, PARAREAL_COARSE_STEP, slices, iterations,
+           converged ? "converged" : "not converged", parareal_s);
+
+    if (compare) {
+        // Sequential fine run over the same slice boundaries
+        start = g_get_monotonic_time();
+        double t0 = reference.params.sim_time;
+        for (int n = 0; n < slices; n++) {
+            propagate_fine(&reference, t0 + (t_end - t0) * (n + 1) / slices);
+        }
+        double serial_s = (g_get_monotonic_time() - start) / 1e6;
+        double max_err = 0.0;
+        for (int i = 0; i < (int)N_STATE_FIELDS; i++) {
+            for (int j = 0; j < state_fields[i].count; j++) {
+                double a = *state_field(&app.params, i, j);
+                double b = *state_field(&reference.params, i, j);
+                double d = state_fields[i].angle ? wrap_angle(a - b) : a - b;
+                max_err = fmax(max_err, fabs(d) / fmax(1.0, fabs(b)));
+            }
+        }
+        printf("Sequential: %.3f s wall, speed-up %.2fx, max relative state error %.3e\n",
+               serial_s, serial_s / parareal_s, max_err);
+
+        // Best case with one core per slice: K fine slices in a row plus K + 1 coarse sweeps
+        AppData coarse = app; // Any state: the cost of a sweep does not depend on it
+        timebase_reset(&coarse.params, t0);
+        start = g_get_monotonic_time();
+        for (int n = 0; n < slices; n++) {
+            propagate_coarse(&coarse, t0 + (t_end - t0) * (n + 1) / slices);
+        }
+        double coarse_s = (g_get_monotonic_time() - start) / 1e6;
+        if (iterations >= slices) {
+            printf("No speed-up on any core count: %d iterations for %d slices is the sequential run plus the coarse sweeps\n",
+                   iterations, slices);
+        } else {
+            printf("Coarse sweep %.3f s (%.0fx cheaper than fine); best case on %d cores: speed-up %.2fx\n", coarse_s,
+                   serial_s / coarse_s, slices,
+                   serial_s / (iterations * serial_s / slices + (iterations + 1) * coarse_s));
+        }
+    }
+    return converged ? 0 : 1;
+}
\ No newline at end of file
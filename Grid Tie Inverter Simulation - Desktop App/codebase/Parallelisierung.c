@@ -0,0 +1,40 @@
+#include "inverter.h"
+
+// Shared worker pool of the headless benches
+// One thread per core (never more than there are tasks) claims task numbers from an
+// atomic counter until all are taken, so long and short tasks balance themselves.
+// With a single thread the tasks run on the caller's thread.
+
+typedef struct {
+    ParallelTask fn;
+    gpointer data;
+    int tasks;
+    gint next; // Next task to claim
+} ParallelWork;
+
+static gpointer parallel_worker(gpointer data) {
+    ParallelWork *work = (ParallelWork *)data;
+    for (;;) {
+        int n = g_atomic_int_add(&work->next, 1);
+        if (n >= work->tasks) break;
+        work->fn(n, work->data);
+    }
+    return NULL;
+}
+
+void parallel_for(int n_tasks, ParallelTask fn, gpointer data) {
+    ParallelWork work = { fn, data, n_tasks, 0 };
+    int n_threads = (int)g_get_num_processors();
+    if (n_threads > n_tasks) n_threads = n_tasks;
+    if (n_threads <= 1) {
+        parallel_worker(&work);
+        return;
+    }
+    GThread *threads[n_threads];
+    for (int i = 0; i < n_threads; i++) {
+        threads[i] = g_thread_new("parallel-for", parallel_worker, &work);
+    }
+    for (int i = 0; i < n_threads; i++) {
+        g_thread_join(threads[i]);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,274 @@
+#include "inverter.h"
+#include <math.h>
+#include <stdio.h>
+
+// Periodic steady-state solver (shooting method)
+// Finds x* with Phi(x*) = x*, where Phi maps the continuous model state over one
+// fundamental period. Newton iterations on r(x) = Phi(x) - x reuse the LU-factored
+// Jacobian for as long as the residual keeps contracting quickly.
+
+#define SS_MAX_STATES 64
+#define SS_MAX_ITERATIONS 30
+#define SS_TOLERANCE 1e-6
+#define SS_REUSE_CONTRACTION 0.5 // Refresh the Jacobian if |r| shrinks less than this
+
+typedef struct {
+    double *ptr[SS_MAX_STATES]; // State variables inside InverterParams
+    gboolean angle[SS_MAX_STATES]; // Wrapped angle (residual taken modulo 2*pi)
+    int n;
+    gboolean overflow; // More states than SS_MAX_STATES: the rest were not bound
+} PeriodicState;
+
+static void periodic_state_add(PeriodicState *s, double *ptr, gboolean angle) {
+    if (s->n >= SS_MAX_STATES) {
+        s->overflow = TRUE;
+        return;
+    }
+    s->ptr[s->n] = ptr;
+    s->angle[s->n] = angle;
+    s->n++;
+}
+
+// Select the states that actually evolve in the enabled modules.
+// States that stay constant would make the Newton matrix singular.
+static void periodic_state_bind(PeriodicState *s, InverterParams *p) {
+    s->n = 0;
+    s->overflow = FALSE;
+    if (p->pll_enabled) {
+        if (p->pll_type == PLL_PRODUCT) {
+            periodic_state_add(s, &p->pll_phase, TRUE);
+        } else {
+            // Synchronous-frame PLLs integrate the angle itself; the phase offset is derived from it
+            periodic_state_add(s, &p->pll_angle, TRUE);
+            periodic_state_add(s, &p->pll_frequency, FALSE);
+        }
+        periodic_state_add(s, &p->pll_voltage, FALSE);
+        periodic_state_add(s, &p->pll_pi.s1, FALSE);
+        int sogis = p->pll_type == PLL_DSOGI ? 2 : p->pll_type == PLL_SOGI ? 1 : 0;
+        for (int k = 0; k < sogis; k++) {
+            periodic_state_add(s, &p->pll_sogi[k][0], FALSE);
+            periodic_state_add(s, &p->pll_sogi[k][1], FALSE);
+            periodic_state_add(s, &p->pll_sogi_input[k], FALSE);
+        }
+        if (p->pll_type == PLL_DDSRF) {
+            for (int k = 0; k < 2; k++) {
+                periodic_state_add(s, &p->pll_sequence.pos[k], FALSE);
+                periodic_state_add(s, &p->pll_sequence.neg[k], FALSE);
+            }
+        }
+    }
+    if (control_dq_active(p)) {
+        // Three-phase dq path: phase currents and both axis integrators
+        for (int k = 0; k < 3; k++) {
+            periodic_state_add(s, &p->plant_current_abc[k], FALSE);
+        }
+        periodic_state_add(s, &p->current_pi.s1, FALSE);
+        periodic_state_add(s, &p->current_pi_q.s1, FALSE);
+    } else if (p->control != CONTROL_NONE) {
+        periodic_state_add(s, &p->plant_current, FALSE);
+        periodic_state_add(s, &p->control_output, FALSE);
+        if (p->control == CONTROL_PI || p->control == CONTROL_PR) {
+            periodic_state_add(s, &p->current_pi.s1, FALSE);
+            periodic_state_add(s, &p->harmonic_output, FALSE); // Feed-forward and correction of the next step
+        }
+        if (p->control == CONTROL_PR) {
+            // Harmonic bank lanes up to the selected order (lanes above Nyquist decay to zero)
+            int order = p->harmonic_order < HARMONIC_MAX_ORDER ? p->harmonic_order : HARMONIC_MAX_ORDER;
+            for (int lane = 0; 2 * lane + 1 <= order || lane == 0; lane++) {
+                periodic_state_add(s, &p->harmonic_bank.s1[lane], FALSE);
+                periodic_state_add(s, &p->harmonic_bank.s2[lane], FALSE);
+            }
+        } else if (p->control == CONTROL_REPETITIVE) {
+            // The delay line already holds the last period; it is taken from the run, not iterated
+            periodic_state_add(s, &p->harmonic_output, FALSE);
+        } else if (p->control == CONTROL_SMC) {
+            periodic_state_add(s, &p->control_prev_error, FALSE);
+        }
+    }
+}
+
+static double wrap_angle(double a) {
+    a = fmod(a + M_PI, 2 * M_PI);
+    if (a < 0) a += 2 * M_PI;
+    return a - M_PI;
+}
+
+// One-period map: start from the base run at its current time with state x
+static void period_map(const AppData *base, const double *x, double *phi, int steps, double dt) {
+    AppData work = *base;
+    // Event-driven modules are frozen so the map is deterministic and periodic
+    work.params.mppt = MPPT_NONE;
+    work.params.islanding_enabled = FALSE;
+    PeriodicState s;
+    periodic_state_bind(&s, &work.params);
+    for (int i = 0; i < s.n; i++) {
+        *s.ptr[i] = x[i];
+    }
+    for (int k = 0; k < steps; k++) {
+        simulation_step(&work, dt);
+    }
+    for (int i = 0; i < s.n; i++) {
+        phi[i] = *s.ptr[i];
+    }
+}
+
+static void residual(const PeriodicState *s, const double *x, const double *phi, double *r) {
+    for (int i = 0; i < s->n; i++) {
+        r[i] = s->angle[i] ? wrap_angle(phi[i] - x[i]) : phi[i] - x[i];
+    }
+}
+
+static double norm_inf(const double *v, int n) {
+    double m = 0.0;
+    for (int i = 0; i < n; i++) {
+        if (fabs(v[i]) > m) m = fabs(v[i]);
+    }
+    return m;
+}
+
+// In-place LU factorisation with partial pivoting (row-major n x n)
+static gboolean lu_factor(double *a, int *piv, int n) {
+    for (int k = 0; k < n; k++) {
+        int p = k;
+        for (int i = k + 1; i < n; i++) {
+            if (fabs(a[i * n + k]) > fabs(a[p * n + k])) p = i;
+        }
+        if (fabs(a[p * n + k]) < 1e-14) return FALSE;
+        piv[k] = p;
+        if (p != k) {
+            for (int j = 0; j < n; j++) {
+                double t = a[k * n + j];
+                a[k * n + j] = a[p * n + j];
+                a[p * n + j] = t;
+            }
+        }
+        for (int i = k + 1; i < n; i++) {
+            a[i * n + k] /= a[k * n + k];
+            for (int j = k + 1; j < n; j++) {
+                a[i * n + j] -= a[i * n + k] * a[k * n + j];
+            }
+        }
+    }
+    return TRUE;
+}
+
+static void lu_solve(const double *a, const int *piv, int n, double *b) {
+    for (int k = 0; k < n; k++) {
+        if (piv[k] != k) {
+            double t = b[k];
+            b[k] = b[piv[k]];
+            b[piv[k]] = t;
+        }
+    }
+    for (int i = 1; i < n; i++) {
+        for (int j = 0; j < i; j++) b[i] -= a[i * n + j] * b[j];
+    }
+    for (int i = n - 1; i >= 0; i--) {
+        for (int j = i + 1; j < n; j++) b[i] -= a[i * n + j] * b[j];
+        b[i] /= a[i * n + i];
+    }
+}
+
+// Finite-difference Jacobian of r(x) = Phi(x) - x, factored in place
+static gboolean jacobian_update(const AppData *base, const PeriodicState *s, const double *x, const double *r,
+                                int steps, double dt, double *jac, int *piv) {
+    int n = s->n;
+    double xp[SS_MAX_STATES], phi[SS_MAX_STATES], rp[SS_MAX_STATES];
+    for (int j = 0; j < n; j++) {
+        double h = 1e-6 * fmax(1.0, fabs(x[j]));
+        for (int i = 0; i < n; i++) xp[i] = x[i];
+        xp[j] += h;
+        period_map(base, xp, phi, steps, dt);
+        residual(s, xp, phi, rp);
+        for (int i = 0; i < n; i++) {
+            jac[i * n + j] = (rp[i] - r[i]) / h;
+        }
+    }
+    return lu_factor(jac, piv, n);
+}
+
+gboolean steady_state_solve(AppData *app, int *iterations, double *residual_norm) {
+    PeriodicState s;
+    periodic_state_bind(&s, &app->params);
+    *iterations = 0;
+    *residual_norm = 0.0;
+    if (app->params.fixed_point && app->params.control != CONTROL_NONE) {
+        // Integer controller states are not differentiable; Newton needs the double path
+        fprintf(stderr, "[Error] Steady state: not available in fixed-point emulation\n");
+        return FALSE;
+    }
+    if (s.overflow) {
+        fprintf(stderr, "[Error] Steady state: the enabled modules have more than %d states\n", SS_MAX_STATES);
+        return FALSE;
+    }
+    if (s.n == 0) {
+        return TRUE; // Nothing evolves: already periodic
+    }
+
+    // Integrate one fundamental period with a uniform step no larger than max_dt
+    double period = 1.0 / app->params.frequency;
+    int steps = (int)ceil(period / app->params.max_dt);
+    double dt = period / steps;
+
+    double x[SS_MAX_STATES] = {0}, phi[SS_MAX_STATES], r[SS_MAX_STATES], dx[SS_MAX_STATES];
+    double jac[SS_MAX_STATES * SS_MAX_STATES];
+    int piv[SS_MAX_STATES];
+    int n = s.n;
+    for (int i = 0; i < n; i++) x[i] = *s.ptr[i];
+
+    period_map(app, x, phi, steps, dt);
+    residual(&s, x, phi, r);
+    double rnorm = norm_inf(r, n);
+    gboolean have_jacobian = FALSE;
+    int jacobian_updates = 0;
+
+    for (int it = 0; it < SS_MAX_ITERATIONS && rnorm > SS_TOLERANCE; it++) {
+        gboolean fresh = FALSE;
+        if (!have_jacobian) {
+            if (!jacobian_update(app, &s, x, r, steps, dt, jac, piv)) {
+                fprintf(stderr, "[Error] Steady state: singular Jacobian (saturated or purely integrating state)\n");
+                return FALSE;
+            }
+            have_jacobian = TRUE;
+            fresh = TRUE;
+            jacobian_updates++;
+        }
+        for (int i = 0; i < n; i++) dx[i] = -r[i];
+        lu_solve(jac, piv, n, dx);
+        double x_new[SS_MAX_STATES], r_new[SS_MAX_STATES];
+        for (int i = 0; i < n; i++) x_new[i] = x[i] + dx[i];
+
+        period_map(app, x_new, phi, steps, dt);
+        residual(&s, x_new, phi, r_new);
+        double rnorm_new = norm_inf(r_new, n);
+        (*iterations)++;
+
+        if (rnorm_new >= rnorm && !fresh) {
+            have_jacobian = FALSE; // Stale Jacobian: rebuild and retry from x
+            continue;
+        }
+        if (rnorm_new > SS_REUSE_CONTRACTION * rnorm) {
+            have_jacobian = FALSE; // Slow contraction: refresh before the next step
+        }
+        for (int i = 0; i < n; i++) {
+            x[i] = x_new[i];
+            r[i] = r_new[i];
+        }
+        rnorm = rnorm_new;
+    }
+
+    *residual_norm = rnorm;
+    if (rnorm > SS_TOLERANCE) {
+        fprintf(stderr, "[Error] Steady state: no convergence (residual %.3e after %d iterations)\n",
+                rnorm, *iterations);
+        return FALSE;
+    }
+
+    // Hand the periodic operating point to the regular time-domain run
+    for (int i = 0; i < n; i++) {
+        *s.ptr[i] = s.angle[i] ? fmod(fmod(x[i], 2 * M_PI) + 2 * M_PI, 2 * M_PI) : x[i];
+    }
+    fprintf(stderr, "[Info] Steady state: %d Newton iterations, %d Jacobian updates, residual %.3e\n",
+            *iterations, jacobian_updates, rnorm);
+    return TRUE;
+}
\ No newline at end of file
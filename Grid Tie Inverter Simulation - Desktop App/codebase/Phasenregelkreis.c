@@ -1,53 +1,348 @@
 #include "inverter.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
-// Simulated grid voltage with variable frequency and amplitude
-static double grid_voltage(double time, double *frequency, double *amplitude) {
-    // Simulate grid variations (e.g., frequency 49–51 Hz, amplitude 210–230V RMS)
-    *frequency = 50.0 + sin(time * 0.1) * 1.0; // Vary ±1 Hz
-    *amplitude = 220.0 + sin(time * 0.2) * 10.0; // Vary ±10V RMS
-    return *amplitude * sqrt(2) * sin(2 * M_PI * *frequency * time);
+// Grid synchronisation on the PCC voltage of the grid model (GridSimulation.c)
+// Product: legacy multiplier phase detector with zero-crossing frequency estimate.
+// SRF: Park transform of the three PCC phases onto the estimated angle, PI on q.
+// SOGI: second-order generalised integrator on phase a builds the quadrature pair.
+// DSOGI: SOGIs on alpha and beta, positive-sequence calculation, then the SRF loop.
+// DDSRF: decoupled double synchronous frame (SymmetrischeKomponenten.c); the loop runs
+// on the positive sequence, so unbalanced dips leave no 2w ripple on the angle.
+// All integrators are discrete: trapezoidal (pre-warped) SOGIs, Tustin PI, forward
+// Euler on the angle. In fixed-point mode the SRF-PLL runs as integer firmware code.
+// pll_update samples the PCC on its own fixed step, so the loop sees the same sample
+// rate whatever step the simulation takes; lock is never reported for coarser steps.
+
+#define PLL_SOGI_GAIN 1.41421356 // SOGI damping k = sqrt(2)
+#define PLL_LOCK_ERROR 0.035 // Lock threshold on the normalised phase error (about 2 degrees)
+#define PLL_FIXED_DW_FS 256.0 // Q15 full scale of the fixed-point loop filter output (rad/s)
+#define PLL_TURN 4294967296.0 // Fixed-point phase accumulator: 2^32 per turn
+#define PLL_LOCK_MAX_STEP 0.02 // Largest step, as a fraction of the nominal period, that may report lock
+
+static double wrap_angle(double a) {
+    a = fmod(a, 2 * M_PI);
+    return a < 0 ? a + 2 * M_PI : a;
 }
 
-void pll_update(InverterParams *params, double time) {
-    // PLL parameters
-    const double dt = 0.05; // Time step (50ms, 20 FPS)
-    static double integral = 0.0; // Persistent integral term
-    static double prev_grid_v = 0.0; // Previous grid voltage for zero-crossing
-    static double last_zero_cross = 0.0; // Time of last zero-crossing
-    static int zero_cross_count = 0; // Count zero-crossings for frequency estimation
+// Second-order generalised integrator, trapezoidal rule pre-warped at w:
+// dv'/dt = w*(k*(v - v') - qv'), dqv'/dt = w*v'; qv' lags v' by 90 degrees
+static void sogi_update(double state[2], double *prev_input, double v, double w, double dt) {
+    double c = tan(fmin(w * dt / 2.0, 1.4));
+    double k = PLL_SOGI_GAIN;
+    double rhs0 = (1.0 - c * k) * state[0] - c * state[1] + c * k * (v + *prev_input);
+    double rhs1 = c * state[0] + state[1];
+    double det = 1.0 + c * k + c * c;
+    state[0] = (rhs0 - c * rhs1) / det;
+    state[1] = (c * rhs0 + (1.0 + c * k) * rhs1) / det;
+    *prev_input = v;
+}
 
-    // Get grid voltage and parameters
-    double grid_freq, grid_ampl;
-    double v_grid = grid_voltage(time, &grid_freq, &grid_ampl);
-    double v_inv = params->voltage * sqrt(2) * sin(2 * M_PI * params->frequency * time + params->pll_phase);
+// Legacy product PLL on the phase-a PCC voltage
+static void pll_product(InverterParams *params, double time, double v_grid, double grid_ampl, double dt) {
+    double v_inv = params->voltage * sqrt(2) * sin(timebase_angle(params->frequency, time) + params->pll_phase);
 
     // Frequency estimation via zero-crossing detection
-    if (prev_grid_v <= 0 && v_grid > 0) { // Positive zero-crossing
-        zero_cross_count++;
-        if (zero_cross_count >= 2) { // Estimate frequency after two crossings
-            double period = (time - last_zero_cross) / (zero_cross_count - 1);
+    if (params->pll_prev_grid_v <= 0 && v_grid > 0) { // Positive zero-crossing
+        params->pll_zero_cross_count++;
+        if (params->pll_zero_cross_count >= 2) { // Estimate frequency after two crossings
+            double period = (time - params->pll_last_zero_cross) / (params->pll_zero_cross_count - 1);
             params->pll_frequency = 1.0 / period;
-            zero_cross_count = 1; // Reset for next estimation
-            last_zero_cross = time;
+            params->pll_zero_cross_count = 1; // Reset for next estimation
+            params->pll_last_zero_cross = time;
         }
     }
-    prev_grid_v = v_grid;
+    params->pll_prev_grid_v = v_grid;
 
     // Voltage tracking: slowly adjust to grid amplitude
-    params->pll_voltage += 0.1 * (grid_ampl - params->pll_voltage) * dt; // Low-pass filter effect
+    params->pll_voltage += (1.0 - exp(-0.1 * dt)) * (grid_ampl - params->pll_voltage); // Exact first-order low-pass
 
     // Phase detector: multiply signals
     double error = v_grid * v_inv; // Proportional to phase difference
 
-    // PI controller
-    integral += error * dt;
-    double phase_correction = params->pll_kp * error + params->pll_ki * integral;
+    // PI loop filter, discretised for the actual step
+    biquad_pi(&params->pll_pi, params->pll_kp, params->pll_ki, DISCRETIZE_TUSTIN);
+    biquad_set_rate(&params->pll_pi, dt);
+    double phase_correction = biquad_update(&params->pll_pi, error);
 
     // Update PLL phase
     params->pll_phase += phase_correction * dt;
-    params->pll_phase = fmod(params->pll_phase, 2 * M_PI);
-    if (params->pll_phase < 0) params->pll_phase += 2 * M_PI;
+    params->pll_phase = wrap_angle(params->pll_phase);
+    params->pll_angle = wrap_angle(timebase_angle(params->pll_frequency, time) + params->pll_phase);
 
     // Update lock status (locked if phase error is small)
     params->pll_locked = fabs(error) < 0.1 * grid_ampl * params->voltage * sqrt(2);
+}
+
+// Synchronous-frame loop shared by SRF, SOGI, DSOGI and DDSRF: drive q = V*sin(theta - theta_hat)
+// to zero; magnitude is the voltage amplitude used for normalisation
+static void pll_design(InverterParams *params, double dt) {
+    double kp = PLL_KP * params->pll_kp / PLL_DEFAULT_KP;
+    double ki = PLL_KI * params->pll_ki / PLL_DEFAULT_KI;
+    biquad_pi(&params->pll_pi, kp, ki, DISCRETIZE_TUSTIN);
+    biquad_set_rate(&params->pll_pi, dt);
+}
+
+// Reported frequency, voltage, lock state and the output-stage phase offset at this instant
+static void pll_publish(InverterParams *params, double time, double w, double error, double magnitude, double dt) {
+    params->pll_frequency += (1.0 - exp(-dt / PLL_FREQUENCY_TAU)) * (w / (2 * M_PI) - params->pll_frequency);
+    params->pll_voltage += (1.0 - exp(-dt / PLL_VOLTAGE_TAU)) * (magnitude / sqrt(2) - params->pll_voltage);
+    params->pll_locked = fabs(error) < PLL_LOCK_ERROR && magnitude > 0.1 * params->voltage * sqrt(2);
+    params->pll_phase = wrap_angle(params->pll_angle - timebase_angle(params->pll_frequency, time));
+}
+
+static void pll_loop(InverterParams *params, double time, double q, double magnitude, double dt) {
+    double error = magnitude > 1.0 ? q / magnitude : 0.0; // Normalised: loop gain independent of voltage
+    pll_design(params, dt);
+    double w = 2 * M_PI * PLL_NOMINAL_FREQUENCY + biquad_update(&params->pll_pi, error);
+    w = fmin(fmax(w, 2 * M_PI * 0.8 * PLL_NOMINAL_FREQUENCY), 2 * M_PI * 1.2 * PLL_NOMINAL_FREQUENCY);
+    pll_publish(params, time, w, error, magnitude, dt);
+    params->pll_angle = wrap_angle(params->pll_angle + w * dt); // Advance the estimate
+}
+
+// SRF-PLL as the firmware runs it: Q15 voltage samples, polynomial Q15 sine, Q31 loop
+// filter (Festkommaemulation.c) and a 32-bit phase accumulator. pll_angle holds the
+// accumulator value exactly, so the double and fixed paths can be swapped at any time.
+static void pll_srf_fixed(InverterParams *params, double time, const double *v_abc, double dt) {
+    guint32 angle = (guint32)(gint64)floor(params->pll_angle / (2 * M_PI) * PLL_TURN + 0.5);
+    gint32 a = q15_from_double(v_abc[0], FIXED_VOLTAGE_FS);
+    gint32 b = q15_from_double(v_abc[1], FIXED_VOLTAGE_FS);
+    gint32 c = q15_from_double(v_abc[2], FIXED_VOLTAGE_FS);
+    gint32 alpha = ((2 * a - b - c) * 10923) >> 15; // 1/3 in Q15
+    gint32 beta = ((b - c) * 18919) >> 15; // 1/sqrt(3) in Q15
+
+    gint16 s, co;
+    q15_sin_cos(angle, &s, &co);
+    gint32 d = (gint32)(((gint64)alpha * s + (gint64)beta * co) >> 15);
+    gint32 q = (gint32)(((gint64)alpha * co - (gint64)beta * s) >> 15);
+    guint32 magnitude = q_isqrt((guint64)((gint64)d * d + (gint64)q * q));
+    gint16 error = 0; // q / |dq| in Q15
+    if (magnitude > 32) { // About 1 V
+        gint64 e = ((gint64)q * 32768) / magnitude;
+        error = (gint16)(e > 32767 ? 32767 : e < -32768 ? -32768 : e);
+    }
+
+    // Loop filter output is the frequency correction, limited to +-20% of nominal
+    pll_design(params, dt);
+    gint32 dw = fixed_biquad_update(&params->pll_pi_fixed, &params->pll_pi, 1.0 / PLL_FIXED_DW_FS, error);
+    gint32 dw_max = (gint32)floor(0.2 * 2 * M_PI * PLL_NOMINAL_FREQUENCY / PLL_FIXED_DW_FS * 32768.0 + 0.5);
+    dw = dw > dw_max ? dw_max : dw < -dw_max ? -dw_max : dw;
+
+    // Phase increment per step; both constants depend only on the sample time
+    gint64 increment_nominal = (gint64)floor(PLL_NOMINAL_FREQUENCY * dt * PLL_TURN + 0.5);
+    gint64 increment_per_lsb = (gint64)floor(PLL_FIXED_DW_FS / 32768.0 / (2 * M_PI) * dt * PLL_TURN * 65536.0 + 0.5); // Q16
+    guint32 increment = (guint32)(increment_nominal + ((dw * increment_per_lsb) >> 16));
+
+    params->pll_angle = angle * (2 * M_PI / PLL_TURN);
+    pll_publish(params, time, 2 * M_PI * PLL_NOMINAL_FREQUENCY + dw * (PLL_FIXED_DW_FS / 32768.0), error / 32768.0,
+                magnitude * (FIXED_VOLTAGE_FS / 32768.0), dt);
+    params->pll_angle = (guint32)(angle + increment) * (2 * M_PI / PLL_TURN);
+}
+
+static void pll_track(InverterParams *params, double time, double alpha, double beta, double dt) {
+    double d, q;
+    park_batch(&alpha, &beta, &params->pll_angle, &d, &q, 1);
+    pll_loop(params, time, q, hypot(d, q), dt);
+}
+
+void pll_step(InverterParams *params, double time, const double *v_abc, double dt) {
+    double alpha, beta;
+    clarke_batch(&v_abc[0], &v_abc[1], &v_abc[2], &alpha, &beta, 1);
+    double w = 2 * M_PI * params->pll_frequency; // Adaptive SOGI centre frequency
+    switch (params->pll_type) {
+        case PLL_PRODUCT:
+            pll_product(params, time, v_abc[0], hypot(alpha, beta) / sqrt(2), dt);
+            break;
+        case PLL_SRF:
+            if (params->fixed_point) {
+                pll_srf_fixed(params, time, v_abc, dt);
+            } else {
+                pll_track(params, time, alpha, beta, dt);
+            }
+            break;
+        case PLL_SOGI:
+            // In-phase output is alpha, the lagging quadrature output is -beta
+            sogi_update(params->pll_sogi[0], &params->pll_sogi_input[0], v_abc[0], w, dt);
+            pll_track(params, time, params->pll_sogi[0][0], -params->pll_sogi[0][1], dt);
+            break;
+        case PLL_DSOGI: {
+            sogi_update(params->pll_sogi[0], &params->pll_sogi_input[0], alpha, w, dt);
+            sogi_update(params->pll_sogi[1], &params->pll_sogi_input[1], beta, w, dt);
+            // Positive sequence: alpha+ = (alpha' + q*beta') / 2, beta+ = (beta' - q*alpha') / 2
+            double alpha_pos = 0.5 * (params->pll_sogi[0][0] + params->pll_sogi[1][1]);
+            double beta_pos = 0.5 * (params->pll_sogi[1][0] - params->pll_sogi[0][1]);
+            pll_track(params, time, alpha_pos, beta_pos, dt);
+            break;
+        }
+        case PLL_DDSRF: {
+            double pos[2], neg[2];
+            sequence_extract(&params->pll_sequence, alpha, beta, params->pll_angle, w, dt, pos, neg);
+            pll_loop(params, time, pos[1], hypot(params->pll_sequence.pos[0], params->pll_sequence.pos[1]), dt);
+            break;
+        }
+    }
+    if (dt * PLL_NOMINAL_FREQUENCY > PLL_LOCK_MAX_STEP) {
+        params->pll_locked = FALSE; // Too few samples per period to resolve the phase error
+    }
+}
+
+void pll_update(InverterParams *params, double time, double dt) {
+    // Inverter phase currents loading the grid impedance
+    double currents[3] = { 0.0, 0.0, 0.0 };
+    if (control_dq_active(params)) {
+        memcpy(currents, params->plant_current_abc, sizeof(currents));
+    } else if (params->control != CONTROL_NONE) {
+        currents[0] = params->plant_current;
+    }
+
+    // Resample the step [time - dt, time] at no more than pll_sample_time, currents held
+    int substeps = (int)ceil(dt / params->pll_sample_time - 1e-9);
+    substeps = substeps < 1 ? 1 : substeps;
+    double h = dt / substeps;
+    for (int k = substeps - 1; k >= 0; k--) {
+        double t = time - k * h;
+        double v_pcc[3], grid_freq, grid_ampl;
+        grid_pcc_voltages(params, t, currents, v_pcc, &grid_freq, &grid_ampl);
+        pll_step(params, t, v_pcc, h);
+    }
+}
+
+// PLL benchmark scenarios: balanced grid, event at PLL_BENCH_EVENT
+#define PLL_BENCH_EVENT 0.3 // s
+#define PLL_BENCH_END 1.0 // s
+#define PLL_BENCH_DT 50e-6 // 20 kHz
+
+typedef enum {
+    BENCH_PHASE_JUMP,
+    BENCH_FREQUENCY_RAMP,
+    BENCH_HARMONICS,
+    BENCH_SAG,
+    BENCH_UNBALANCED,
+    BENCH_SCENARIOS
+} PLLBenchScenario;
+
+static const char *bench_scenario_names[] = {
+    "Phase jump +30 deg", "Frequency ramp +10 Hz/s to 52 Hz", "Harmonics 5th 5% + 7th 3%", "Balanced sag to 50%",
+    "Phase-to-phase dip (type C, V+ 0.75, V- 0.25 pu)",
+};
+
+// Phase voltages of a scenario at time t; returns the true phase-a angle and frequency
+static void bench_grid(PLLBenchScenario scenario, double t, double *v_abc, double *angle, double *frequency) {
+    const double v_peak = 220.0 * sqrt(2);
+    double f = PLL_NOMINAL_FREQUENCY, theta = timebase_angle(PLL_NOMINAL_FREQUENCY, t);
+    double amplitude = 1.0, h5 = 0.0, h7 = 0.0, quadrature = 1.0;
+    gboolean after = t >= PLL_BENCH_EVENT;
+    switch (scenario) {
+        case BENCH_PHASE_JUMP:
+            if (after) theta += M_PI / 6;
+            break;
+        case BENCH_FREQUENCY_RAMP: {
+            // 10 Hz/s for 0.2 s, then 52 Hz: theta is the integral of the frequency
+            double ramp = fmin(fmax(t - PLL_BENCH_EVENT, 0.0), 0.2);
+            f += 10.0 * ramp;
+            theta += 2 * M_PI * (10.0 * ramp * ramp / 2.0 + 10.0 * 0.2 * fmax(t - PLL_BENCH_EVENT - 0.2, 0.0));
+            break;
+        }
+        case BENCH_HARMONICS:
+            if (after) {
+                h5 = 0.05;
+                h7 = 0.03;
+            }
+            break;
+        case BENCH_SAG:
+            if (after) amplitude = 0.5;
+            break;
+        case BENCH_UNBALANCED:
+            if (after) quadrature = 0.5; // b and c move towards each other, a stays
+            break;
+        default:
+            break;
+    }
+    for (int k = 0; k < 3; k++) {
+        double phase = theta + k * 2 * M_PI / 3;
+        double re = cos(k * 2 * M_PI / 3), im = sin(k * 2 * M_PI / 3) * quadrature; // Phasor of phase k
+        v_abc[k] = v_peak * (amplitude * (re * sin(theta) + im * cos(theta)) + h5 * sin(5 * phase) + h7 * sin(7 * phase));
+    }
+    *angle = wrap_angle(theta);
+    *frequency = f;
+}
+
+// Headless mode: --pll-bench
+// Lock time after the event (phase error below 2 deg and frequency error below 0.1 Hz
+// from then on), steady-state error over the last 100 ms and cost per update, then the
+// sequence components the DDSRF extractor reports for the phase-to-phase dip.
+int pll_bench_main(int argc, char *argv[]) {
+    const PLLType types[] = { PLL_PRODUCT, PLL_SRF, PLL_SOGI, PLL_DSOGI, PLL_DDSRF };
+    const char *type_names[] = { "Product", "SRF", "SOGI", "DSOGI", "DDSRF" };
+    const int steps = (int)(PLL_BENCH_END / PLL_BENCH_DT);
+    double *v_abc = g_new(double, 3 * steps);
+    double *angle = g_new(double, steps), *frequency = g_new(double, steps);
+    double *estimate = g_new(double, steps), *estimate_frequency = g_new(double, steps);
+    for (int s = 0; s < BENCH_SCENARIOS; s++) {
+        for (int k = 0; k < steps; k++) {
+            bench_grid((PLLBenchScenario)s, (k + 1) * PLL_BENCH_DT, &v_abc[3 * k], &angle[k], &frequency[k]);
+        }
+        printf("%s (event at %.1f s)\n", bench_scenario_names[s], PLL_BENCH_EVENT);
+        printf("%10s %14s %16s %16s %12s\n", "PLL", "lock (ms)", "ss phase (deg)", "ss freq (Hz)", "ns/update");
+        for (int v = 0; v < (int)(sizeof(types) / sizeof(types[0])); v++) {
+            InverterParams params;
+            inverter_init(&params);
+            params.pll_enabled = TRUE;
+            params.pll_type = types[v];
+            gint64 start = g_get_monotonic_time();
+            for (int k = 0; k < steps; k++) {
+                double t = (k + 1) * PLL_BENCH_DT;
+                pll_step(&params, t, &v_abc[3 * k], PLL_BENCH_DT);
+                // Estimate valid at t: the angle the output stage uses
+                estimate[k] = timebase_angle(params.pll_frequency, t) + params.pll_phase;
+                estimate_frequency[k] = params.pll_frequency;
+            }
+            double ns = (g_get_monotonic_time() - start) * 1e3 / steps;
+
+            double last_unlocked = PLL_BENCH_EVENT, ss_phase = 0.0, ss_freq = 0.0;
+            for (int k = 0; k < steps; k++) {
+                double t = (k + 1) * PLL_BENCH_DT;
+                double phase_error = fabs(remainder(estimate[k] - angle[k], 2 * M_PI)) * 180.0 / M_PI;
+                double freq_error = fabs(estimate_frequency[k] - frequency[k]);
+                if (t >= PLL_BENCH_EVENT && (phase_error > 2.0 || freq_error > 0.1)) last_unlocked = t;
+                if (t >= PLL_BENCH_END - 0.1) {
+                    ss_phase = fmax(ss_phase, phase_error);
+                    ss_freq = fmax(ss_freq, freq_error);
+                }
+            }
+            char lock[32];
+            if (last_unlocked >= PLL_BENCH_END - 0.1) {
+                snprintf(lock, sizeof(lock), "no lock");
+            } else {
+                snprintf(lock, sizeof(lock), "%.1f", (last_unlocked - PLL_BENCH_EVENT) * 1e3);
+            }
+            printf("%10s %14s %16.3f %16.4f %12.1f\n", type_names[v], lock, ss_phase, ss_freq, ns);
+        }
+        printf("\n");
+    }
+
+    // Sequence extraction on the phase-to-phase dip: settling of |V+| and |V-| to within 1%
+    InverterParams params;
+    inverter_init(&params);
+    params.pll_enabled = TRUE;
+    params.pll_type = PLL_DDSRF;
+    const double v_peak = 220.0 * sqrt(2);
+    double settled = PLL_BENCH_EVENT, v_pos = 0.0, v_neg = 0.0;
+    for (int k = 0; k < steps; k++) {
+        double t = (k + 1) * PLL_BENCH_DT, a, f;
+        bench_grid(BENCH_UNBALANCED, t, &v_abc[3 * k], &a, &f);
+        pll_step(&params, t, &v_abc[3 * k], PLL_BENCH_DT);
+        v_pos = hypot(params.pll_sequence.pos[0], params.pll_sequence.pos[1]) / v_peak;
+        v_neg = hypot(params.pll_sequence.neg[0], params.pll_sequence.neg[1]) / v_peak;
+        if (t >= PLL_BENCH_EVENT && (fabs(v_pos - 0.75) > 0.01 || fabs(v_neg - 0.25) > 0.01)) settled = t;
+    }
+    printf("DDSRF sequence components after the phase-to-phase dip: V+ %.4f pu, V- %.4f pu, settled in %.1f ms\n",
+           v_pos, v_neg, (settled - PLL_BENCH_EVENT) * 1e3);
+    g_free(v_abc);
+    g_free(angle);
+    g_free(frequency);
+    g_free(estimate);
+    g_free(estimate_frequency);
+    return 0;
 }
\ No newline at end of file
@@ -0,0 +1,457 @@
+#include "inverter.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Automatic controller tuning
+// Nelder-Mead on the logarithm of the gains against a weighted objective: overshoot,
+// settling time and current THD averaged over a set of grid events, plus a penalty when
+// the phase margin of the tuned loop falls below 45 degrees. Every iteration evaluates
+// the reflection, the expansion and both contractions at once (speculative simplex step),
+// and every candidate runs its scenarios as separate tasks, so a generation keeps all
+// cores busy. A candidate is dropped as soon as its partial objective exceeds the worst
+// vertex of the simplex, since the simplex would reject it anyway.
+
+#define SCENARIO_PERIOD_MAX 1024 // Longest fundamental period in samples
+#define SCENARIO_THD_ORDER 25 // Highest harmonic in the THD
+#define SCENARIO_PLL_SCALE (2.0 * M_PI / 180.0) // PLL error scale: the 2 degree lock threshold (rad)
+#define TUNE_MARGIN_TARGET 45.0 // Phase margin below which the objective is penalised (deg)
+#define TUNE_INITIAL_STEP 0.7 // Initial simplex size in log(gain)
+#define TUNE_TOLERANCE 1e-3 // Simplex size at convergence in log(gain)
+#define TUNE_MAX_DIM 4
+
+static double wrap_error(double e) {
+    return e - 2 * M_PI * floor(e / (2 * M_PI) + 0.5); // To [-pi, pi)
+}
+
+// One headless run of a grid event from SCENARIO_START to SCENARIO_END at a fixed step.
+// The error signal is the phase-a current tracking error or the PLL phase error. Its
+// RMS over a sliding fundamental period gives the overshoot (largest rise above the value
+// at the event, per unit of the scale) and the settling time (last exit from a band
+// around zero error: 5% of the rated RMS current or 0.5 deg). A run that ends outside the
+// band has not settled and is charged the whole window. The weak grid has no event of its
+// own; it gets a +50% current reference step. The run stops early when the overshoot
+// exceeds overshoot_limit or the plant diverges.
+gboolean scenario_run(const InverterParams *base, GridCondition grid, ScenarioSignal signal, double overshoot_limit,
+                      ScenarioMetrics *m) {
+    InverterParams p = *base;
+    p.running = TRUE;
+    p.grid_condition = grid;
+    timebase_reset(&p, SCENARIO_START);
+    memset(m, 0, sizeof(*m));
+
+    double scale = signal == SCENARIO_SIGNAL_PLL ? SCENARIO_PLL_SCALE : fmax(p.control_ref_current, 1.0) / sqrt(2);
+    double band = signal == SCENARIO_SIGNAL_PLL ? 0.25 * scale : 0.05 * scale;
+    int period = (int)round(1.0 / (p.frequency * SCENARIO_DT));
+    if (period > SCENARIO_PERIOD_MAX) period = SCENARIO_PERIOD_MAX;
+    int steps = (int)round((SCENARIO_END - SCENARIO_START) / SCENARIO_DT);
+    int event = (int)round((SCENARIO_EVENT - SCENARIO_START) / SCENARIO_DT);
+    double squares[SCENARIO_PERIOD_MAX] = { 0.0 }, currents[SCENARIO_PERIOD_MAX] = { 0.0 };
+    double *rms = g_new(double, steps - event + 1);
+    double sum = 0.0, rms_event = 0.0, peak = 0.0;
+
+    gint64 start = g_get_monotonic_time();
+    for (int k = 1; k <= steps; k++) {
+        if (k == event && grid == GRID_WEAK) {
+            p.control_ref_current *= 1.5;
+        }
+        timebase_advance(&p, SCENARIO_DT);
+        double t = p.sim_time, estimate = p.pll_angle;
+        double grid_frequency = p.frequency;
+        if (p.pll_enabled) {
+            double v_source[3], drop[3], amplitude;
+            grid_pcc_source(&p, t, v_source, drop, &grid_frequency, &amplitude);
+            pll_update(&p, t, SCENARIO_DT);
+        }
+        if (p.control != CONTROL_NONE) {
+            control_update(&p, t, SCENARIO_DT);
+        }
+        double e = signal == SCENARIO_SIGNAL_PLL
+                       ? wrap_error(timebase_angle(grid_frequency, t) - estimate)
+                       : p.control_ref_current * sin(timebase_angle(p.frequency, t) + p.phase) - p.plant_current;
+        if (!isfinite(e) || fabs(p.plant_current) > 1e3) {
+            m->aborted = TRUE; // Diverged
+            break;
+        }
+        int slot = k % period;
+        sum += e * e - squares[slot];
+        squares[slot] = e * e;
+        currents[slot] = p.plant_current;
+        if (k >= event) {
+            double r = sqrt(fmax(sum, 0.0) / period);
+            rms[k - event] = r;
+            if (k == event) rms_event = r;
+            peak = fmax(peak, r);
+            m->overshoot = fmax(peak - rms_event, 0.0) / scale;
+            if (m->overshoot > overshoot_limit) {
+                m->aborted = TRUE; // Hopeless: already worse than the limit
+                break;
+            }
+        }
+    }
+    m->step_ns = (g_get_monotonic_time() - start) * 1e3 / steps;
+    if (!m->aborted) {
+        double final = rms[steps - event];
+        int last = 0;
+        for (int k = 0; k <= steps - event; k++) {
+            if (rms[k] > band) last = k;
+        }
+        m->settled = final <= band;
+        m->settling = m->settled ? last * SCENARIO_DT : SCENARIO_END - SCENARIO_EVENT;
+        m->rms = final;
+
+        // THD of the phase-a current over the last period, ordered from its oldest sample
+        double re[SCENARIO_THD_ORDER] = { 0.0 }, im[SCENARIO_THD_ORDER] = { 0.0 };
+        for (int j = 0; j < period; j++) {
+            int k = steps - period + 1 + j;
+            double theta = timebase_angle(p.frequency, SCENARIO_START + k * SCENARIO_DT);
+            for (int h = 0; h < SCENARIO_THD_ORDER; h++) {
+                re[h] += currents[k % period] * sin((h + 1) * theta);
+                im[h] += currents[k % period] * cos((h + 1) * theta);
+            }
+        }
+        double harmonics = 0.0;
+        for (int h = 1; h < SCENARIO_THD_ORDER; h++) harmonics += re[h] * re[h] + im[h] * im[h];
+        double fundamental = hypot(re[0], im[0]);
+        m->thd = fundamental > 0.0 ? sqrt(harmonics) / fundamental : 0.0;
+        m->tdd = p.control_ref_current > 0.0 ? 2.0 * sqrt(harmonics) / period / p.control_ref_current : 0.0;
+        m->fundamental = p.control_ref_current > 0.0 ? 2.0 * fundamental / period / p.control_ref_current : 0.0;
+    }
+    g_free(rms);
+    return !m->aborted;
+}
+
+// Settling column of the result tables: time after the event, or that the run never settled
+void scenario_settling_text(const ScenarioMetrics *m, char *text, size_t size) {
+    if (m->settled) {
+        snprintf(text, size, "%.1f ms", m->settling * 1e3);
+    } else {
+        snprintf(text, size, "not settled");
+    }
+}
+
+// Gains of a tuning target in InverterParams: kp and ki, then for PR the resonant gain at
+// the fundamental and, when the bank reaches h = 3, the one of the harmonic lanes.
+// Returns the number of gains.
+static int tune_gains(InverterParams *p, TuningTarget target, double *gains[TUNE_MAX_DIM]) {
+    gains[0] = target == TUNE_PLL ? &p->pll_kp : &p->control_kp;
+    gains[1] = target == TUNE_PLL ? &p->pll_ki : &p->control_ki;
+    if (target != TUNE_PR) return 2;
+    gains[2] = &p->harmonic_kr[0];
+    if (p->harmonic_order < 3) return 3;
+    gains[3] = &p->harmonic_kr[1];
+    return 4;
+}
+
+static void tune_gains_text(const InverterParams *p, TuningTarget target, char *text, size_t size) {
+    static const char *names[TUNE_MAX_DIM] = { "kp", "ki", "kr", "kr_h" };
+    double *gains[TUNE_MAX_DIM];
+    int n = tune_gains((InverterParams *)p, target, gains);
+    size_t len = 0;
+    for (int j = 0; j < n && len < size; j++) {
+        len += snprintf(text + len, size - len, "%s%s %.4g", j ? ", " : "", names[j], *gains[j]);
+    }
+}
+
+// Phase margin of the tuned loop at SCENARIO_DT (deg); negative when the crossover lies
+// beyond the Nyquist frequency. PLL: normalised phase detector, PI, integrator and the
+// one-step angle update. Current: PI (resonant terms left out, the scenarios catch a PR
+// bank that destabilises the loop), duty to bridge voltage
+// and the RL plant, plus 1.5 samples of computation and modulation delay.
+double tune_phase_margin(const InverterParams *p, TuningTarget target) {
+    double kp, ki;
+    if (target == TUNE_PLL) {
+        kp = PLL_KP * p->pll_kp / PLL_DEFAULT_KP;
+        ki = PLL_KI * p->pll_ki / PLL_DEFAULT_KI;
+    } else {
+        kp = p->control_kp;
+        ki = p->control_ki;
+    }
+    double v_peak = p->voltage * sqrt(2);
+    double lo = log(1.0), hi = log(M_PI / SCENARIO_DT), w = 0.0;
+    for (int i = 0; i < 60; i++) { // Bisection on |L(jw)| = 1, monotone in both loops
+        w = exp(0.5 * (lo + hi));
+        double gain = target == TUNE_PLL ? hypot(kp * w, ki) / (w * w)
+                                         : hypot(kp, ki / w) * v_peak / hypot(PLANT_R, w * PLANT_L);
+        if (gain > 1.0) lo = log(w); else hi = log(w);
+    }
+    if (hi >= log(M_PI / SCENARIO_DT) - 1e-9) {
+        return -1.0; // No crossover below Nyquist
+    }
+    double phase = target == TUNE_PLL ? atan2(kp * w, ki) - M_PI - w * SCENARIO_DT
+                                      : -atan2(ki, kp * w) - atan2(w * PLANT_L, PLANT_R) - 1.5 * w * SCENARIO_DT;
+    return 180.0 + phase * 180.0 / M_PI;
+}
+
+static const GridCondition tune_scenarios[TUNE_SCENARIOS] = { GRID_FAULT_SAG, GRID_FAULT_SWELL, GRID_FAULT_FREQ_SHIFT,
+                                                                GRID_WEAK };
+
+typedef struct {
+    double x[TUNE_MAX_DIM]; // log(gains)
+    double cost; // Objective, INFINITY when dropped
+    double margin; // Phase margin (deg)
+    double sum; // Scenario terms finished so far
+    int done; // Scenarios finished
+    gboolean aborted; // Dropped early
+    double threshold; // Drop once the objective is certain to exceed this
+    ScenarioMetrics metrics[TUNE_SCENARIOS];
+} TuneCandidate;
+
+typedef struct {
+    const InverterParams *base;
+    TuningTarget target;
+    TuningWeights weights;
+    TuneCandidate *candidates;
+    GMutex lock;
+    gint64 busy; // Summed task time (us)
+    long runs, dropped; // Scenario runs started and candidates dropped
+} TuneBatch;
+
+static double scenario_term(const TuningWeights *w, const ScenarioMetrics *m) {
+    return w->overshoot * m->overshoot + w->settling * m->settling / (SCENARIO_END - SCENARIO_EVENT) + w->thd * m->thd;
+}
+
+static double margin_term(const TuningWeights *w, double margin) {
+    return w->margin * fmax(TUNE_MARGIN_TARGET - margin, 0.0) / TUNE_MARGIN_TARGET;
+}
+
+static void tune_apply(InverterParams *p, TuningTarget target, const double *x) {
+    double *gains[TUNE_MAX_DIM];
+    int n = tune_gains(p, target, gains);
+    for (int j = 0; j < n; j++) *gains[j] = exp(x[j]);
+}
+
+static void tune_task(int n, gpointer data) {
+    TuneBatch *b = (TuneBatch *)data;
+    TuneCandidate *c = &b->candidates[n / TUNE_SCENARIOS];
+    int s = n % TUNE_SCENARIOS;
+
+    // Overshoot that would push this candidate past its threshold, given the finished
+    // scenarios (every scenario term is non-negative)
+    g_mutex_lock(&b->lock);
+    gboolean skip = c->aborted;
+    double limit = ((c->threshold - margin_term(&b->weights, c->margin)) * TUNE_SCENARIOS - c->sum) / b->weights.overshoot;
+    b->runs += !skip;
+    g_mutex_unlock(&b->lock);
+    if (skip) return;
+
+    InverterParams p = *b->base;
+    tune_apply(&p, b->target, c->x);
+    gint64 start = g_get_monotonic_time();
+    ScenarioMetrics m;
+    scenario_run(&p, tune_scenarios[s], b->target == TUNE_PLL ? SCENARIO_SIGNAL_PLL : SCENARIO_SIGNAL_CURRENT,
+                 b->weights.overshoot > 0.0 ? limit : INFINITY, &m);
+    gint64 elapsed = g_get_monotonic_time() - start;
+
+    g_mutex_lock(&b->lock);
+    b->busy += elapsed;
+    c->metrics[s] = m;
+    if (!c->aborted) {
+        c->sum += scenario_term(&b->weights, &m);
+        c->done++;
+        if (m.aborted || margin_term(&b->weights, c->margin) + c->sum / TUNE_SCENARIOS > c->threshold) {
+            c->aborted = TRUE;
+            b->dropped++;
+        }
+    }
+    g_mutex_unlock(&b->lock);
+}
+
+// Evaluate n candidates concurrently; candidates certain to exceed threshold are dropped
+static void tune_evaluate(TuneBatch *b, TuneCandidate *candidates, int n, double threshold) {
+    for (int i = 0; i < n; i++) {
+        TuneCandidate *c = &candidates[i];
+        InverterParams p = *b->base;
+        tune_apply(&p, b->target, c->x);
+        c->margin = tune_phase_margin(&p, b->target);
+        c->sum = 0.0;
+        c->done = 0;
+        c->threshold = threshold;
+        c->aborted = c->margin <= 0.0; // Unstable: not worth a run
+        b->dropped += c->aborted;
+    }
+    b->candidates = candidates;
+    parallel_for(n * TUNE_SCENARIOS, tune_task, b);
+    for (int i = 0; i < n; i++) {
+        TuneCandidate *c = &candidates[i];
+        c->cost = c->aborted ? INFINITY : margin_term(&b->weights, c->margin) + c->sum / TUNE_SCENARIOS;
+    }
+}
+
+static int compare_cost(const void *a, const void *b) {
+    double ca = ((const TuneCandidate *)a)->cost, cb = ((const TuneCandidate *)b)->cost;
+    return (ca > cb) - (ca < cb);
+}
+
+// Tune the gains of target starting from the values in params; the tuned gains are
+// written back to params. Returns FALSE when the start point itself is unusable.
+gboolean autotune_run(InverterParams *params, TuningTarget target, const TuningWeights *weights, int max_iterations,
+                      AutotuneReport *report) {
+    double *gains[TUNE_MAX_DIM];
+    const int n = tune_gains(params, target, gains);
+    TuneBatch batch = { .base = params, .target = target, .weights = *weights };
+    g_mutex_init(&batch.lock);
+    gboolean progress = report->progress;
+    memset(report, 0, sizeof(*report));
+    report->progress = progress;
+    gint64 start = g_get_monotonic_time();
+
+    TuneCandidate simplex[TUNE_MAX_DIM + 1];
+    memset(simplex, 0, sizeof(simplex));
+    for (int i = 0; i <= n; i++) {
+        for (int j = 0; j < n; j++) simplex[i].x[j] = log(*gains[j]);
+        if (i > 0) simplex[i].x[i - 1] += TUNE_INITIAL_STEP;
+    }
+    tune_evaluate(&batch, simplex, n + 1, INFINITY);
+    report->initial_cost = simplex[0].cost;
+    if (!isfinite(simplex[0].cost)) {
+        fprintf(stderr, "[Error] Auto-tuning: the starting gains are unstable\n");
+        g_mutex_clear(&batch.lock);
+        return FALSE;
+    }
+
+    int iteration = 0;
+    for (; iteration < max_iterations; iteration++) {
+        qsort(simplex, n + 1, sizeof(TuneCandidate), compare_cost);
+        double size = 0.0;
+        for (int i = 1; i <= n; i++) {
+            for (int j = 0; j < n; j++) size = fmax(size, fabs(simplex[i].x[j] - simplex[0].x[j]));
+        }
+        if (size < TUNE_TOLERANCE) break;
+
+        // Reflection, expansion, outside and inside contraction of the worst vertex, evaluated together
+        double centroid[TUNE_MAX_DIM] = { 0.0 };
+        for (int i = 0; i < n; i++) {
+            for (int j = 0; j < n; j++) centroid[j] += simplex[i].x[j] / n;
+        }
+        TuneCandidate trial[4];
+        const double coefficient[4] = { 1.0, 2.0, 0.5, -0.5 };
+        memset(trial, 0, sizeof(trial));
+        for (int t = 0; t < 4; t++) {
+            for (int j = 0; j < n; j++) {
+                trial[t].x[j] = centroid[j] + coefficient[t] * (centroid[j] - simplex[n].x[j]);
+            }
+        }
+        tune_evaluate(&batch, trial, 4, simplex[n].cost);
+        const TuneCandidate *r = &trial[0], *e = &trial[1], *oc = &trial[2], *ic = &trial[3];
+        const TuneCandidate *accept = NULL;
+        if (r->cost < simplex[0].cost) {
+            accept = e->cost < r->cost ? e : r;
+        } else if (r->cost < simplex[n - 1].cost) {
+            accept = r;
+        } else if (r->cost < simplex[n].cost) {
+            accept = oc->cost <= r->cost ? oc : NULL;
+        } else {
+            accept = ic->cost < simplex[n].cost ? ic : NULL;
+        }
+        if (accept) {
+            simplex[n] = *accept;
+        } else {
+            // Shrink towards the best vertex
+            for (int i = 1; i <= n; i++) {
+                for (int j = 0; j < n; j++) simplex[i].x[j] = simplex[0].x[j] + 0.5 * (simplex[i].x[j] - simplex[0].x[j]);
+            }
+            tune_evaluate(&batch, &simplex[1], n, INFINITY);
+        }
+        if (report->progress) {
+            qsort(simplex, n + 1, sizeof(TuneCandidate), compare_cost);
+            InverterParams best = *params;
+            tune_apply(&best, target, simplex[0].x);
+            char text[96];
+            tune_gains_text(&best, target, text, sizeof(text));
+            printf("  iteration %3d: cost %.5f at %s\n", iteration + 1, simplex[0].cost, text);
+        }
+    }
+    qsort(simplex, n + 1, sizeof(TuneCandidate), compare_cost);
+    tune_apply(params, target, simplex[0].x);
+
+    report->cost = simplex[0].cost;
+    report->margin = simplex[0].margin;
+    memcpy(report->metrics, simplex[0].metrics, sizeof(report->metrics));
+    report->iterations = iteration;
+    report->runs = batch.runs;
+    report->dropped = batch.dropped;
+    report->wall = (g_get_monotonic_time() - start) * 1e-6;
+    report->busy = batch.busy * 1e-6;
+    g_mutex_clear(&batch.lock);
+    return TRUE;
+}
+
+static void autotune_print(const InverterParams *p, TuningTarget target, const TuningWeights *w, const char *label) {
+    TuneCandidate c;
+    memset(&c, 0, sizeof(c));
+    double *gains[TUNE_MAX_DIM];
+    int n = tune_gains((InverterParams *)p, target, gains);
+    for (int j = 0; j < n; j++) c.x[j] = log(*gains[j]);
+    TuneBatch batch = { .base = p, .target = target, .weights = *w };
+    g_mutex_init(&batch.lock);
+    tune_evaluate(&batch, &c, 1, INFINITY);
+    g_mutex_clear(&batch.lock);
+    char text[96];
+    tune_gains_text(p, target, text, sizeof(text));
+    printf("%s: %s, phase margin %.1f deg, cost %.5f\n", label, text, c.margin, c.cost);
+    printf("  %-16s %12s %12s %10s\n", "scenario", "overshoot", "settling", "THD");
+    static const char *names[] = { "Voltage sag", "Voltage swell", "Frequency shift", "Weak grid, step" };
+    for (int s = 0; s < TUNE_SCENARIOS; s++) {
+        const ScenarioMetrics *m = &c.metrics[s];
+        char settling[16];
+        scenario_settling_text(m, settling, sizeof(settling));
+        printf("  %-16s %12.4f %12s %9.2f%%\n", names[s], m->overshoot, settling, m->thd * 100);
+    }
+}
+
+// Headless mode: --autotune [pi|pr|pll] [iterations] [w_overshoot w_settling w_thd w_margin]
+int autotune_main(int argc, char *argv[]) {
+    const char *name = argc > 2 ? argv[2] : "pll";
+    int iterations = argc > 3 ? atoi(argv[3]) : 40;
+    TuningWeights weights = { 1.0, 1.0, 10.0, 1.0 };
+    if (argc > 7) {
+        weights.overshoot = atof(argv[4]);
+        weights.settling = atof(argv[5]);
+        weights.thd = atof(argv[6]);
+        weights.margin = atof(argv[7]);
+    }
+
+    InverterParams params;
+    inverter_init(&params);
+    params.pll_enabled = TRUE;
+    params.control_ref_current = 5.0;
+    TuningTarget target;
+    if (strcmp(name, "pi") == 0) {
+        target = TUNE_PI;
+        params.control = CONTROL_PI;
+    } else if (strcmp(name, "pr") == 0) {
+        target = TUNE_PR;
+        params.control = CONTROL_PR;
+        params.harmonic_order = 5; // Resonant terms at h = 1, 3 and 5: both resonant gains are tuned
+    } else if (strcmp(name, "pll") == 0) {
+        target = TUNE_PLL;
+        params.type = THREE_PHASE; // PLL error under dq current control, which loads the PCC
+        params.control = CONTROL_PI;
+    } else {
+        fprintf(stderr, "[Error] Auto-tuning: unknown target '%s' (pi, pr or pll)\n", name);
+        return 1;
+    }
+
+    printf("Auto-tuning %s gains: Nelder-Mead in log(gain), %d scenarios, %d threads\n", name, TUNE_SCENARIOS,
+           (int)g_get_num_processors());
+    printf("Weights: overshoot %.2f, settling %.2f, THD %.2f, margin %.2f (target %.0f deg)\n\n", weights.overshoot,
+           weights.settling, weights.thd, weights.margin, TUNE_MARGIN_TARGET);
+    autotune_print(&params, target, &weights, "Initial");
+    printf("\n");
+    AutotuneReport report;
+    memset(&report, 0, sizeof(report));
+    report.progress = TRUE;
+    if (!autotune_run(&params, target, &weights, iterations, &report)) {
+        return 1;
+    }
+    printf("\n");
+    autotune_print(&params, target, &weights, "Tuned");
+    printf("\n%d iterations, %ld scenario runs, %ld candidates dropped early\n", report.iterations, report.runs,
+           report.dropped);
+    printf("Wall %.2f s, run time %.2f s (%.1fx parallel)\n", report.wall, report.busy, report.busy / report.wall);
+    if (target == TUNE_PLL && (params.pll_kp < 0.1 || params.pll_kp > 2.0 || params.pll_ki < 1.0 || params.pll_ki > 50.0)) {
+        fprintf(stderr, "[Info] Auto-tuning: the tuned PLL gains lie outside the slider ranges\n");
+    }
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,179 @@
+#include "inverter.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Controller shoot-out
+// Every control law runs the same scripted grid events (scenario_run, Reglerautotuning.c)
+// on one topology. Each controller x scenario combination is an independent task on all
+// cores. Control quality comes from the scenario metrics. The compute budget comes from a
+// second run of the same event in which only control_update() is stepped (PLL state
+// held) and the loop is timed as a whole, so timer calls do not count.
+// A run whose current fundamental stays below SHOOTOUT_MIN_FUNDAMENTAL of the reference
+// delivers no current: its error is just the reference and its THD is that of a residual,
+// so it is flagged and left out of the summary. The MPC duty grid does this at nominal
+// grid voltage: duty 1 reproduces the grid voltage in phase, and the grid stops at 1.
+
+typedef struct {
+    const char *name;
+    ControlType control;
+    MPCVariant variant;
+} ShootoutController;
+
+static const ShootoutController shootout_controllers[] = {
+    { "PI", CONTROL_PI, MPC_DUTY_GRID },
+    { "PR", CONTROL_PR, MPC_DUTY_GRID },
+    { "SMC", CONTROL_SMC, MPC_DUTY_GRID },
+    { "Repetitive", CONTROL_REPETITIVE, MPC_DUTY_GRID },
+    { "MPC Duty Grid", CONTROL_MPC, MPC_DUTY_GRID },
+    { "MPC FCS", CONTROL_MPC, MPC_FINITE_SET },
+    { "MPC Explicit", CONTROL_MPC, MPC_EXPLICIT },
+    { "MPC ADMM", CONTROL_MPC, MPC_ADMM },
+};
+#define SHOOTOUT_MIN_FUNDAMENTAL 0.1 // Current fundamental per unit of the reference below which a run delivers no current
+#define SHOOTOUT_CONTROLLERS (int)(sizeof(shootout_controllers) / sizeof(shootout_controllers[0]))
+
+static const struct {
+    GridCondition grid;
+    const char *name;
+} shootout_scenarios[] = {
+    { GRID_FAULT_SAG, "Sag 50%" },
+    { GRID_FAULT_SWELL, "Swell 120%" },
+    { GRID_FAULT_HARMONICS, "Harmonics" },
+    { GRID_FAULT_FREQ_SHIFT, "Freq +2 Hz" },
+    { GRID_WEAK, "Weak, step" },
+};
+#define SHOOTOUT_SCENARIOS (int)(sizeof(shootout_scenarios) / sizeof(shootout_scenarios[0]))
+
+typedef struct {
+    InverterParams base; // Topology and operating point shared by all tasks
+    ScenarioMetrics metrics[SHOOTOUT_CONTROLLERS][SHOOTOUT_SCENARIOS];
+    double control_ns[SHOOTOUT_CONTROLLERS][SHOOTOUT_SCENARIOS];
+} ShootoutWork;
+
+// Cost of control_update() alone over the scenario, timed as one loop
+static double shootout_control_ns(const InverterParams *params, GridCondition grid) {
+    InverterParams p = *params;
+    p.running = TRUE;
+    p.grid_condition = grid;
+    timebase_reset(&p, SCENARIO_START);
+    int steps = (int)round((SCENARIO_END - SCENARIO_START) / SCENARIO_DT);
+    gint64 start = g_get_monotonic_time();
+    for (int k = 1; k <= steps; k++) {
+        timebase_advance(&p, SCENARIO_DT);
+        control_update(&p, p.sim_time, SCENARIO_DT);
+    }
+    return (g_get_monotonic_time() - start) * 1e3 / steps;
+}
+
+static void shootout_task(int n, gpointer data) {
+    ShootoutWork *work = (ShootoutWork *)data;
+    int c = n / SHOOTOUT_SCENARIOS, s = n % SHOOTOUT_SCENARIOS;
+    InverterParams p = work->base;
+    p.control = shootout_controllers[c].control;
+    p.mpc_variant = shootout_controllers[c].variant;
+    GridCondition grid = shootout_scenarios[s].grid;
+    scenario_run(&p, grid, SCENARIO_SIGNAL_CURRENT, INFINITY, &work->metrics[c][s]);
+    work->control_ns[c][s] = shootout_control_ns(&p, grid);
+}
+
+// Headless mode: --control-shootout [single|three|npc|flying|chb] [horizon]
+int shootout_main(int argc, char *argv[]) {
+    static const struct {
+        const char *flag;
+        InverterType type;
+        const char *name;
+    } topologies[] = {
+        { "single", SINGLE_PHASE, "Single-Phase" },
+        { "three", THREE_PHASE, "Three-Phase" },
+        { "npc", NPC_INVERTER, "NPC" },
+        { "flying", FLYING_CAPACITOR, "Flying Capacitor" },
+        { "chb", CASCADED_H_BRIDGE, "Cascaded H-Bridge" },
+    };
+    const char *flag = argc > 2 ? argv[2] : "single";
+    int topology = -1;
+    for (int i = 0; i < (int)(sizeof(topologies) / sizeof(topologies[0])); i++) {
+        if (strcmp(flag, topologies[i].flag) == 0) topology = i;
+    }
+    if (topology < 0) {
+        fprintf(stderr, "[Error] Control shoot-out: unknown topology '%s' (single, three, npc, flying or chb)\n", flag);
+        return 1;
+    }
+
+    ShootoutWork *work = g_new0(ShootoutWork, 1);
+    inverter_init(&work->base);
+    work->base.type = topologies[topology].type;
+    work->base.pll_enabled = TRUE;
+    work->base.control_ref_current = 5.0;
+    work->base.mpc_horizon = argc > 3 ? atoi(argv[3]) : work->base.mpc_horizon;
+    if (work->base.mpc_horizon < 1 || work->base.mpc_horizon > MPC_MAX_HORIZON) {
+        fprintf(stderr, "[Error] Control shoot-out: horizon must be 1 to %d\n", MPC_MAX_HORIZON);
+        g_free(work);
+        return 1;
+    }
+
+    int n_threads = (int)g_get_num_processors();
+    printf("Control shoot-out: %s, %d controllers x %d scenarios at 20 kHz, MPC horizon %d, %d threads\n",
+           topologies[topology].name, SHOOTOUT_CONTROLLERS, SHOOTOUT_SCENARIOS, work->base.mpc_horizon, n_threads);
+    printf("Event at %.1f s, observed until %.1f s; tracking error, THD and TDD over the last period\n\n", SCENARIO_EVENT,
+           SCENARIO_END);
+    gint64 start = g_get_monotonic_time();
+    parallel_for(SHOOTOUT_CONTROLLERS * SHOOTOUT_SCENARIOS, shootout_task, work);
+    double wall = (g_get_monotonic_time() - start) * 1e-6;
+
+    printf("%-14s %-11s %12s %9s %9s %13s %12s\n", "controller", "scenario", "rms err (A)", "THD", "TDD", "settling",
+           "ns/update");
+    for (int c = 0; c < SHOOTOUT_CONTROLLERS; c++) {
+        for (int s = 0; s < SHOOTOUT_SCENARIOS; s++) {
+            const ScenarioMetrics *m = &work->metrics[c][s];
+            if (m->aborted) {
+                printf("%-14s %-11s %12s\n", shootout_controllers[c].name, shootout_scenarios[s].name, "diverged");
+                continue;
+            }
+            char settling[16];
+            scenario_settling_text(m, settling, sizeof(settling));
+            if (m->fundamental < SHOOTOUT_MIN_FUNDAMENTAL) {
+                snprintf(settling, sizeof(settling), "no current");
+            }
+            printf("%-14s %-11s %12.4f %8.2f%% %8.2f%% %13s %12.1f\n", shootout_controllers[c].name,
+                   shootout_scenarios[s].name, m->rms, m->thd * 100, m->tdd * 100, settling, work->control_ns[c][s]);
+        }
+    }
+
+    // Averages over the scenarios that deliver current, worst-case settling (the first run that never settled)
+    printf("\n%-14s %12s %9s %9s %13s %12s\n", "summary", "rms err (A)", "THD", "TDD", "worst settl.", "ns/update");
+    for (int c = 0; c < SHOOTOUT_CONTROLLERS; c++) {
+        double rms = 0.0, thd = 0.0, tdd = 0.0, ns = 0.0;
+        ScenarioMetrics worst = { .settled = TRUE };
+        int valid = 0, no_current = 0;
+        for (int s = 0; s < SHOOTOUT_SCENARIOS; s++) {
+            const ScenarioMetrics *m = &work->metrics[c][s];
+            ns += work->control_ns[c][s] / SHOOTOUT_SCENARIOS;
+            if (m->aborted) continue;
+            if (m->fundamental < SHOOTOUT_MIN_FUNDAMENTAL) {
+                no_current++;
+                continue;
+            }
+            rms += m->rms;
+            thd += m->thd;
+            tdd += m->tdd;
+            if (worst.settled && (!m->settled || m->settling > worst.settling)) worst = *m;
+            valid++;
+        }
+        char excluded[40] = "";
+        if (no_current > 0) {
+            snprintf(excluded, sizeof(excluded), "  (%d without current)", no_current);
+        }
+        if (valid == 0) {
+            printf("%-14s %12s %9s %9s %13s %12.1f%s\n", shootout_controllers[c].name, "-", "-", "-", "-", ns, excluded);
+            continue;
+        }
+        char settling[16];
+        scenario_settling_text(&worst, settling, sizeof(settling));
+        printf("%-14s %12.4f %8.2f%% %8.2f%% %13s %12.1f%s\n", shootout_controllers[c].name, rms / valid,
+               thd / valid * 100, tdd / valid * 100, settling, ns, excluded);
+    }
+    printf("\nWall %.2f s\n", wall);
+    g_free(work);
+    return 0;
+}
\ No newline at end of file
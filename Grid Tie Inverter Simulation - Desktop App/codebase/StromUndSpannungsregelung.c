@@ -1,92 +1,284 @@
 #include "inverter.h"
 
-// Simplified plant model: RL load + grid
-static double plant_model(double duty, double time, double *current, double grid_voltage, double params_voltage, double params_frequency, double params_phase) {
-    const double R = 10.0; // Load resistance (Ohms)
-    const double L = 0.01; // Load inductance (H)
-    const double dt = 0.05; // Time step (50ms)
-    static double i_prev = 0.0; // Previous current
-
-    // Inverter output voltage (based on duty cycle)
-    double v_inv = duty * params_voltage * sqrt(2) * sin(2 * M_PI * params_frequency * time + params_phase);
-    // Grid voltage
-    double v_grid = grid_voltage * sqrt(2) * sin(2 * M_PI * params_frequency * time);
-    // Differential equation: L*di/dt + R*i = v_inv - v_grid
-    double di_dt = (v_inv - v_grid - R * (*current)) / L;
-    *current = i_prev + di_dt * dt; // Euler integration
-    i_prev = *current;
-    return *current;
+// Exact-step coefficients of the plant: i[k+1] = a*i[k] + b*(v_inv - v_grid)
+// (explicit Euler is unstable for dt > 2L/R)
+void plant_coefficients(double dt, double *a, double *b) {
+    *a = exp(-PLANT_R * dt / PLANT_L);
+    *b = (1.0 - *a) / PLANT_R;
 }
 
-void control_update(InverterParams *params, double time) {
-    const double dt = 0.05; // Time step (50ms)
-    static double integral = 0.0; // PI/PR integral term
-    static double prev_error = 0.0; // For PR resonant term
-    double current = 0.0; // Simulated current
+// Simplified plant model: RL load + grid, L*di/dt + R*i = v_inv - v_grid, with v_grid phase a of
+// the grid model's source, so sags, swells, frequency shifts and harmonics reach the plant
+static double plant_model(InverterParams *params, double v_inv, double time, double dt, double i_prev) {
+    double v_source[3], drop[3], frequency, amplitude;
+    grid_pcc_source(params, time, v_source, drop, &frequency, &amplitude);
+    double a, b;
+    plant_coefficients(dt, &a, &b);
+    return a * i_prev + b * (v_inv - v_source[0]);
+}
+
+// Repetitive control: plug-in periodic term u_rc = kr * z^(m-N) / (1 - Q(z) * z^-N) * e
+// with N = fs / f samples per fundamental period (fractional, linear interpolation),
+// the zero-phase filter Q(z) = q*z + (1 - 2q) + q*z^-1 and a lead of m samples.
+// v[k] = Q(z) v[k-N] + kr * e[k] lives in a fixed power-of-two circular buffer.
+// Steps shorter than RC_SAMPLE_TIME are decimated: the buffer takes one sample of the
+// mean error every RC_SAMPLE_TIME, and the output is interpolated between its samples,
+// so one period of the grid fits the buffer at any step size.
+#define RC_GAIN 0.02 // Learning gain (per unit of peak voltage per A)
+#define RC_Q 0.25 // Q-filter side tap
+#define RC_LEAD_TIME 1e-4 // Phase lead m * dt (s)
+#define RC_MIN_SAMPLES 16 // Fewer samples per period: repetitive term off
+#define RC_SAMPLE_TIME 25e-6 // Shortest buffer sample time (s): 800 samples at 50 Hz, periods fit down to 39 Hz
+#define RC_OUTPUT_LIMIT 1.5 // Stored and applied correction limit (per unit of peak voltage)
+#define RC_MASK (RC_BUFFER_SIZE - 1)
+
+// v[k - d] for the sample k about to be written (d >= 1, fractional)
+static double rc_delayed(const InverterParams *params, double d) {
+    int n = (int)d;
+    double mu = d - n;
+    int i = params->rc_head - n;
+    double x0 = params->rc_buffer[i & RC_MASK];
+    double x1 = params->rc_buffer[(i - 1) & RC_MASK];
+    return x0 + mu * (x1 - x0);
+}
+
+// Map the stored period onto a new sample time. Runs only when dt changes, so the
+// learned waveform survives adaptive step changes.
+static void rc_resample(InverterParams *params, double dt) {
+    if (params->rc_dt > 0.0) {
+        double resampled[RC_BUFFER_SIZE];
+        double ratio = dt / params->rc_dt;
+        for (int j = 1; j < RC_BUFFER_SIZE; j++) {
+            double d = j * ratio;
+            resampled[j] = (d < RC_BUFFER_SIZE - 2) ? rc_delayed(params, fmax(d, 1.0)) : 0.0;
+        }
+        for (int j = 1; j < RC_BUFFER_SIZE; j++) {
+            params->rc_buffer[(params->rc_head - j) & RC_MASK] = resampled[j];
+        }
+    }
+    params->rc_dt = dt;
+}
+
+static double repetitive_update(InverterParams *params, double error, double dt, double frequency) {
+    double ts = fmax(dt, RC_SAMPLE_TIME); // Buffer sample time
+    if (ts != params->rc_dt) {
+        rc_resample(params, ts);
+    }
+    double period = 1.0 / (frequency * ts); // Samples per fundamental period
+    if (period < RC_MIN_SAMPLES || period > RC_BUFFER_SIZE - 2) {
+        return 0.0; // Too coarse to represent the waveform, or a period longer than the buffer
+    }
+    double lead = round(RC_LEAD_TIME / ts);
+
+    // Decimation: mean error over the buffer sample, the part of this step past it starts the next one
+    params->rc_error_sum += error * dt;
+    params->rc_elapsed += dt;
+    if (params->rc_elapsed >= ts * (1.0 - 1e-9)) {
+        double e = params->rc_error_sum / params->rc_elapsed;
+        params->rc_elapsed = fmax(params->rc_elapsed - ts, 0.0);
+        params->rc_error_sum = error * params->rc_elapsed;
+        double v = RC_Q * (rc_delayed(params, period - 1.0) + rc_delayed(params, period + 1.0)) +
+                   (1.0 - 2.0 * RC_Q) * rc_delayed(params, period) + RC_GAIN * e;
+        if (v > RC_OUTPUT_LIMIT) v = RC_OUTPUT_LIMIT;
+        if (v < -RC_OUTPUT_LIMIT) v = -RC_OUTPUT_LIMIT;
+        params->rc_buffer[params->rc_head & RC_MASK] = v;
+        params->rc_head = (params->rc_head + 1) & RC_MASK;
+    }
+    // v[k - N + m], moved on by the time since the last stored sample
+    return rc_delayed(params, fmax(period - lead + 1.0 - params->rc_elapsed / ts, 1.0));
+}
+
+// Controller section in double precision, or in the Q15/Q31 firmware emulation
+// (Festkommaemulation.c) with the given input and output full scales
+static double controller_update(const InverterParams *params, Biquad *bq, FixedBiquad *fq, double x, double in_fs,
+                                double out_fs) {
+    if (params->fixed_point) {
+        return fixed_controller_update(fq, bq, x, in_fs, out_fs);
+    }
+    return biquad_update(bq, x);
+}
+
+// Stationary-frame current control of the single-phase bridge. The bridge voltage for the next step is
+// the estimated grid fundamental (PLL voltage, frequency and phase offset when the PLL runs) plus the voltage that moves the plant from the reference at t onto the
+// reference at t + dt (exact-step inverse of the RL plant), both fed forward, plus the controller's
+// instantaneous correction u = kp*e + ki*∫e (+ Σ_h R_h(s)*e for PR). The envelope control_output stays at
+// the grid estimate; harmonic_output carries the rest of the waveform. The correction is limited, and the
+// PI integrator holds while it is (anti-windup). At coarse steps both PI gains are scaled down so that the
+// direct gain of the section times the step gain of the plant stays below CURRENT_LOOP_GAIN_LIMIT: the
+// correction acts one step late, and above that the sampled loop rings or diverges.
+#define CURRENT_CORRECTION_LIMIT 0.5 // Correction limit (per unit of peak voltage)
+#define CURRENT_LOOP_GAIN_LIMIT 0.75 // Largest (kp + ki*dt/2) * v_peak * b of the sampled loop
+
+static double stationary_current_control(InverterParams *params, double time, double dt, double error,
+                                         double ref_current, double grid_voltage) {
+    double frequency = params->pll_enabled ? params->pll_frequency : params->frequency;
+    double v_peak = params->voltage * sqrt(2);
+    double a, b;
+    plant_coefficients(dt, &a, &b);
+    double loop_gain = (params->control_kp + 0.5 * params->control_ki * dt) * v_peak * b;
+    double scale = loop_gain > CURRENT_LOOP_GAIN_LIMIT ? CURRENT_LOOP_GAIN_LIMIT / loop_gain : 1.0;
+    biquad_pi(&params->current_pi, scale * params->control_kp, scale * params->control_ki, DISCRETIZE_TUSTIN);
+    biquad_set_rate(&params->current_pi, dt);
+    double pi_state = params->current_pi.s1;
+    gint64 pi_state_fixed = params->current_pi_fixed.s1;
+    double u = controller_update(params, &params->current_pi, &params->current_pi_fixed, error, FIXED_CURRENT_FS,
+                                 FIXED_DUTY_FS);
+    if (params->control == CONTROL_PR) {
+        // Resonant terms from the harmonic bank (HarmonischeKompensation.c), tuned to the PLL frequency
+        harmonic_bank_tune(params, frequency, dt);
+        u += harmonic_bank_update(params, error);
+    }
+    if (fabs(u) > CURRENT_CORRECTION_LIMIT) {
+        u = u > 0.0 ? CURRENT_CORRECTION_LIMIT : -CURRENT_CORRECTION_LIMIT;
+        params->current_pi.s1 = pi_state;
+        params->current_pi_fixed.s1 = pi_state_fixed;
+    }
+
+    double angle = timebase_angle(params->frequency, time + dt) + params->phase;
+    double ref_next = params->control_ref_current * sin(angle);
+    double grid_angle = timebase_angle(frequency, time + dt) + (params->pll_enabled ? params->pll_phase : 0.0);
+    double v_ff = grid_voltage * sqrt(2) * sin(grid_angle) + (ref_next - a * ref_current) / b;
+    double envelope = fmin(grid_voltage / params->voltage, 1.0); // Within the duty clamp of control_update
+    params->harmonic_output = (v_ff - envelope * v_peak * sin(angle)) / v_peak + u;
+    return envelope;
+}
+
+// Control error as the firmware sees it: reference and ADC sample both quantised to Q15
+static double current_error(const InverterParams *params, double reference, double measured) {
+    if (params->fixed_point) {
+        gint16 e = q15_sub_sat(q15_from_double(reference, FIXED_CURRENT_FS), q15_from_double(measured, FIXED_CURRENT_FS));
+        return q15_to_double(e, FIXED_CURRENT_FS);
+    }
+    return reference - measured;
+}
+
+// Three-phase bridges under PI control regulate the current vector in the synchronous frame
+gboolean control_dq_active(const InverterParams *params) {
+    return params->control == CONTROL_PI && (params->type == THREE_PHASE || params->type == CASCADED_H_BRIDGE);
+}
+
+// Synchronous-reference-frame current control of the three-phase bridge
+// Plant per phase: L di/dt + R i = v - e - v_n (isolated neutral, so zero-sequence
+// voltage drives no current), e the per-phase source voltages of the grid model, so
+// unbalanced dips, frequency shifts and harmonics reach the plant. In the frame of the grid angle theta:
+//   L did/dt = vd - R id - ed + w L iq,   L diq/dt = vq - R iq - eq - w L id
+// Decoupled PI loops with grid and cross-coupling feed-forward:
+//   vd = PI(id* - id) + ed - w L iq,     vq = PI(iq* - iq) + eq + w L id
+static void dq_current_control(InverterParams *params, double time, double dt) {
+    double frequency = params->pll_enabled ? params->pll_frequency : params->frequency;
+    double w = 2 * M_PI * frequency;
+    double theta = timebase_angle(frequency, time);
+    double v_peak = params->voltage * sqrt(2);
+
+    // Bridge voltages from the previous modulation and grid source phase voltages
+    double v[3], e[3], drop[3], grid_frequency, grid_amplitude;
+    dq_to_abc_batch(&params->control_dq[0], &params->control_dq[1], &theta, &v[0], &v[1], &v[2], 1);
+    grid_pcc_source(params, time, e, drop, &grid_frequency, &grid_amplitude);
+    for (int k = 0; k < 3; k++) {
+        v[k] *= v_peak;
+    }
+    double v_n = ((v[0] - e[0]) + (v[1] - e[1]) + (v[2] - e[2])) / 3.0;
+    double a, b;
+    plant_coefficients(dt, &a, &b);
+    for (int k = 0; k < 3; k++) {
+        params->plant_current_abc[k] = a * params->plant_current_abc[k] + b * (v[k] - e[k] - v_n);
+    }
+    params->plant_current = params->plant_current_abc[0];
+
+    // Measurements in the synchronous frame
+    double i_d, i_q, e_d, e_q;
+    abc_to_dq_batch(&params->plant_current_abc[0], &params->plant_current_abc[1], &params->plant_current_abc[2],
+                    &theta, &i_d, &i_q, 1);
+    abc_to_dq_batch(&e[0], &e[1], &e[2], &theta, &e_d, &e_q, 1);
+
+    // PI zero on the plant pole, bandwidth 500 Hz or a quarter of the sample rate (rad/s)
+    double wc = fmin(2 * M_PI * 500.0, 0.25 / dt);
+    biquad_pi(&params->current_pi, PLANT_L * wc, PLANT_R * wc, DISCRETIZE_TUSTIN);
+    biquad_pi(&params->current_pi_q, PLANT_L * wc, PLANT_R * wc, DISCRETIZE_TUSTIN);
+    biquad_set_rate(&params->current_pi, dt);
+    biquad_set_rate(&params->current_pi_q, dt);
+    double ref_d = params->control_ref_current * cos(params->phase);
+    double ref_q = params->control_ref_current * sin(params->phase);
+    double pi_d = params->current_pi.s1, pi_q = params->current_pi_q.s1;
+    gint64 pi_d_fixed = params->current_pi_fixed.s1, pi_q_fixed = params->current_pi_q_fixed.s1;
+    double v_d = controller_update(params, &params->current_pi, &params->current_pi_fixed, current_error(params, ref_d, i_d),
+                                   FIXED_CURRENT_FS, FIXED_VOLTAGE_FS) + e_d - w * PLANT_L * i_q;
+    double v_q = controller_update(params, &params->current_pi_q, &params->current_pi_q_fixed,
+                                   current_error(params, ref_q, i_q), FIXED_CURRENT_FS, FIXED_VOLTAGE_FS) + e_q + w * PLANT_L * i_d;
+
+    // Modulation vector limited to the linear range of space-vector modulation (DC link
+    // 2 * Vpeak, as in the MPC level set); integrators hold while limited (anti-windup)
+    const double m_max = 2.0 / sqrt(3.0);
+    double m_d = v_d / v_peak, m_q = v_q / v_peak;
+    double m = hypot(m_d, m_q);
+    if (m > m_max) {
+        m_d *= m_max / m;
+        m_q *= m_max / m;
+        m = m_max;
+        params->current_pi.s1 = pi_d;
+        params->current_pi_q.s1 = pi_q;
+        params->current_pi_fixed.s1 = pi_d_fixed;
+        params->current_pi_q_fixed.s1 = pi_q_fixed;
+    }
+    params->control_dq[0] = m_d;
+    params->control_dq[1] = m_q;
+    params->control_output = m; // Modulation index
+}
+
+void control_update(InverterParams *params, double time, double dt) {
+    if (control_dq_active(params)) {
+        params->harmonic_output = 0.0;
+        dq_current_control(params, time, dt);
+        return;
+    }
     double grid_voltage = params->pll_enabled ? params->pll_voltage : 220.0;
 
     // Reference signals
-    double ref_current = params->control_ref_current * sin(2 * M_PI * params->frequency * time + params->phase);
-    double ref_voltage = params->control_ref_voltage * sin(2 * M_PI * params->frequency * time + params->phase);
-    // Measured current (from plant model with current duty)
-    double meas_current = plant_model(params->control_output, time, &current, grid_voltage, params->voltage, params->frequency, params->phase);
-    double error = ref_current - meas_current; // Current control
+    double ref_current = params->control_ref_current * sin(timebase_angle(params->frequency, time) + params->phase);
+    double ref_voltage = params->control_ref_voltage * sin(timebase_angle(params->frequency, time) + params->phase);
+    // Inverter output voltage: modulated fundamental plus harmonic compensation, or the level chosen by a set-based MPC
+    double v_peak = params->voltage * sqrt(2);
+    double v_inv = params->control_output * v_peak * sin(timebase_angle(params->frequency, time) + params->phase) +
+                   params->harmonic_output * v_peak;
+    if (params->control == CONTROL_MPC && params->mpc_variant != MPC_DUTY_GRID) {
+        v_inv = params->mpc_level * v_peak;
+    }
+    // Measured current (from plant model with the previous control action)
+    double meas_current = plant_model(params, v_inv, time, dt, params->plant_current);
+    params->plant_current = meas_current;
+    double error = current_error(params, ref_current, meas_current); // Current control
 
     double control_signal = 0.0;
+    params->harmonic_output = 0.0; // Only PI, PR and repetitive control shape the waveform
     switch (params->control) {
-        case CONTROL_PI: {
+        case CONTROL_PI:
             // PI control: u = kp*e + ki*∫e
-            const double kp = 0.1;
-            const double ki = 5.0;
-            integral += error * dt;
-            control_signal = kp * error + ki * integral;
+        case CONTROL_PR:
+            // PR control: u = kp*e + ki*∫e + Σ_h kr_h*R_h(s)*e, R_h(s) = 2*wc*s / (s^2 + 2*wc*s + (h*w)^2)
+            control_signal = stationary_current_control(params, time, dt, error, ref_current, grid_voltage);
             break;
-        }
-        case CONTROL_PR: {
-            // PR control: u = kp*e + ki*∫e + kr*e_resonant
-            const double kp = 0.1;
-            const double ki = 5.0;
-            const double kr = 50.0;
-            const double w = 2 * M_PI * params->frequency;
-            integral += error * dt;
-            double resonant = kr * sin(w * time) * error; // Simplified resonant term
-            control_signal = kp * error + ki * integral + resonant;
-            break;
-        }
         case CONTROL_SMC: {
             // Sliding Mode Control: s = e + c*de/dt
             const double c = 0.01;
             const double k = 0.5;
-            double de_dt = (error - prev_error) / dt;
+            double de_dt = (error - params->control_prev_error) / dt;
             double s = error + c * de_dt; // Sliding surface
             control_signal = k * (s > 0 ? 1.0 : -1.0); // Bang-bang control
-            prev_error = error;
+            params->control_prev_error = error;
             break;
         }
-        case CONTROL_MPC: {
-            // Model Predictive Control: minimize cost over horizon
-            const double horizon = 0.1; // 100ms
-            const int steps = 2; // Prediction steps
-            double min_cost = 1e6;
-            double best_duty = params->control_output;
-            for (int i = 0; i <= 10; i++) { // Test duty cycles 0 to 1
-                double test_duty = i / 10.0;
-                double cost = 0.0;
-                double temp_current = current;
-                for (int j = 0; j < steps; j++) {
-                    double t_future = time + j * dt;
-                    double i_future = plant_model(test_duty, t_future, &temp_current, grid_voltage, params->voltage, params->frequency, params->phase);
-                    double ref_future = params->control_ref_current * sin(2 * M_PI * params->frequency * t_future + params->phase);
-                    cost += (ref_future - i_future) * (ref_future - i_future);
-                }
-                if (cost < min_cost) {
-                    min_cost = cost;
-                    best_duty = test_duty;
-                }
-            }
-            control_signal = best_duty;
+        case CONTROL_REPETITIVE: {
+            // Repetitive control: full duty as grid feed-forward, proportional and periodic terms on the waveform
+            const double kp = 0.1;
+            control_signal = 1.0;
+            double rc = repetitive_update(params, error, dt, params->pll_enabled ? params->pll_frequency : params->frequency);
+            params->harmonic_output = kp * error + rc;
             break;
         }
+        case CONTROL_MPC:
+            // Model Predictive Control (ModellpraediktiveRegelung.c)
+            control_signal = mpc_update(params, time, dt, meas_current, grid_voltage);
+            break;
         default:
             control_signal = 1.0; // No control
             break;
@@ -0,0 +1,42 @@
+#include "inverter.h"
+#include <math.h>
+
+// Streaming symmetrical components (decoupled double synchronous reference frame)
+// With z = beta + j*alpha the three-phase voltage is z = V+ e^(j*theta) + V- e^(-j*theta).
+// Rotating by -theta and +theta gives the two frames; each contains its own sequence as
+// a DC value plus the other sequence at twice the grid frequency. Subtracting the other
+// frame's filtered estimate, rotated by 2*theta, removes the 2w ripple without a notch
+// filter, and the low-pass filters then settle in a few milliseconds. One sin/cos pair
+// per sample, constant cost.
+
+#define SEQUENCE_FILTER_RATIO 0.70710678 // Filter cutoff / grid frequency (1 / sqrt(2))
+
+void sequence_extract(SequenceExtractor *seq, double alpha, double beta, double theta, double w, double dt,
+                      double *pos, double *neg) {
+    double s = sin(theta), c = cos(theta);
+    double s2 = 2.0 * s * c, c2 = c * c - s * s; // 2*theta by the double-angle identities
+
+    // Park transforms at +theta and -theta
+    double d_pos = alpha * s + beta * c, q_pos = alpha * c - beta * s;
+    double d_neg = -alpha * s + beta * c, q_neg = alpha * c + beta * s;
+
+    // Decoupling: remove the other sequence, rotated into this frame
+    const double *fn = seq->neg, *fp = seq->pos;
+    pos[0] = d_pos - (fn[0] * c2 + fn[1] * s2);
+    pos[1] = q_pos - (fn[1] * c2 - fn[0] * s2);
+    neg[0] = d_neg - (fp[0] * c2 - fp[1] * s2);
+    neg[1] = q_neg - (fp[1] * c2 + fp[0] * s2);
+
+    // First-order low-pass, exact for the step
+    double k = 1.0 - exp(-SEQUENCE_FILTER_RATIO * fabs(w) * dt);
+    for (int i = 0; i < 2; i++) {
+        seq->pos[i] += k * (pos[i] - seq->pos[i]);
+        seq->neg[i] += k * (neg[i] - seq->neg[i]);
+    }
+}
+
+// Voltage unbalance factor |V-| / |V+|
+double sequence_unbalance(const SequenceExtractor *seq) {
+    double v_pos = hypot(seq->pos[0], seq->pos[1]);
+    return v_pos > 1.0 ? hypot(seq->neg[0], seq->neg[1]) / v_pos : 0.0;
+}
\ No newline at end of file
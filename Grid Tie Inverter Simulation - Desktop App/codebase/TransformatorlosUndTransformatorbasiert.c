@@ -1,17 +1,17 @@
 #include "inverter.h"
 
 void apply_transformerless(InverterParams *params, double *output) {
-    // Transformerless: Direct output with 98% efficiency
-    const double efficiency = 0.98;
+    // Transformerless: Direct output, efficiency from the loss map at the present load, DC voltage and junction temperature
+    double efficiency = inverter_efficiency(params);
     for (int i = 0; i < 3; i++) {
         output[i] *= efficiency;
     }
 }
 
 void apply_transformer_based(InverterParams *params, double *output) {
-    // Transformer-based: Apply turns ratio (1:1.1) and 90% efficiency
+    // Transformer-based: Apply turns ratio (1:1.1) and the loss-map efficiency, transformer losses included
     const double turns_ratio = 1.1; // Voltage boost
-    const double efficiency = 0.90;
+    double efficiency = inverter_efficiency(params);
     for (int i = 0; i < 3; i++) {
         output[i] *= turns_ratio * efficiency;
     }
@@ -0,0 +1,402 @@
+#include "inverter.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Semiconductor loss model and efficiency maps
+// Every bridge leg is an IGBT / diode pair per switch position under sinusoidal PWM at unity power factor.
+// The device data are the datasheet curves, tabulated over current at 25 and 150 °C: output characteristics
+// v_ce(i) and v_f(i), switching energy E_on + E_off (i) and reverse-recovery energy E_rec(i) at the test
+// voltage. Over the half wave in which a leg's upper IGBT and lower diode carry the current i = Ip sin(theta)
+// at duty d = (1 + m sin(theta)) / 2, each sample contributes
+//   IGBT: d * v_ce(i) * i + f_sw * E_ts(i) * (V / V_ref)^1.3,  diode: (1 - d) * v_f(i) * i + f_sw * E_rec(i) * (V / V_ref)^1.3
+// and the other half wave mirrors it onto the other pair. The curves are not linear in current, so there is
+// no closed form; the half wave is integrated with LOSS_WAVE_SAMPLES midpoint samples. On top come the output
+// filter copper, the auxiliary supply and, for the transformer-based design, the 50 Hz transformer.
+// Integrating a fundamental cycle for every sample is far too slow for the simulation and yield studies, so
+// they use maps of the total loss over (Tj, Vdc, P), built once per topology and design for all threads. The
+// loss rather than the efficiency is tabulated: it is smooth where the efficiency drops to zero at no load, so
+// trilinear interpolation stays accurate down to a few percent load.
+
+#define LOSS_SWITCHING_FREQUENCY 16e3 // Bridge PWM frequency (Hz)
+#define LOSS_V_REF 400.0 // Datasheet switching test voltage (V)
+#define LOSS_V_EXPONENT 1.3 // Switching energy over blocking voltage
+#define LOSS_CURVE_POINTS 8 // Current samples of the datasheet curves
+#define LOSS_WAVE_SAMPLES 64 // Midpoint samples per half wave
+#define LOSS_AUXILIARY 10.0 // Control, gate drive and fan supply (W)
+#define LOSS_FILTER_RESISTANCE 0.08 // Output filter inductor resistance per phase (Ω)
+#define LOSS_TRANSFORMER_CORE 40.0 // Transformer no-load loss (W)
+#define LOSS_TRANSFORMER_COPPER 75.0 // Transformer copper loss at rated power (W)
+#define LOSS_TURNS_RATIO 1.1 // Transformer-based design: grid voltage over bridge voltage
+#define LOSS_AC_VOLTAGE 220.0 // Grid voltage the maps are built for (V RMS)
+
+// Datasheet curves of one device over current, at 25 °C and 150 °C
+typedef struct {
+    double voltage[2][LOSS_CURVE_POINTS]; // On-state voltage (V)
+    double energy[2][LOSS_CURVE_POINTS]; // Switching energy per event at V_ref (mJ)
+} Semiconductor;
+
+static const double loss_curve_current[LOSS_CURVE_POINTS] = { 0.0, 5.0, 10.0, 20.0, 30.0, 40.0, 60.0, 80.0 };
+
+// 650 V / 40 A trench IGBT (E_on + E_off) and its co-packed diode (E_rec)
+static const Semiconductor loss_igbt = {
+    { { 0.00, 0.95, 1.07, 1.27, 1.42, 1.55, 1.80, 2.05 }, { 0.00, 0.85, 1.00, 1.27, 1.50, 1.70, 2.07, 2.45 } },
+    { { 0.00, 0.15, 0.28, 0.52, 0.78, 1.10, 1.85, 2.75 }, { 0.00, 0.22, 0.40, 0.75, 1.10, 1.50, 2.45, 3.60 } },
+};
+static const Semiconductor loss_diode = {
+    { { 0.00, 0.95, 1.10, 1.30, 1.45, 1.57, 1.78, 1.96 }, { 0.00, 0.75, 0.92, 1.17, 1.36, 1.52, 1.80, 2.05 } },
+    { { 0.00, 0.08, 0.13, 0.21, 0.28, 0.34, 0.45, 0.55 }, { 0.00, 0.16, 0.26, 0.42, 0.55, 0.67, 0.88, 1.05 } },
+};
+
+// Bridge structure per inverter type
+typedef struct {
+    int phases; // Phases sharing the output power
+    int legs; // Switching legs per phase
+    int series; // Devices conducting in series per switch position
+    double blocking; // Switched voltage as a share of Vdc
+    double m_gain; // Modulation index = m_gain * V_peak / Vdc
+} BridgeTopology;
+
+static const BridgeTopology loss_topologies[5] = {
+    { 1, 2, 1, 1.0, 1.0 }, // Single-phase H-bridge, unipolar PWM
+    { 3, 1, 1, 1.0, 2.0 }, // Three-phase two-level
+    { 3, 1, 2, 0.5, 2.0 }, // NPC: two devices in the current path, each switching half the bus
+    { 3, 1, 2, 0.5, 2.0 }, // Flying capacitor, same device stress as NPC
+    { 3, 2, 1, 1.0, 1.0 }, // Cascaded H-bridge: one full bridge per phase
+};
+
+// Curve value at a current, linear in current and in temperature between the 25 and 150 °C curves
+static double loss_curve(const double curve[2][LOSS_CURVE_POINTS], double current, double w_hot) {
+    int k = 1;
+    while (k < LOSS_CURVE_POINTS - 1 && current > loss_curve_current[k]) k++;
+    double u = (current - loss_curve_current[k - 1]) / (loss_curve_current[k] - loss_curve_current[k - 1]);
+    double cold = curve[0][k - 1] + u * (curve[0][k] - curve[0][k - 1]);
+    double hot = curve[1][k - 1] + u * (curve[1][k] - curve[1][k - 1]);
+    return cold + w_hot * (hot - cold);
+}
+
+void inverter_losses(InverterType type, DesignType design, double power, double v_dc, double t_junction,
+                     InverterLosses *losses) {
+    const BridgeTopology *topo = &loss_topologies[type];
+    memset(losses, 0, sizeof(*losses));
+    losses->devices = 2 * topo->legs * topo->phases * topo->series;
+    losses->passive = LOSS_AUXILIARY;
+    if (power > 0.0) {
+        double v_ac = design == TRANSFORMER_BASED ? LOSS_AC_VOLTAGE / LOSS_TURNS_RATIO : LOSS_AC_VOLTAGE;
+        double i_rms = power / (topo->phases * v_ac);
+        double i_peak = sqrt(2.0) * i_rms;
+        double m = fmin(topo->m_gain * sqrt(2.0) * v_ac / v_dc, 1.0); // Overmodulation clipped
+        double legs = topo->legs * topo->phases;
+        double w_hot = (t_junction - 25.0) / 125.0;
+        double e_scale = LOSS_SWITCHING_FREQUENCY * 1e-3 * pow(topo->blocking * v_dc / LOSS_V_REF, LOSS_V_EXPONENT);
+
+        // Half wave of one leg: upper IGBT and lower diode; the mirrored half wave loads the other pair equally
+        double igbt_c = 0.0, diode_c = 0.0, igbt_s = 0.0, diode_s = 0.0;
+        for (int k = 0; k < LOSS_WAVE_SAMPLES; k++) {
+            double s = sin(M_PI * (k + 0.5) / LOSS_WAVE_SAMPLES);
+            double i = i_peak * s, d = 0.5 * (1.0 + m * s);
+            igbt_c += d * loss_curve(loss_igbt.voltage, i, w_hot) * i;
+            diode_c += (1.0 - d) * loss_curve(loss_diode.voltage, i, w_hot) * i;
+            igbt_s += loss_curve(loss_igbt.energy, i, w_hot);
+            diode_s += loss_curve(loss_diode.energy, i, w_hot);
+        }
+        double scale = legs / LOSS_WAVE_SAMPLES; // Half-wave mean per pair, two pairs per leg each half the cycle
+        losses->igbt_conduction = scale * topo->series * igbt_c;
+        losses->diode_conduction = scale * topo->series * diode_c;
+        losses->igbt_switching = scale * e_scale * igbt_s;
+        losses->diode_switching = scale * e_scale * diode_s;
+
+        losses->passive += topo->phases * LOSS_FILTER_RESISTANCE * i_rms * i_rms;
+    }
+    if (design == TRANSFORMER_BASED) {
+        double load = power / LOSS_RATED_POWER;
+        losses->passive += LOSS_TRANSFORMER_CORE + LOSS_TRANSFORMER_COPPER * load * load;
+    }
+    losses->total = losses->igbt_conduction + losses->diode_conduction + losses->igbt_switching +
+                    losses->diode_switching + losses->passive;
+}
+
+static EfficiencyMap loss_maps[5][2];
+static double loss_map_build_ms; // Wall time of building all maps
+
+static void loss_maps_init(void) {
+    static gsize ready;
+    if (!g_once_init_enter(&ready)) return;
+    gint64 start = g_get_monotonic_time();
+    for (int type = 0; type < 5; type++) {
+        for (int design = 0; design < 2; design++) {
+            EfficiencyMap *map = &loss_maps[type][design];
+            for (int t = 0; t < LOSS_MAP_TEMP_POINTS; t++) {
+                double tj = LOSS_MAP_TEMP_MIN + t * (LOSS_MAP_TEMP_MAX - LOSS_MAP_TEMP_MIN) / (LOSS_MAP_TEMP_POINTS - 1);
+                for (int v = 0; v < LOSS_MAP_VOLTAGE_POINTS; v++) {
+                    double vdc = LOSS_MAP_VOLTAGE_MIN +
+                                 v * (LOSS_MAP_VOLTAGE_MAX - LOSS_MAP_VOLTAGE_MIN) / (LOSS_MAP_VOLTAGE_POINTS - 1);
+                    for (int p = 0; p < LOSS_MAP_POWER_POINTS; p++) {
+                        InverterLosses losses;
+                        inverter_losses(type, design, p * LOSS_MAP_POWER_MAX / (LOSS_MAP_POWER_POINTS - 1), vdc, tj,
+                                        &losses);
+                        map->loss[t][v][p] = (float)losses.total;
+                        map->igbt[t][v][p] = (float)((losses.igbt_conduction + losses.igbt_switching) / losses.devices);
+                        map->diode[t][v][p] = (float)((losses.diode_conduction + losses.diode_switching) / losses.devices);
+                        map->devices = losses.devices;
+                    }
+                }
+            }
+        }
+    }
+    loss_map_build_ms = (g_get_monotonic_time() - start) * 1e-3;
+    g_once_init_leave(&ready, 1);
+}
+
+const EfficiencyMap *efficiency_map(InverterType type, DesignType design) {
+    loss_maps_init();
+    return &loss_maps[type][design];
+}
+
+// Grid coordinate: cell index clamped to the map and weight, so the edge cells extrapolate linearly
+static int loss_map_cell(double x, double min, double inv_step, int points, double *u) {
+    double s = (x - min) * inv_step;
+    int k = (int)s;
+    if (k < 0) k = 0;
+    if (k > points - 2) k = points - 2;
+    *u = s - k;
+    return k;
+}
+
+static double loss_map_lookup(const float table[LOSS_MAP_TEMP_POINTS][LOSS_MAP_VOLTAGE_POINTS][LOSS_MAP_POWER_POINTS],
+                              double power, double v_dc, double t_junction) {
+    double up, uv, ut;
+    int p = loss_map_cell(power, 0.0, (LOSS_MAP_POWER_POINTS - 1) / LOSS_MAP_POWER_MAX, LOSS_MAP_POWER_POINTS, &up);
+    int v = loss_map_cell(v_dc, LOSS_MAP_VOLTAGE_MIN, (LOSS_MAP_VOLTAGE_POINTS - 1) / (LOSS_MAP_VOLTAGE_MAX - LOSS_MAP_VOLTAGE_MIN),
+                          LOSS_MAP_VOLTAGE_POINTS, &uv);
+    int t = loss_map_cell(t_junction, LOSS_MAP_TEMP_MIN, (LOSS_MAP_TEMP_POINTS - 1) / (LOSS_MAP_TEMP_MAX - LOSS_MAP_TEMP_MIN),
+                          LOSS_MAP_TEMP_POINTS, &ut);
+    const float *m00 = &table[t][v][p], *m01 = &table[t][v + 1][p];
+    const float *m10 = &table[t + 1][v][p], *m11 = &table[t + 1][v + 1][p];
+    double a = m00[0] + up * (m00[1] - m00[0]), b = m01[0] + up * (m01[1] - m01[0]);
+    double c = m10[0] + up * (m10[1] - m10[0]), d = m11[0] + up * (m11[1] - m11[0]);
+    double lo = a + uv * (b - a), hi = c + uv * (d - c);
+    return lo + ut * (hi - lo);
+}
+
+double efficiency_map_loss(const EfficiencyMap *map, double power, double v_dc, double t_junction) {
+    return loss_map_lookup(map->loss, power, v_dc, t_junction);
+}
+
+// Losses of one IGBT and one diode, for the thermal model
+void efficiency_map_device_losses(const EfficiencyMap *map, double power, double v_dc, double t_junction,
+                                  double *p_igbt, double *p_diode) {
+    *p_igbt = loss_map_lookup(map->igbt, power, v_dc, t_junction);
+    *p_diode = loss_map_lookup(map->diode, power, v_dc, t_junction);
+}
+
+// Batched lookups for yield studies: the same interpolation as efficiency_map_loss() in a branch-free
+// structure-of-arrays loop with flat indices, which GCC vectorises with gathers at -O3 (SSE2 to AVX-512)
+void efficiency_map_loss_batch(const EfficiencyMap *map, const double *power, const double *v_dc,
+                               const double *t_junction, double *loss, int n) {
+    const float *m = &map->loss[0][0][0];
+    const int sv = LOSS_MAP_POWER_POINTS, st = LOSS_MAP_VOLTAGE_POINTS * LOSS_MAP_POWER_POINTS;
+    const double ip = (LOSS_MAP_POWER_POINTS - 1) / LOSS_MAP_POWER_MAX;
+    const double iv = (LOSS_MAP_VOLTAGE_POINTS - 1) / (LOSS_MAP_VOLTAGE_MAX - LOSS_MAP_VOLTAGE_MIN);
+    const double it = (LOSS_MAP_TEMP_POINTS - 1) / (LOSS_MAP_TEMP_MAX - LOSS_MAP_TEMP_MIN);
+    for (int i = 0; i < n; i++) {
+        // Cells are clamped in integers: GCC will not if-convert floating-point compares under trapping math
+        double sp = power[i] * ip, sv_ = (v_dc[i] - LOSS_MAP_VOLTAGE_MIN) * iv, st_ = (t_junction[i] - LOSS_MAP_TEMP_MIN) * it;
+        int p = (int)sp, v = (int)sv_, t = (int)st_;
+        p = p < 0 ? 0 : p;
+        p = p > LOSS_MAP_POWER_POINTS - 2 ? LOSS_MAP_POWER_POINTS - 2 : p;
+        v = v < 0 ? 0 : v;
+        v = v > LOSS_MAP_VOLTAGE_POINTS - 2 ? LOSS_MAP_VOLTAGE_POINTS - 2 : v;
+        t = t < 0 ? 0 : t;
+        t = t > LOSS_MAP_TEMP_POINTS - 2 ? LOSS_MAP_TEMP_POINTS - 2 : t;
+        double up = sp - p, uv = sv_ - v, ut = st_ - t;
+        int k = t * st + v * sv + p;
+        double a = m[k] + up * (m[k + 1] - m[k]);
+        double b = m[k + sv] + up * (m[k + sv + 1] - m[k + sv]);
+        double c = m[k + st] + up * (m[k + st + 1] - m[k + st]);
+        double d = m[k + st + sv] + up * (m[k + st + sv + 1] - m[k + st + sv]);
+        double lo = a + uv * (b - a), hi = c + uv * (d - c);
+        loss[i] = lo + ut * (hi - lo);
+    }
+}
+
+// AC output power at the reference current (W)
+double inverter_power(const InverterParams *params) {
+    int phases = loss_topologies[params->type].phases;
+    return phases * params->voltage * params->control_ref_current / sqrt(2.0);
+}
+
+// Efficiency at the present operating point. Below the first map point that point's efficiency is used, so an
+// idle bridge still shows its waveform.
+double inverter_efficiency(const InverterParams *params) {
+    const EfficiencyMap *map = efficiency_map(params->type, params->design);
+    double power = fmax(inverter_power(params), LOSS_MAP_POWER_MAX / (LOSS_MAP_POWER_POINTS - 1));
+    return power / (power + efficiency_map_loss(map, power, dc_link_voltage(params), params->junction_temperature));
+}
+
+// Mission profile and yield study: a synthetic year of PV power on a string inverter without boost stage
+static double efficiency_bench_random(guint32 *rng) {
+    *rng ^= *rng << 13;
+    *rng ^= *rng >> 17;
+    *rng ^= *rng << 5;
+    return (*rng >> 8) / 16777216.0; // 0 to 1
+}
+
+// One day of one-minute DC power, string MPP voltage and ambient temperature around the inverter
+void mission_profile_day(int day, double ambient_offset, guint32 *rng, double *p_dc, double *v_dc, double *ambient) {
+    double summer = 0.5 - 0.5 * cos(2.0 * M_PI * (day - 172 + 182.5) / 365.0); // 1 at the June solstice
+    double day_length = 8.0 + 8.0 * summer, noon_gain = 0.55 + 0.45 * summer;
+    double clear = 1.0;
+    for (int i = 0; i < MISSION_PROFILE_SAMPLES; i++) {
+        double hour = i / 60.0;
+        if (i % 30 == 0) clear = 0.25 + 0.75 * efficiency_bench_random(rng); // Half-hourly cloud cover
+        double x = (hour - (12.0 - day_length / 2)) / day_length;
+        double irradiance = x > 0.0 && x < 1.0 ? 1000.0 * noon_gain * sin(M_PI * x) * clear : 0.0;
+        double air = 2.0 + 18.0 * summer + 5.0 * sin(2.0 * M_PI * (hour - 9.0) / 24.0);
+        double cell = air + 0.03 * irradiance;
+        p_dc[i] = 1.1 * LOSS_RATED_POWER * irradiance / 1000.0 * (1.0 - 0.004 * (cell - 25.0)); // DC/AC ratio 1.1
+        v_dc[i] = 580.0 * (1.0 - 0.0035 * (cell - 25.0)); // MPP voltage of the string
+        ambient[i] = air + ambient_offset;
+    }
+}
+
+// AC power delivering p_dc: two fixed-point passes of P_ac = P_dc - loss(P_ac), clipped at the rating
+static void efficiency_bench_ac(const EfficiencyMap *map, InverterType type, DesignType design, const double *p_dc,
+                                const double *v_dc, const double *tj, double *p_ac, double *scratch, gboolean use_map) {
+    for (int i = 0; i < MISSION_PROFILE_SAMPLES; i++) p_ac[i] = fmin(0.97 * p_dc[i], LOSS_RATED_POWER);
+    for (int pass = 0; pass < 2; pass++) {
+        if (use_map) {
+            efficiency_map_loss_batch(map, p_ac, v_dc, tj, scratch, MISSION_PROFILE_SAMPLES);
+        } else {
+            for (int i = 0; i < MISSION_PROFILE_SAMPLES; i++) {
+                InverterLosses losses;
+                inverter_losses(type, design, p_ac[i], v_dc[i], tj[i], &losses);
+                scratch[i] = losses.total;
+            }
+        }
+        for (int i = 0; i < MISSION_PROFILE_SAMPLES; i++) {
+            p_ac[i] = p_dc[i] < MISSION_PROFILE_START ? 0.0 : fmin(fmax(p_dc[i] - scratch[i], 0.0), LOSS_RATED_POWER);
+        }
+    }
+}
+
+// Headless mode: --efficiency-bench [type 0-4] [design 0-1]
+int efficiency_bench_main(int argc, char *argv[]) {
+    int type = argc > 2 ? atoi(argv[2]) : SINGLE_PHASE;
+    int design = argc > 3 ? atoi(argv[3]) : TRANSFORMERLESS;
+    if (type < SINGLE_PHASE || type > CASCADED_H_BRIDGE || design < TRANSFORMERLESS || design > TRANSFORMER_BASED) {
+        fprintf(stderr, "[Error] Efficiency bench: type must be 0 to 4 and design 0 or 1\n");
+        return 1;
+    }
+    static const char *types[5] = { "single-phase", "three-phase", "NPC", "flying capacitor", "cascaded H-bridge" };
+    const EfficiencyMap *map = efficiency_map(type, design);
+    printf("Efficiency map: %s, %s, %.0f kW, %.0f kHz; %d x %d x %d points (%zu bytes per map), all 10 maps built in %.2f ms\n",
+           types[type], design == TRANSFORMERLESS ? "transformerless" : "transformer-based", LOSS_RATED_POWER * 1e-3,
+           LOSS_SWITCHING_FREQUENCY * 1e-3, LOSS_MAP_POWER_POINTS, LOSS_MAP_VOLTAGE_POINTS, LOSS_MAP_TEMP_POINTS,
+           sizeof(EfficiencyMap), loss_map_build_ms);
+
+    // Part-load efficiency from the map at 75 °C
+    static const double loads[] = { 0.05, 0.10, 0.20, 0.30, 0.50, 0.75, 1.00 };
+    static const double eu_weights[] = { 0.03, 0.06, 0.13, 0.10, 0.48, 0.0, 0.20 };
+    static const double cec_weights[] = { 0.0, 0.04, 0.05, 0.12, 0.21, 0.53, 0.05 };
+    static const double voltages[] = { 350.0, 400.0, 500.0, 600.0, 700.0 };
+    printf("\nEfficiency (%%) at Tj 75 °C\n%-8s", "load");
+    for (int j = 0; j < 5; j++) printf(" %7.0f V", voltages[j]);
+    printf("\n");
+    double eu[5] = { 0 }, cec[5] = { 0 };
+    for (int i = 0; i < 7; i++) {
+        double power = loads[i] * LOSS_RATED_POWER;
+        printf("%6.0f%% ", loads[i] * 100);
+        for (int j = 0; j < 5; j++) {
+            double eta = power / (power + efficiency_map_loss(map, power, voltages[j], 75.0));
+            eu[j] += eu_weights[i] * eta;
+            cec[j] += cec_weights[i] * eta;
+            printf(" %9.2f", eta * 100);
+        }
+        printf("\n");
+    }
+    printf("%-8s", "EU");
+    for (int j = 0; j < 5; j++) printf(" %9.2f", eu[j] * 100);
+    printf("\n%-8s", "CEC");
+    for (int j = 0; j < 5; j++) printf(" %9.2f", cec[j] * 100);
+    printf("\n");
+
+    InverterLosses losses;
+    inverter_losses(type, design, LOSS_RATED_POWER, 400.0, 75.0, &losses);
+    printf("\nLosses at rated power, 400 V, 75 °C: IGBT %.1f + %.1f W (conduction + switching), diode %.1f + %.1f W, "
+           "passive %.1f W, total %.1f W\n", losses.igbt_conduction, losses.igbt_switching, losses.diode_conduction,
+           losses.diode_switching, losses.passive, losses.total);
+
+    // Interpolation error and cost over random operating points
+    enum { N = 1 << 16 };
+    double *p = g_new(double, N), *v = g_new(double, N), *t = g_new(double, N), *out = g_new(double, N);
+    guint32 rng = 0xEFF1C1Eu;
+    for (int i = 0; i < N; i++) {
+        p[i] = LOSS_RATED_POWER * (0.05 + 0.95 * efficiency_bench_random(&rng));
+        v[i] = LOSS_MAP_VOLTAGE_MIN + (LOSS_MAP_VOLTAGE_MAX - LOSS_MAP_VOLTAGE_MIN) * efficiency_bench_random(&rng);
+        t[i] = LOSS_MAP_TEMP_MIN + (LOSS_MAP_TEMP_MAX - LOSS_MAP_TEMP_MIN) * efficiency_bench_random(&rng);
+    }
+    double err = 0.0, sink = 0.0;
+    gint64 start = g_get_monotonic_time();
+    for (int i = 0; i < N; i++) {
+        inverter_losses(type, design, p[i], v[i], t[i], &losses);
+        out[i] = losses.total;
+    }
+    double ns_full = (g_get_monotonic_time() - start) * 1e3 / N;
+    start = g_get_monotonic_time();
+    for (int i = 0; i < N; i++) sink += efficiency_map_loss(map, p[i], v[i], t[i]);
+    double ns_map = (g_get_monotonic_time() - start) * 1e3 / N;
+    for (int i = 0; i < N; i++) {
+        double eta = p[i] / (p[i] + out[i]);
+        err = fmax(err, fabs(eta - p[i] / (p[i] + efficiency_map_loss(map, p[i], v[i], t[i]))));
+    }
+    start = g_get_monotonic_time();
+    efficiency_map_loss_batch(map, p, v, t, out, N);
+    double ns_batch = (g_get_monotonic_time() - start) * 1e3 / N;
+    printf("\n%d random points at 5-100%% load: max efficiency error of the map %.4f points; full model %.1f ns, "
+           "map lookup %.1f ns, batched %.1f ns per point (checksum %.0f)\n", N, err * 100, ns_full, ns_map, ns_batch,
+           sink * 1e-6);
+    g_free(p);
+    g_free(v);
+    g_free(t);
+    g_free(out);
+
+    // Annual yield at one-minute resolution
+    double *p_dc = g_new(double, MISSION_PROFILE_SAMPLES), *v_dc = g_new(double, MISSION_PROFILE_SAMPLES);
+    double *tj = g_new(double, MISSION_PROFILE_SAMPLES), *p_ac = g_new(double, MISSION_PROFILE_SAMPLES);
+    double *scratch = g_new(double, MISSION_PROFILE_SAMPLES);
+    double constant = design == TRANSFORMERLESS ? 0.98 : 0.90; // The former fixed efficiencies
+    double e_dc = 0.0, e_const = 0.0, e_map = 0.0, e_full = 0.0, us_map = 0.0, us_full = 0.0;
+    rng = 0x5EA5027u;
+    for (int day = 0; day < 365; day++) {
+        mission_profile_day(day, 0.0, &rng, p_dc, v_dc, tj);
+        for (int i = 0; i < MISSION_PROFILE_SAMPLES; i++) {
+            tj[i] += 15.0 + 60.0 * fmin(p_dc[i] / LOSS_RATED_POWER, 1.0); // Steady-state junction rise
+        }
+        for (int i = 0; i < MISSION_PROFILE_SAMPLES; i++) {
+            e_dc += p_dc[i] / 60e3;
+            e_const += fmin(p_dc[i] * constant, LOSS_RATED_POWER) / 60e3;
+        }
+        start = g_get_monotonic_time();
+        efficiency_bench_ac(map, type, design, p_dc, v_dc, tj, p_ac, scratch, TRUE);
+        us_map += g_get_monotonic_time() - start;
+        for (int i = 0; i < MISSION_PROFILE_SAMPLES; i++) e_map += p_ac[i] / 60e3;
+        start = g_get_monotonic_time();
+        efficiency_bench_ac(map, type, design, p_dc, v_dc, tj, p_ac, scratch, FALSE);
+        us_full += g_get_monotonic_time() - start;
+        for (int i = 0; i < MISSION_PROFILE_SAMPLES; i++) e_full += p_ac[i] / 60e3;
+    }
+    printf("\nYear at 1-minute steps, 5.5 kWp string at 480-620 V: DC %.0f kWh\n", e_dc);
+    printf("%-22s %10s %10s %12s\n", "model", "AC (kWh)", "yield (%)", "time (ms)");
+    printf("%-22s %10.1f %10.2f %12s\n", "constant factor", e_const, e_const / e_dc * 100, "-");
+    printf("%-22s %10.1f %10.2f %12.1f\n", "full loss model", e_full, e_full / e_dc * 100, us_full * 1e-3);
+    printf("%-22s %10.1f %10.2f %12.1f\n", "efficiency map", e_map, e_map / e_dc * 100, us_map * 1e-3);
+    printf("Map against full model: %+.3f%% energy, %.1fx faster\n", (e_map / e_full - 1.0) * 100,
+           us_map > 0.0 ? us_full / us_map : INFINITY);
+    g_free(p_dc);
+    g_free(v_dc);
+    g_free(tj);
+    g_free(p_ac);
+    g_free(scratch);
+    return 0;
+}
\ No newline at end of file
@@ -2,14 +2,25 @@
 
 void single_phase_output(InverterParams *params, double time, double *output) {
     double peak_voltage = params->voltage * sqrt(2); // Convert RMS to peak
-    output[0] = peak_voltage * sin(2 * M_PI * params->frequency * time + params->phase);
+    output[0] = peak_voltage * sin(timebase_angle(params->frequency, time) + params->phase);
     output[1] = 0.0;
     output[2] = 0.0;
 }
 
 void three_phase_output(InverterParams *params, double time, double *output) {
     double peak_voltage = params->voltage * sqrt(2); // Convert RMS to peak
-    output[0] = peak_voltage * sin(2 * M_PI * params->frequency * time + params->phase);
-    output[1] = peak_voltage * sin(2 * M_PI * params->frequency * time + params->phase + 2 * M_PI / 3);
-    output[2] = peak_voltage * sin(2 * M_PI * params->frequency * time + params->phase + 4 * M_PI / 3);
+    double angle = timebase_angle(params->frequency, time) + params->phase;
+    output[0] = peak_voltage * sin(angle);
+    output[1] = peak_voltage * sin(angle + 2 * M_PI / 3);
+    output[2] = peak_voltage * sin(angle + 4 * M_PI / 3);
+}
+
+// Three-phase output modulated by the dq current controller: v_abc = Vpeak * T^-1(theta) * m_dq
+void dq_modulated_output(InverterParams *params, double time, double *output) {
+    double peak_voltage = params->voltage * sqrt(2); // Convert RMS to peak
+    double angle = timebase_angle(params->frequency, time);
+    dq_to_abc_batch(&params->control_dq[0], &params->control_dq[1], &angle, &output[0], &output[1], &output[2], 1);
+    for (int i = 0; i < 3; i++) {
+        output[i] *= peak_voltage;
+    }
 }
\ No newline at end of file
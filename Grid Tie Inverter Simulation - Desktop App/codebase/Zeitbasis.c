@@ -0,0 +1,28 @@
+#include "inverter.h"
+#include <math.h>
+
+// Shared simulation time base
+// Time is accumulated with Kahan compensation so rounding does not build up over
+// billions of steps, and every waveform takes its angle from timebase_angle(), which
+// wraps f*t to one cycle before scaling by 2*pi. The remaining error is the
+// representation of t itself: about 1e-6 rad at 50 Hz after one simulated year.
+
+void timebase_reset(InverterParams *params, double time) {
+    params->sim_time = time;
+    params->sim_time_comp = 0.0;
+}
+
+void timebase_advance(InverterParams *params, double dt) {
+    double y = dt - params->sim_time_comp;
+    double t = params->sim_time + y;
+    params->sim_time_comp = (t - params->sim_time) - y; // Low-order bits lost in the sum
+    params->sim_time = t;
+}
+
+double timebase_angle(double frequency, double time) {
+    double cycles = frequency * time;
+    double error = fma(frequency, time, -cycles); // Exact rounding error of the product
+    double frac = (cycles - floor(cycles)) + error;
+    frac -= floor(frac); // Wrap to [0, 1)
+    return 2 * M_PI * frac;
+}
\ No newline at end of file
@@ -32,23 +32,19 @@ double calculate_time_step(AppData *app) {
 
 void simulation_step(AppData *app, double dt) {
     // Update simulation time
-    app->params.sim_time += dt;
+    timebase_advance(&app->params, dt);
 
     // Update MPPT if active
-    if (app->params.mppt == MPPT_PERTURB_OBSERVE) {
-        mppt_perturb_observe(&app->params);
-    } else if (app->params.mppt == MPPT_INCREMENTAL_CONDUCTANCE) {
-        mppt_incremental_conductance(&app->params);
-    }
+    mppt_update(&app->params);
 
     // Update PLL if enabled
     if (app->params.pll_enabled) {
-        pll_update(&app->params, app->params.sim_time);
+        pll_update(&app->params, app->params.sim_time, dt);
     }
 
     // Update control if active
     if (app->params.control != CONTROL_NONE) {
-        control_update(&app->params, app->params.sim_time);
+        control_update(&app->params, app->params.sim_time, dt);
     }
 
     // Update islanding detection if enabled
@@ -57,7 +53,13 @@ void simulation_step(AppData *app, double dt) {
     }
 
     // Update DC source
-    dc_source_update(app);
+    dc_source_update(app, dt);
+
+    // Boost the source onto the DC link if modelled
+    dc_link_update(&app->params, dt);
+
+    // Heat the bridge with its losses; sets the junction temperature of the loss model
+    thermal_update(&app->params, dt);
 }
 
 gboolean simulation_update(gpointer user_data) {
@@ -74,9 +76,15 @@ gboolean simulation_update(gpointer user_data) {
 
     // Update GUI elements
     if (app->params.pll_enabled) {
-        char lock_text[32];
-        snprintf(lock_text, sizeof(lock_text), "PLL Lock: %s", 
-                 app->params.pll_locked ? "Locked" : "Not Locked");
+        char lock_text[64];
+        if (app->params.pll_type == PLL_DDSRF) {
+            // Also show the voltage unbalance factor from the sequence extractor
+            snprintf(lock_text, sizeof(lock_text), "PLL Lock: %s (V-/V+ %.1f%%)",
+                     app->params.pll_locked ? "Locked" : "Not Locked", sequence_unbalance(&app->params.pll_sequence) * 100);
+        } else {
+            snprintf(lock_text, sizeof(lock_text), "PLL Lock: %s", 
+                     app->params.pll_locked ? "Locked" : "Not Locked");
+        }
         gtk_label_set_text(GTK_LABEL(app->pll_lock_label), lock_text);
     }
 
@@ -102,13 +110,19 @@ gboolean simulation_update(gpointer user_data) {
         case GRID_FAULT_SWELL: grid_status = "Voltage Swell"; break;
         case GRID_FAULT_HARMONICS: grid_status = "Harmonics"; break;
         case GRID_FAULT_FREQ_SHIFT: grid_status = "Frequency Shift"; break;
+        case GRID_FAULT_SINGLE_PHASE: grid_status = "Single-Phase Dip"; break;
+        case GRID_FAULT_PHASE_TO_PHASE: grid_status = "Phase-to-Phase Dip"; break;
         default: grid_status = "Unknown";
     }
     gtk_label_set_text(GTK_LABEL(app->grid_status_label), grid_status);
 
     // Update DC source labels
     char text[64];
-    snprintf(text, sizeof(text), "Vdc: %.2f V", app->params.dc_voltage);
+    if (app->params.dc_link_model != DC_LINK_NONE) {
+        snprintf(text, sizeof(text), "Vdc: %.2f V (link %.1f V)", app->params.dc_voltage, dc_link_voltage(&app->params));
+    } else {
+        snprintf(text, sizeof(text), "Vdc: %.2f V", app->params.dc_voltage);
+    }
     gtk_label_set_text(GTK_LABEL(app->dc_voltage_label), text);
     snprintf(text, sizeof(text), "Idc: %.2f A", app->params.dc_current);
     gtk_label_set_text(GTK_LABEL(app->dc_current_label), text);
@@ -37,7 +37,7 @@ void build_interface(AppData *app) {
     // MPPT type dropdown
     GtkWidget *mppt_label = gtk_label_new("MPPT Type:");
     gtk_box_append(GTK_BOX(control_box), mppt_label);
-    const char *mppts[] = { "None", "Perturb & Observe", "Incremental Conductance", NULL };
+    const char *mppts[] = { "None", "Perturb & Observe", "Incremental Conductance", "Periodic Sweep", "Particle Swarm", "Golden Section", NULL };
     app->mppt_dropdown = gtk_drop_down_new_from_strings(mppts);
     gtk_drop_down_set_selected(GTK_DROP_DOWN(app->mppt_dropdown), app->params.mppt);
     gtk_box_append(GTK_BOX(control_box), app->mppt_dropdown);
@@ -45,11 +45,40 @@ void build_interface(AppData *app) {
     // Control type dropdown
     GtkWidget *control_label = gtk_label_new("Control Type:");
     gtk_box_append(GTK_BOX(control_box), control_label);
-    const char *controls[] = { "None", "PI", "PR", "SMC", "MPC", NULL };
+    const char *controls[] = { "None", "PI", "PR", "SMC", "MPC", "Repetitive", NULL };
     app->control_dropdown = gtk_drop_down_new_from_strings(controls);
     gtk_drop_down_set_selected(GTK_DROP_DOWN(app->control_dropdown), app->params.control);
     gtk_box_append(GTK_BOX(control_box), app->control_dropdown);
 
+    // MPC variant dropdown
+    GtkWidget *mpc_variant_label = gtk_label_new("MPC Variant:");
+    gtk_box_append(GTK_BOX(control_box), mpc_variant_label);
+    const char *mpc_variants[] = { "Duty Grid", "Finite Control Set", "Explicit (Lookup)", "ADMM (Warm Start)", NULL };
+    app->mpc_variant_dropdown = gtk_drop_down_new_from_strings(mpc_variants);
+    gtk_drop_down_set_selected(GTK_DROP_DOWN(app->mpc_variant_dropdown), app->params.mpc_variant);
+    gtk_box_append(GTK_BOX(control_box), app->mpc_variant_dropdown);
+
+    // MPC horizon slider
+    GtkWidget *mpc_horizon_label = gtk_label_new("MPC Horizon (steps):");
+    gtk_box_append(GTK_BOX(control_box), mpc_horizon_label);
+    app->mpc_horizon_scale = gtk_scale_new_with_range(GTK_ORIENTATION_HORIZONTAL, 1, MPC_MAX_HORIZON, 1);
+    gtk_range_set_value(GTK_RANGE(app->mpc_horizon_scale), app->params.mpc_horizon);
+    gtk_box_append(GTK_BOX(control_box), app->mpc_horizon_scale);
+
+    // Fixed-point controller emulation switch
+    GtkWidget *fixed_point_label = gtk_label_new("Fixed-Point (Q15/Q31):");
+    gtk_box_append(GTK_BOX(control_box), fixed_point_label);
+    app->fixed_point_switch = gtk_switch_new();
+    gtk_switch_set_active(GTK_SWITCH(app->fixed_point_switch), app->params.fixed_point);
+    gtk_box_append(GTK_BOX(control_box), app->fixed_point_switch);
+
+    // PR harmonic compensation order slider (odd orders)
+    GtkWidget *harmonic_order_label = gtk_label_new("PR Harmonics (max order):");
+    gtk_box_append(GTK_BOX(control_box), harmonic_order_label);
+    app->harmonic_order_scale = gtk_scale_new_with_range(GTK_ORIENTATION_HORIZONTAL, 1, HARMONIC_MAX_ORDER, 2);
+    gtk_range_set_value(GTK_RANGE(app->harmonic_order_scale), app->params.harmonic_order);
+    gtk_box_append(GTK_BOX(control_box), app->harmonic_order_scale);
+
     // PLL switch
     GtkWidget *pll_label = gtk_label_new("PLL (Grid Sync):");
     gtk_box_append(GTK_BOX(control_box), pll_label);
@@ -57,6 +86,13 @@ void build_interface(AppData *app) {
     gtk_switch_set_active(GTK_SWITCH(app->pll_switch), app->params.pll_enabled);
     gtk_box_append(GTK_BOX(control_box), app->pll_switch);
 
+    GtkWidget *pll_type_label = gtk_label_new("PLL Type:");
+    gtk_box_append(GTK_BOX(control_box), pll_type_label);
+    const char *pll_types[] = { "Product (Legacy)", "SRF", "SOGI", "DSOGI", "DDSRF", NULL };
+    app->pll_type_dropdown = gtk_drop_down_new_from_strings(pll_types);
+    gtk_drop_down_set_selected(GTK_DROP_DOWN(app->pll_type_dropdown), app->params.pll_type);
+    gtk_box_append(GTK_BOX(control_box), app->pll_type_dropdown);
+
     // PLL lock status
     app->pll_lock_label = gtk_label_new("PLL Lock: Not Locked");
     gtk_box_append(GTK_BOX(control_box), app->pll_lock_label);
@@ -75,7 +111,8 @@ void build_interface(AppData *app) {
     // Grid condition dropdown
     GtkWidget *grid_label = gtk_label_new("Grid Condition:");
     gtk_box_append(GTK_BOX(control_box), grid_label);
-    const char *grids[] = { "Normal", "Weak", "Fault (Sag)", "Fault (Swell)", "Fault (Harmonics)", "Fault (Freq Shift)", NULL };
+    const char *grids[] = { "Normal", "Weak", "Fault (Sag)", "Fault (Swell)", "Fault (Harmonics)", "Fault (Freq Shift)", "Fault (1-Ph Dip)",
+                            "Fault (2-Ph Dip)", NULL };
     app->grid_dropdown = gtk_drop_down_new_from_strings(grids);
     gtk_drop_down_set_selected(GTK_DROP_DOWN(app->grid_dropdown), app->params.grid_condition);
     gtk_box_append(GTK_BOX(control_box), app->grid_dropdown);
@@ -100,6 +137,10 @@ void build_interface(AppData *app) {
     app->analysis_button = gtk_button_new_with_label("Freq/Small-Sig Analysis");
     gtk_box_append(GTK_BOX(control_box), app->analysis_button);
 
+    // Periodic steady-state button
+    app->steady_state_button = gtk_button_new_with_label("Jump to Steady State");
+    gtk_box_append(GTK_BOX(control_box), app->steady_state_button);
+
     // DC source status labels
     app->dc_voltage_label = gtk_label_new("Vdc: 0.00 V");
     gtk_box_append(GTK_BOX(control_box), app->dc_voltage_label);
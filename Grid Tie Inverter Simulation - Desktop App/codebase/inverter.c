@@ -1,4 +1,6 @@
 #include "inverter.h"
+#include <string.h>
+#include <time.h>
 
 void inverter_init(InverterParams *params) {
     params->voltage = 220.0; // Default 220V RMS
@@ -9,19 +11,27 @@ void inverter_init(InverterParams *params) {
     params->design = TRANSFORMERLESS; // Default to transformerless
     params->mppt = MPPT_NONE; // Default to no MPPT
     params->mppt_voltage = 220.0; // Initial MPPT voltage
+    memset(&params->mppt_state, 0, sizeof(params->mppt_state)); // First global search on the first MPPT call
     params->prev_power = 0.0;
     params->prev_voltage = 220.0;
     params->pll_enabled = FALSE; // Default to PLL disabled
+    params->pll_type = PLL_SRF; // Default synchronous-reference-frame PLL
     params->pll_phase = 0.0; // Initial PLL phase
     params->pll_frequency = 50.0; // Initial PLL frequency
     params->pll_voltage = 220.0; // Initial PLL voltage
     params->pll_locked = FALSE; // Initial PLL lock status
     params->pll_kp = 0.5; // Default proportional gain
     params->pll_ki = 10.0; // Default integral gain
+    params->pll_sample_time = PLL_SAMPLE_TIME; // PLL samples the PCC at 20 kHz whatever the step
     params->control = CONTROL_NONE; // Default to no control
     params->control_output = 1.0; // Default duty cycle
     params->control_ref_current = 10.0; // Default reference current (A, peak)
     params->control_ref_voltage = 220.0 * sqrt(2); // Default reference voltage (V, peak)
+    params->control_kp = 0.1; // Default PI current gains
+    params->control_ki = 5.0;
+    params->mpc_variant = MPC_DUTY_GRID; // Default to the duty-cycle grid search
+    params->mpc_horizon = 2; // Default 2-step prediction
+    params->fixed_point = FALSE; // Default double-precision controllers
     params->islanding_enabled = FALSE; // Default to islanding detection disabled
     params->islanding_detected = FALSE; // Default to grid connected
     params->grid_condition = GRID_NORMAL; // Default to normal grid
@@ -32,15 +42,76 @@ void inverter_init(InverterParams *params) {
     params->pv_temperature = 25.0; // Default 25 °C
     params->pv_ns = 6; // Default 6 panels in series
     params->pv_np = 2; // Default 2 strings in parallel
+    memset(&params->pv_curve, 0, sizeof(params->pv_curve)); // I-V curve built on first use
+    params->pv_field = NULL;
     params->battery_soc = 0.5; // Default 50% SoC
     params->battery_capacity = 100.0; // Default 100 Ah
     params->battery_charging = FALSE; // Default not charging
+    params->battery_temperature = 25.0; // Default 25 °C
+    battery_reset(params); // Relaxed RC branches
     params->fuel_cell_power = 500.0; // Default 500 W
-    params->sim_time = 0.0; // Initial simulation time
+    params->dc_link_model = DC_LINK_NONE; // Default: bridge on the source voltage
+    params->dc_link.inductance = 1.0e-3; // Default 1 mH boost inductor
+    params->dc_link.resistance = 0.05; // Default 50 mΩ inductor and switch resistance
+    params->dc_link.capacitance = 1.5e-3; // Default 1.5 mF DC-link capacitor
+    params->dc_link.switching_frequency = 20e3; // Default 20 kHz boost PWM
+    params->dc_link.voltage_ref = 400.0; // Default 400 V link
+    params->dc_link.voltage_bandwidth = 10.0; // Default 10 Hz voltage loop, well below the 100 Hz ripple
+    params->dc_link.voltage_damping = 0.7;
+    params->dc_link.current_bandwidth = 2e3; // Default 2 kHz current loop (f_sw / 10)
+    params->dc_link.control_period = 1e-3; // Default 1 kHz voltage loop sampling
+    dc_link_reset(params);
+    params->ambient_temperature = 25.0; // Default 25 °C air at the heatsink
+    thermal_reset(&params->thermal, params->ambient_temperature);
+    params->junction_temperature = params->thermal.t_igbt; // Junction starts at ambient
+    efficiency_map(params->type, params->design); // Builds the loss maps here, not inside the first simulation step
+    timebase_reset(params, 0.0); // Initial simulation time
     params->max_dt = 0.010; // Default max time step: 10ms
     params->prev_output[0] = 0.0; // Previous output initialization
     params->prev_output[1] = 0.0;
     params->prev_output[2] = 0.0;
+    memset(&params->pll_pi, 0, sizeof(params->pll_pi)); // Model state starts from rest
+    params->pll_prev_grid_v = 0.0;
+    params->pll_last_zero_cross = 0.0;
+    params->pll_zero_cross_count = 0;
+    params->pll_angle = 0.0;
+    memset(params->pll_sogi, 0, sizeof(params->pll_sogi));
+    memset(params->pll_sogi_input, 0, sizeof(params->pll_sogi_input));
+    memset(&params->pll_sequence, 0, sizeof(params->pll_sequence));
+    memset(&params->current_pi, 0, sizeof(params->current_pi));
+    memset(&params->current_pi_q, 0, sizeof(params->current_pi_q));
+    memset(&params->current_pi_fixed, 0, sizeof(params->current_pi_fixed));
+    memset(&params->current_pi_q_fixed, 0, sizeof(params->current_pi_q_fixed));
+    memset(&params->pll_pi_fixed, 0, sizeof(params->pll_pi_fixed));
+    memset(params->control_dq, 0, sizeof(params->control_dq));
+    memset(params->plant_current_abc, 0, sizeof(params->plant_current_abc));
+    memset(&params->harmonic_bank, 0, sizeof(params->harmonic_bank));
+    memset(&params->harmonic_bank_fixed, 0, sizeof(params->harmonic_bank_fixed));
+    params->harmonic_order = 1; // Default fundamental resonance only
+    params->harmonic_kr[0] = params->harmonic_kr[1] = HARMONIC_DEFAULT_KR;
+    params->harmonic_tuned_frequency = 0.0; // Bank untuned until the first PR step
+    params->harmonic_tuned_dt = 0.0;
+    params->harmonic_tuned_order = 0;
+    params->harmonic_tuned_kr[0] = params->harmonic_tuned_kr[1] = 0.0;
+    params->harmonic_output = 0.0;
+    memset(params->rc_buffer, 0, sizeof(params->rc_buffer));
+    params->rc_head = 0;
+    params->rc_dt = 0.0;
+    params->rc_elapsed = 0.0;
+    params->rc_error_sum = 0.0;
+    params->control_prev_error = 0.0;
+    params->plant_current = 0.0;
+    params->mpc_level = 0.0;
+    memset(params->mpc_plan, 0, sizeof(params->mpc_plan));
+    memset(params->mpc_dual, 0, sizeof(params->mpc_dual));
+    params->mpc_nodes = 0;
+    params->grid_connected = TRUE;
+    params->island_prev_freq = 50.0;
+    params->island_prev_time = 0.0;
+    params->grid_rng_state = (guint32)time(NULL) | 1u; // Non-zero xorshift seed
+    params->battery_type = 0; // Default Li-ion
+    battery_aging_init(&params->battery_aging, params->battery_type); // New battery
+    params->battery_aging_time = 0.0;
 }
 
 void inverter_get_output(InverterParams *params, double time, double *output) {
@@ -68,7 +139,11 @@ void inverter_get_output(InverterParams *params, double time, double *output) {
             single_phase_output(params, time, output);
             break;
         case THREE_PHASE:
-            three_phase_output(params, time, output);
+            if (control_dq_active(params)) {
+                dq_modulated_output(params, time, output); // Per-phase modulation from the dq controller
+            } else {
+                three_phase_output(params, time, output);
+            }
             break;
         case NPC_INVERTER:
             npc_inverter_output(params, time, output);
@@ -77,11 +152,15 @@ void inverter_get_output(InverterParams *params, double time, double *output) {
             flying_capacitor_output(params, time, output);
             break;
         case CASCADED_H_BRIDGE:
-            cascaded_h_bridge_output(params, time, output);
+            if (control_dq_active(params)) {
+                dq_modulated_output(params, time, output); // Averaged cell output under dq control
+            } else {
+                cascaded_h_bridge_output(params, time, output);
+            }
             break;
     }
-    // Apply control type (duty cycle scaling)
-    if (params->control != CONTROL_NONE) {
+    // Apply control type (duty cycle scaling; the dq path already modulates each phase)
+    if (params->control != CONTROL_NONE && !control_dq_active(params)) {
         for (int i = 0; i < 3; i++) {
             output[i] *= params->control_output;
         }
@@ -23,7 +23,10 @@ typedef enum {
 typedef enum {
     MPPT_NONE,
     MPPT_PERTURB_OBSERVE,
-    MPPT_INCREMENTAL_CONDUCTANCE
+    MPPT_INCREMENTAL_CONDUCTANCE,
+    MPPT_SWEEP, // Periodic sweep, then perturb and observe
+    MPPT_PSO, // Particle swarm search, then perturb and observe
+    MPPT_GOLDEN // Coarse scan and golden-section refinement, then perturb and observe
 } MPPTType;
 
 // Enum for control type
@@ -32,9 +35,27 @@ typedef enum {
     CONTROL_PI,
     CONTROL_PR,
     CONTROL_SMC,
-    CONTROL_MPC
+    CONTROL_MPC,
+    CONTROL_REPETITIVE
 } ControlType;
 
+// Enum for MPC formulation
+typedef enum {
+    MPC_DUTY_GRID,
+    MPC_FINITE_SET,
+    MPC_EXPLICIT,
+    MPC_ADMM
+} MPCVariant;
+
+// Enum for PLL structure
+typedef enum {
+    PLL_PRODUCT,
+    PLL_SRF,
+    PLL_SOGI,
+    PLL_DSOGI,
+    PLL_DDSRF
+} PLLType;
+
 // Enum for grid condition
 typedef enum {
     GRID_NORMAL,
@@ -42,7 +63,9 @@ typedef enum {
     GRID_FAULT_SAG,
     GRID_FAULT_SWELL,
     GRID_FAULT_HARMONICS,
-    GRID_FAULT_FREQ_SHIFT
+    GRID_FAULT_FREQ_SHIFT,
+    GRID_FAULT_SINGLE_PHASE,
+    GRID_FAULT_PHASE_TO_PHASE
 } GridCondition;
 
 // Enum for DC source
@@ -53,12 +76,381 @@ typedef enum {
     DC_SOURCE_HYBRID
 } DCSourceType;
 
+// Enum for the DC-link model between the DC source and the inverter bridge
+typedef enum {
+    DC_LINK_NONE, // Bridge sees the source voltage directly
+    DC_LINK_AVERAGED, // Averaged boost stage and DC-link capacitor, large steps
+    DC_LINK_SWITCHING // Boost switched at the PWM frequency, exact piecewise-linear intervals
+} DCLinkModel;
+
 // Enum for analysis type
 typedef enum {
     ANALYSIS_BODE,
     ANALYSIS_STEP
 } AnalysisType;
 
+// Enum for controller discretisation method
+typedef enum {
+    DISCRETIZE_TUSTIN,
+    DISCRETIZE_ZOH,
+    DISCRETIZE_FORWARD_EULER
+} DiscretizationMethod;
+
+// Enum for the tuning parameters the differentiable model carries derivatives for
+typedef enum {
+    AD_PARAM_PLL_KP,
+    AD_PARAM_PLL_KI,
+    AD_PARAM_CONTROL_KP,
+    AD_PARAM_CONTROL_KI
+} ADParameter;
+
+// Enum for the cost metric of a differentiable run
+typedef enum {
+    AD_METRIC_CURRENT_ITAE,
+    AD_METRIC_CURRENT_THD,
+    AD_METRIC_PLL_ITAE,
+    AD_METRIC_PLL_SETTLING
+} ADMetric;
+
+#define AD_MAX_PARAMETERS 4 // Derivative directions of one dual number
+
+// Enum for the gains the auto-tuner adjusts
+typedef enum {
+    TUNE_PI,
+    TUNE_PR,
+    TUNE_PLL
+} TuningTarget;
+
+// Enum for the error signal of a scenario run
+typedef enum {
+    SCENARIO_SIGNAL_CURRENT,
+    SCENARIO_SIGNAL_PLL
+} ScenarioSignal;
+
+// Headless grid-event runs (Reglerautotuning.c)
+#define SCENARIO_DT 50e-6 // 20 kHz
+#define SCENARIO_START 0.8 // Run start (s): the loop settles from rest before the event
+#define SCENARIO_EVENT 1.0 // Grid events of GridSimulation.c start here (s)
+#define SCENARIO_END 1.3 // Run end (s)
+
+// Response of one headless grid-event run
+typedef struct {
+    double overshoot; // Rise of the one-period RMS error after the event (per unit of rated current or 2 deg)
+    double settling; // Time after the event until the RMS error stays in the band around zero (s)
+    gboolean settled; // Final RMS error inside the band; otherwise settling is the whole window
+    double thd; // Phase-a current THD over the last period
+    double tdd; // Phase-a harmonic current over the last period per unit of the reference (total demand distortion)
+    double rms; // RMS error over the last period (A or rad)
+    double fundamental; // Phase-a current fundamental over the last period per unit of the reference
+    double step_ns; // Wall time per simulation step (ns)
+    gboolean aborted; // Stopped early: diverged or above the overshoot limit
+} ScenarioMetrics;
+
+// Objective weights of the auto-tuner
+typedef struct {
+    double overshoot;
+    double settling; // Per unit of the observation window after the event
+    double thd;
+    double margin; // Penalty per unit of phase margin missing to 45 deg
+} TuningWeights;
+
+#define TUNE_SCENARIOS 4 // Sag, swell, frequency shift, weak grid
+
+// Result of an auto-tuning run
+typedef struct {
+    gboolean progress; // Print the best vertex after every iteration
+    double initial_cost, cost; // Objective at the starting and at the tuned gains
+    double margin; // Phase margin at the tuned gains (deg)
+    ScenarioMetrics metrics[TUNE_SCENARIOS]; // Scenario responses at the tuned gains
+    int iterations;
+    long runs, dropped; // Scenario runs started, candidates dropped early
+    double wall, busy; // Wall time and summed run time (s)
+} AutotuneReport;
+
+// Second-order section: continuous prototype plus cached discrete coefficients
+typedef struct {
+    double num[3]; // Continuous numerator {b0, b1, b2} (b0 + b1*s + b2*s^2)
+    double den[3]; // Continuous denominator {a0, a1, a2}
+    DiscretizationMethod method; // Discretisation method
+    double prewarp; // Tustin pre-warping frequency (rad/s), 0 = none
+    double dt; // Sample time of the cached coefficients (s), 0 = not computed
+    double b0, b1, b2, a1, a2; // Discrete coefficients (a0 normalised to 1)
+    double s1, s2; // Transposed direct form II state
+    guint version; // Changes whenever the discrete coefficients do; 0 = never computed
+} Biquad;
+
+#define BIQUAD_BANK_SIZE 32
+
+// Batched second-order sections in structure-of-arrays layout
+typedef struct {
+    int n; // Active lanes
+    double b0[BIQUAD_BANK_SIZE], b1[BIQUAD_BANK_SIZE], b2[BIQUAD_BANK_SIZE];
+    double a1[BIQUAD_BANK_SIZE], a2[BIQUAD_BANK_SIZE];
+    double s1[BIQUAD_BANK_SIZE], s2[BIQUAD_BANK_SIZE];
+} BiquadBank;
+
+// Fixed-point second-order section: Q15 samples, Q31 coefficients, 64-bit state
+typedef struct {
+    gint32 b0, b1, b2, a1, a2; // Coefficients in Q(31 - shift)
+    int shift; // Integer bits of the coefficients
+    gint64 s1, s2; // Transposed direct form II state, Q(46 - shift)
+    guint version; // Biquad version the coefficients were quantised from
+    double gain; // Input-to-output full-scale ratio they were quantised for
+} FixedBiquad;
+
+// Fixed-point sections in structure-of-arrays layout, one coefficient format for all lanes
+typedef struct {
+    int n; // Active lanes
+    int shift; // Integer bits of the coefficients
+    gboolean valid; // Coefficients match the floating-point bank
+    double gain; // Input/output scaling folded into the numerators
+    gint32 b0[BIQUAD_BANK_SIZE], b1[BIQUAD_BANK_SIZE], b2[BIQUAD_BANK_SIZE];
+    gint32 a1[BIQUAD_BANK_SIZE], a2[BIQUAD_BANK_SIZE];
+    gint64 s1[BIQUAD_BANK_SIZE], s2[BIQUAD_BANK_SIZE];
+} FixedBiquadBank;
+
+#define FIXED_CURRENT_FS 32.0 // Q15 full scale of current samples (A)
+#define FIXED_VOLTAGE_FS 1024.0 // Q15 full scale of voltage samples and dq voltage commands (V)
+#define FIXED_DUTY_FS 2.0 // Q15 full scale of duty and per-unit modulation
+
+// SRF-PLL loop design (Phasenregelkreis.c, also used by the differentiable model)
+#define PLL_NOMINAL_FREQUENCY 50.0 // Hz
+#define PLL_KP 133.0 // rad/s per rad at the default slider setting (wn = 2*pi*15, zeta = 0.707)
+#define PLL_KI 8883.0 // rad/s^2 per rad at the default slider setting
+#define PLL_DEFAULT_KP 0.5 // Slider values the gains above correspond to
+#define PLL_DEFAULT_KI 10.0
+#define PLL_FREQUENCY_TAU 0.02 // Low-pass on the reported frequency (s)
+#define PLL_VOLTAGE_TAU 0.02 // Low-pass on the reported RMS voltage (s)
+#define PLL_SAMPLE_TIME 50e-6 // Default internal sample time of pll_update (s)
+
+// Current control plant: RL load against the grid
+#define PLANT_R 10.0 // Load resistance (Ohms)
+#define PLANT_L 0.01 // Load inductance (H)
+
+// Decoupled double synchronous frame: low-passed sequence components
+typedef struct {
+    double pos[2]; // Positive sequence (d, q) in the frame rotating at +theta (V peak)
+    double neg[2]; // Negative sequence (d, q) in the frame rotating at -theta (V peak)
+} SequenceExtractor;
+
+// PV module parameters (250 W, 60 cells) at STC
+#define PV_ISC 8.21 // Short-circuit current (A)
+#define PV_VOC 37.6 // Open-circuit voltage (V)
+#define PV_KI 0.00065 // Current temperature coefficient (A/°C)
+#define PV_KV -0.123 // Voltage temperature coefficient (V/°C)
+#define PV_GREF 1000.0 // Reference irradiance (W/m²)
+#define PV_TREF 25.0 // Reference temperature (°C)
+#define PV_CELLS 60 // Cells in series per module
+#define PV_IDEALITY 1.3 // Diode ideality factor
+#define PV_RS 0.221 // Series resistance (Ω)
+#define PV_RSH 415.405 // Shunt resistance (Ω)
+
+// Single-diode model of one module at an irradiance and temperature
+typedef struct {
+    double iph; // Photo current (A)
+    double io; // Diode saturation current (A)
+    double a; // Modified ideality voltage n * cells * k * T / q (V)
+} PVDiode;
+
+// PV field model (PVFeldModell.c)
+#define PV_SUBSTRINGS 3 // Bypass-diode substrings per module (20 cells each)
+#define PV_BYPASS_DROP 0.5 // Forward drop of a conducting bypass diode (V)
+#define PV_FIELD_POINTS 128 // Samples of the string and array I-V curves
+
+// PV plant of individually mismatched modules in structure-of-arrays layout.
+// Module m of string s has index s * modules + m, its substring k has index (s * modules + m) * PV_SUBSTRINGS + k.
+typedef struct {
+    int strings, modules; // Strings in parallel, modules in series per string
+    double *temperature; // Per module: cell temperature (°C)
+    double *degradation; // Per module: photocurrent lost to aging and soiling (0 = new)
+    double *irradiance; // Per substring: plane-of-array irradiance (W/m²), partial shading
+    double *iph, *io, *a, *rs, *rsh; // Per substring: single-diode model from pv_field_update (A, A, V, Ω, Ω)
+    double *log_k; // Per substring: ln(Rsh * Io / a), the constant part of the Lambert W argument
+    double *bypass_i; // Per substring: current above which its bypass diode conducts (A)
+    int *weight; // Per substring: substrings of its module it solves for, 0 if an identical earlier one does
+    double *string_i, *string_v; // Per string: PV_FIELD_POINTS currents from 0 to the largest photocurrent and the string voltages
+    double array_v[PV_FIELD_POINTS]; // Array curve: uniform voltages from 0 to array_voc (V)
+    double array_i[PV_FIELD_POINTS]; // Array curve: summed string currents, blocking diodes included (A)
+    double array_voc; // Highest string open-circuit voltage (V)
+} PVField;
+
+#define PV_CURVE_POINTS 96 // Samples of the cached PV I-V curve
+
+// PV array I-V curve sampled for one irradiance, temperature and layout
+typedef struct {
+    double irradiance, temperature; // Inputs the curve was built for (W/m², °C)
+    int ns, np; // Layout the curve was built for, ns = 0 = not built
+    double voc; // Array open-circuit voltage (V)
+    double v[PV_CURVE_POINTS]; // Sample voltages from 0 to voc, denser towards voc (V)
+    double i[PV_CURVE_POINTS]; // Array current at the samples (A)
+    double slope[PV_CURVE_POINTS]; // Monotone (Fritsch-Carlson) dI/dV at the samples (A/V)
+} PVCurve;
+
+// Global MPPT searches (MaximaleLeistungspunktverfolgung.c)
+#define MPPT_STEP 0.005 // Perturb-and-observe step (per unit of the source open-circuit voltage)
+#define MPPT_MIN_VOLTAGE 1e-3 // Incremental conductance holds the reference below this operating voltage (V)
+#define MPPT_SCAN_INTERVAL 30.0 // Time between global searches (s)
+#define MPPT_SWEEP_POINTS 24 // Operating points of one sweep
+#define MPPT_SWARM 5 // PSO particles
+#define MPPT_PSO_GENERATIONS 6 // PSO generations per search
+#define MPPT_GOLDEN_SEGMENTS 6 // Coarse points that bracket the global peak before golden-section refinement
+
+// State of a global MPPT search
+typedef struct {
+    gboolean searching; // Global search in progress, perturb and observe otherwise
+    int step; // Operating points applied in the current search
+    double last_search; // Time the last search started (s)
+    double best_v, best_p; // Best point of the current search (V, W)
+    double lo, hi; // Golden section: bracket (V)
+    double x1, x2, p1, p2; // Golden section: interior points and their powers
+    double position[MPPT_SWARM], velocity[MPPT_SWARM]; // PSO: particle voltages and velocities (V, V per generation)
+    double personal_v[MPPT_SWARM], personal_p[MPPT_SWARM]; // PSO: best point of each particle
+    guint32 rng; // PSO: xorshift state, 0 = seed on first search
+    long evaluations; // Operating points applied (one per MPPT call)
+    long searches; // Global searches started
+    long search_evaluations; // Operating points spent in global searches
+} MPPTState;
+
+// PEM fuel cell stack (GleichstromquellenModellierung.c)
+#define FUEL_CELL_V0 48.0 // Open-circuit stack voltage (V)
+#define FUEL_CELL_TAFEL 0.06 // Activation (Tafel) slope (V)
+#define FUEL_CELL_R 0.01 // Ohmic resistance (Ω)
+#define FUEL_CELL_M 0.05 // Mass transport coefficient (V)
+#define FUEL_CELL_N 0.0001 // Mass transport constant (1/A)
+#define FUEL_CELL_TABLE_POINTS 257 // Samples of the tabulated stack current over output power
+#define FUEL_CELL_TABLE_POWER 5000.0 // Power range of the table (W), solved exactly above
+
+// Battery equivalent circuit (Batteriemodell.c)
+#define BATTERY_SOC_POINTS 11 // Table rows: SoC from 0 to 1 in steps of 0.1
+#define BATTERY_TEMP_POINTS 5 // Resistance factors at -10, 0, 10, 25 and 40 °C
+#define BATTERY_SOC_MIN 0.2 // Discharge cut-off (BMS)
+#define BATTERY_SOC_MAX 0.9 // Charge cut-off (BMS)
+
+// Two-RC Thevenin battery: series resistance plus two RC branches, discretised exactly for a current held over the step
+typedef struct {
+    double v1, v2; // Polarisation voltages of the fast and slow RC branch (V)
+    double current; // Current of the last step after the BMS limits, positive = discharge (A)
+    double ocv, r0; // Pack open-circuit voltage and series resistance of the last step (V, Ω)
+    double cache_dt; // Step the decay factors belong to (s), < 0 = not computed
+    int cache_type; // Chemistry the decay factors belong to
+    double decay1, decay2; // exp(-dt / tau1), exp(-dt / tau2)
+    double capacity_fade; // Aging: lost share of the nominal capacity (0 = new)
+    double resistance_growth; // Aging: relative increase of R0, R1 and R2 (0 = new)
+} BatteryState;
+
+// Battery aging (Batteriealterung.c)
+#define RAINFLOW_STACK 256 // Open reversals kept by the streaming rainflow counter
+#define BATTERY_END_OF_LIFE 0.2 // Capacity fade at end of life
+
+// Receives each counted cycle: range, mean and count (1 = full cycle, 0.5 = half cycle)
+typedef void (*RainflowSink)(double range, double mean, double count, gpointer data);
+
+// Streaming rainflow counter (ASTM E1049 three-point rule) on a sample stream
+typedef struct {
+    double stack[RAINFLOW_STACK]; // Reversals not yet closed into cycles, oldest first
+    int n; // Reversals on the stack
+    double candidate; // Running extreme since the last confirmed reversal
+    int direction; // Direction towards the candidate: +1 rising, -1 falling, 0 = no reversal yet
+    double gate; // Smallest swing accepted as a reversal (hysteresis against noise)
+} RainflowCounter;
+
+// Calendar and cycle aging of the battery, advanced on a coarse time step
+typedef struct {
+    int type; // Chemistry: 0 = Li-ion, 1 = Lead-acid
+    RainflowCounter rainflow; // SoC cycles
+    double calendar_fade, cycle_fade; // Capacity lost to storage and to cycling
+    double cycles; // Counted cycles (full = 1, half = 0.5)
+    double full_cycles; // Equivalent full cycles: sum of count * depth
+    double temperature; // Cell temperature of the current sample (°C)
+    double soc_sum, temperature_sum; // Time integrals over the samples since the last coarse step (s)
+    double elapsed; // Time covered by the samples since the last coarse step (s)
+} BatteryAging;
+
+// DC link and boost stage (Zwischenkreis.c), one parameter set for both fidelities
+typedef struct {
+    double inductance; // Boost inductor (H)
+    double resistance; // Inductor and switch series resistance (Ω)
+    double capacitance; // DC-link capacitor (F)
+    double switching_frequency; // Boost PWM frequency (Hz)
+    double voltage_ref; // DC-link voltage setpoint (V)
+    double voltage_bandwidth; // DC-link voltage loop natural frequency (Hz)
+    double voltage_damping; // DC-link voltage loop damping ratio
+    double current_bandwidth; // Boost inductor current loop bandwidth (Hz)
+    double control_period; // Sample period of the DC-link voltage loop (s)
+} DCLinkParams;
+
+typedef struct {
+    double inductor_current; // Boost inductor current (A)
+    double voltage; // DC-link capacitor voltage (V)
+    double power_integral; // Voltage loop integrator (W)
+    double power; // Mean bridge power commanded by the voltage loop (W)
+    double duty; // Boost switch duty cycle
+    double load_current; // Switching: bridge DC current held over the PWM period (A)
+    double pwm_time; // Switching: time into the current PWM period (s)
+    double control_time; // Time since the last voltage loop sample (s)
+    double voltage_min, voltage_max; // Voltage extremes since the last dc_link_reset_ripple()
+} DCLinkState;
+
+// Semiconductor losses and efficiency map (Verlustmodell.c)
+#define LOSS_RATED_POWER 5000.0 // Inverter rating (W)
+#define LOSS_MAP_POWER_POINTS 41 // Output power from 0 to LOSS_MAP_POWER_MAX
+#define LOSS_MAP_VOLTAGE_POINTS 11 // DC-link voltage from LOSS_MAP_VOLTAGE_MIN to LOSS_MAP_VOLTAGE_MAX
+#define LOSS_MAP_TEMP_POINTS 6 // Junction temperature from LOSS_MAP_TEMP_MIN to LOSS_MAP_TEMP_MAX
+#define LOSS_MAP_POWER_MAX 6000.0 // W
+#define LOSS_MAP_VOLTAGE_MIN 300.0 // V
+#define LOSS_MAP_VOLTAGE_MAX 800.0 // V
+#define LOSS_MAP_TEMP_MIN 25.0 // °C
+#define LOSS_MAP_TEMP_MAX 150.0 // °C
+
+// Loss breakdown of the whole inverter at one operating point (W)
+typedef struct {
+    double igbt_conduction, diode_conduction; // Bridge conduction losses
+    double igbt_switching, diode_switching; // Bridge turn-on / turn-off and reverse-recovery losses
+    double passive; // Output filter, transformer and auxiliary supply
+    double total;
+    int devices; // IGBT / diode pairs sharing the bridge losses
+} InverterLosses;
+
+// Losses tabulated over (Tj, Vdc, P) for one topology and design, single precision (10.8 kB per table)
+typedef struct {
+    float loss[LOSS_MAP_TEMP_POINTS][LOSS_MAP_VOLTAGE_POINTS][LOSS_MAP_POWER_POINTS]; // Inverter total (W)
+    float igbt[LOSS_MAP_TEMP_POINTS][LOSS_MAP_VOLTAGE_POINTS][LOSS_MAP_POWER_POINTS]; // Per IGBT (W)
+    float diode[LOSS_MAP_TEMP_POINTS][LOSS_MAP_VOLTAGE_POINTS][LOSS_MAP_POWER_POINTS]; // Per diode (W)
+    int devices; // IGBT / diode pairs on the heatsink
+} EfficiencyMap;
+
+#define MISSION_PROFILE_SAMPLES 1440 // One-minute samples per mission profile day
+#define MISSION_PROFILE_START 20.0 // DC power below which the inverter sleeps (W)
+
+// Junction temperature and lifetime (ThermischesModell.c)
+#define THERMAL_FOSTER_TERMS 4 // Foster terms of a device, junction to case
+#define THERMAL_HEATSINK_TERMS 2 // Foster terms of the heatsink, heatsink to ambient
+
+// Temperature rises of the Foster terms and the temperatures they add up to
+typedef struct {
+    double igbt[THERMAL_FOSTER_TERMS], diode[THERMAL_FOSTER_TERMS]; // Junction to case (K)
+    double heatsink[THERMAL_HEATSINK_TERMS]; // Heatsink to ambient (K)
+    double t_igbt, t_diode, t_heatsink; // °C
+    double decay_dt; // Step of the cached decay factors, 0 = none cached
+    double igbt_decay[THERMAL_FOSTER_TERMS], diode_decay[THERMAL_FOSTER_TERMS];
+    double heatsink_decay[THERMAL_HEATSINK_TERMS];
+} ThermalState;
+
+// Bond-wire fatigue of one device from its junction temperature cycles
+typedef struct {
+    RainflowCounter rainflow; // Junction temperature cycles
+    double damage; // Miner sum of the counted cycles (1 = end of life)
+    double cycles; // Counted cycles (full = 1, half = 0.5)
+    double t_max; // Highest junction temperature sampled, swing included (°C)
+    double swing_max; // Largest junction swing at the fundamental (K)
+} ThermalLife;
+
+#define MPC_MAX_HORIZON 20
+#define MPC_MAX_LEVELS 8
+#define HARMONIC_MAX_ORDER 49 // Highest odd harmonic of the PR bank (25 lanes)
+#define HARMONIC_DEFAULT_KR 2.0 // Default PR resonant gain (per unit of peak voltage per A)
+#define RC_BUFFER_SIZE 1024 // Repetitive control delay line (power of two, > samples per period)
+
 // Structure to hold inverter parameters
 typedef struct {
     double voltage; // Output voltage amplitude (V, RMS)
@@ -71,17 +463,25 @@ typedef struct {
     double mppt_voltage; // Voltage adjusted by MPPT
     double prev_power; // Previous power for MPPT
     double prev_voltage; // Previous voltage for MPPT
+    MPPTState mppt_state; // Global MPPT search state
     gboolean pll_enabled; // PLL enabled state
+    PLLType pll_type; // PLL structure
     double pll_phase; // PLL-adjusted phase
     double pll_frequency; // PLL-adjusted frequency
     double pll_voltage; // PLL-adjusted voltage
     gboolean pll_locked; // PLL lock status
     double pll_kp; // PLL proportional gain
     double pll_ki; // PLL integral gain
+    double pll_sample_time; // Largest PLL sub-step inside pll_update (s)
     ControlType control; // Control algorithm
     double control_output; // Control-adjusted output (duty cycle)
     double control_ref_current; // Reference current for control
     double control_ref_voltage; // Reference voltage for control
+    double control_kp; // PI current controller proportional gain (single-phase PI and PR)
+    double control_ki; // PI current controller integral gain (single-phase PI and PR)
+    MPCVariant mpc_variant; // MPC formulation
+    int mpc_horizon; // MPC prediction horizon (steps)
+    gboolean fixed_point; // Current loop and SRF-PLL run in Q15/Q31 fixed-point emulation
     gboolean islanding_enabled; // Islanding detection enabled
     gboolean islanding_detected; // Islanding status
     GridCondition grid_condition; // Grid condition
@@ -92,13 +492,68 @@ typedef struct {
     double pv_temperature; // PV: °C
     int pv_ns; // PV: Panels in series
     int pv_np; // PV: Panels in parallel
+    PVCurve pv_curve; // PV: cached I-V curve of the current irradiance, temperature and layout
+    const PVField *pv_field; // PV: mismatched plant the MPPT sees instead of the uniform array, NULL = none
     double battery_soc; // Battery: State of charge (0–1)
     double battery_capacity; // Battery: Ah
     gboolean battery_charging; // Battery: Charging state
+    double battery_temperature; // Battery: cell temperature (°C)
+    BatteryState battery; // Battery: equivalent circuit state
+    BatteryAging battery_aging; // Battery: aging fed by the DC source, applied hourly to the battery state
+    double battery_aging_time; // Battery: simulated time since the last hourly aging step (s)
     double fuel_cell_power; // Fuel cell: Power demand (W)
+    DCLinkModel dc_link_model; // DC link: model fidelity, DC_LINK_NONE = no boost stage
+    DCLinkParams dc_link; // DC link: boost and capacitor parameters
+    DCLinkState dc_link_state; // DC link: boost and capacitor state
+    double junction_temperature; // Bridge: IGBT junction temperature seen by the loss model (°C)
+    double ambient_temperature; // Bridge: air temperature at the heatsink (°C)
+    ThermalState thermal; // Bridge: device and heatsink thermal networks
     double sim_time; // Simulation time (s)
+    double sim_time_comp; // Kahan compensation for sim_time
     double max_dt; // Maximum time step (s)
     double prev_output[3]; // Previous inverter output for dynamics
+    // Persistent model state (kept here so a run can be saved and restored)
+    Biquad pll_pi; // PLL: PI loop filter
+    double pll_angle; // PLL: estimated angle of the phase-a voltage (rad)
+    double pll_sogi[2][2]; // SOGI-PLL: in-phase and quadrature outputs of the alpha / beta SOGIs
+    double pll_sogi_input[2]; // SOGI-PLL: previous SOGI inputs (trapezoidal integration)
+    FixedBiquad pll_pi_fixed; // PLL: PI loop filter in fixed point
+    SequenceExtractor pll_sequence; // DDSRF-PLL: filtered positive / negative sequence of the PCC voltage
+    double pll_prev_grid_v; // PLL: previous grid sample for zero-crossing detection
+    double pll_last_zero_cross; // PLL: time of last positive zero-crossing (s)
+    int pll_zero_cross_count; // PLL: zero-crossings since last frequency estimate
+    Biquad current_pi; // Control: PI current controller (also the PI part of PR and the d axis of the dq path)
+    Biquad current_pi_q; // Control: q-axis PI of the three-phase dq path
+    FixedBiquad current_pi_fixed; // Control: current_pi in fixed point
+    FixedBiquad current_pi_q_fixed; // Control: current_pi_q in fixed point
+    double control_dq[2]; // Control: d/q modulation of the three-phase dq path (per unit of peak voltage)
+    double plant_current_abc[3]; // Control: three-phase plant phase currents of the dq path (A)
+    BiquadBank harmonic_bank; // Control: PR resonant terms at h = 1, 3, 5, ... (one lane each)
+    FixedBiquadBank harmonic_bank_fixed; // Control: harmonic_bank in fixed point
+    int harmonic_order; // Control: highest compensated odd harmonic (1 = fundamental only)
+    double harmonic_kr[2]; // Control: PR resonant gain at the fundamental and at h >= 3 (per unit of peak voltage per A)
+    double harmonic_tuned_frequency; // Control: fundamental the bank is tuned for (Hz)
+    double harmonic_tuned_dt; // Control: sample time the bank is tuned for (s)
+    int harmonic_tuned_order; // Control: harmonic order the bank is tuned for
+    double harmonic_tuned_kr[2]; // Control: resonant gains the bank is tuned for
+    double harmonic_output; // Control: waveform correction from the harmonic bank or repetitive controller (per unit of peak voltage)
+    double rc_buffer[RC_BUFFER_SIZE]; // Repetitive: delay line holding one fundamental period
+    int rc_head; // Repetitive: next write position in rc_buffer
+    double rc_dt; // Repetitive: sample time of the stored samples (s), 0 = empty
+    double rc_elapsed; // Repetitive: time since the last stored sample (s)
+    double rc_error_sum; // Repetitive: error integrated since the last stored sample (A*s)
+    double control_prev_error; // Control: previous error (SMC)
+    double plant_current; // Control: plant model inductor current (A)
+    double mpc_level; // MPC: applied switch level or modulation signal (per unit of peak voltage)
+    double mpc_plan[MPC_MAX_HORIZON]; // MPC: optimal input sequence of the last decision (warm start)
+    double mpc_dual[MPC_MAX_HORIZON]; // ADMM-MPC: scaled dual of the last decision (warm start)
+    long mpc_nodes; // MPC: work of the last decision (prediction nodes, regions tested or iterations)
+    double mpc_solve_time; // ADMM-MPC: wall time of the last solve (s)
+    gboolean grid_connected; // Islanding: grid connection state
+    double island_prev_freq; // Islanding: previous frequency for ROCOF (Hz)
+    double island_prev_time; // Islanding: previous time for ROCOF (s)
+    guint32 grid_rng_state; // Grid: random disconnection generator state
+    int battery_type; // Battery: 0 = Li-ion, 1 = Lead-acid
     // Frequency-domain and small-signal analysis parameters
     AnalysisType analysis_type; // Bode or step response
     double analysis_freq_min; // Min frequency (Hz)
@@ -118,10 +573,15 @@ typedef struct {
     GtkWidget *design_dropdown;
     GtkWidget *mppt_dropdown;
     GtkWidget *pll_switch;
+    GtkWidget *pll_type_dropdown;
     GtkWidget *pll_kp_scale;
     GtkWidget *pll_ki_scale;
     GtkWidget *pll_lock_label;
     GtkWidget *control_dropdown;
+    GtkWidget *mpc_variant_dropdown;
+    GtkWidget *mpc_horizon_scale;
+    GtkWidget *fixed_point_switch;
+    GtkWidget *harmonic_order_scale;
     GtkWidget *start_button;
     GtkWidget *pause_button;
     GtkWidget *reset_button;
@@ -141,6 +601,8 @@ typedef struct {
     GtkWidget *dc_charge_button;
     GtkWidget *dc_fuel_cell_switch;
     GtkWidget *dc_fuel_cell_power_scale;
+    GtkWidget *dc_link_dropdown;
+    GtkWidget *dc_link_capacitance_scale;
     GtkWidget *dc_voltage_label;
     GtkWidget *dc_current_label;
     GtkWidget *dc_soc_label;
@@ -156,6 +618,7 @@ typedef struct {
     GtkWidget *analysis_run_button;
     GtkWidget *analysis_reset_button;
     GtkWidget *analysis_drawing_area;
+    GtkWidget *steady_state_button; // Jump to periodic steady state
     InverterParams params;
     guint timeout_id; // For animation
 } AppData;
@@ -174,6 +637,7 @@ void waveform_draw(GtkDrawingArea *area, cairo_t *cr, int width, int height, gpo
 // Wechselrichtertopologie.c
 void single_phase_output(InverterParams *params, double time, double *output);
 void three_phase_output(InverterParams *params, double time, double *output);
+void dq_modulated_output(InverterParams *params, double time, double *output);
 
 // MehrstufigerWechselrichter.c
 void npc_inverter_output(InverterParams *params, double time, double *output);
@@ -188,29 +652,194 @@ void apply_transformer_based(InverterParams *params, double *output);
 double pv_model_power(double voltage);
 void mppt_perturb_observe(InverterParams *params);
 void mppt_incremental_conductance(InverterParams *params);
+void mppt_sweep(InverterParams *params);
+void mppt_pso(InverterParams *params);
+void mppt_golden(InverterParams *params);
+void mppt_update(InverterParams *params);
+double pv_source_current(InverterParams *params, double voltage);
+double pv_source_voc(InverterParams *params);
+int mppt_bench_main(int argc, char *argv[]);
 double dc_source_get_power(AppData *app, double voltage, double *current);
 
 // Phasenregelkreis.c
-void pll_update(InverterParams *params, double time);
+void pll_step(InverterParams *params, double time, const double *v_abc, double dt);
+void pll_update(InverterParams *params, double time, double dt);
+int pll_bench_main(int argc, char *argv[]);
+
+// Festkommaemulation.c
+gint16 q15_from_double(double x, double full_scale);
+double q15_to_double(gint16 x, double full_scale);
+gint16 q15_sub_sat(gint16 a, gint16 b);
+void q15_sin_cos(guint32 angle, gint16 *s, gint16 *c);
+guint32 q_isqrt(guint64 x);
+gint16 fixed_biquad_update(FixedBiquad *fq, const Biquad *bq, double gain, gint16 x);
+double fixed_controller_update(FixedBiquad *fq, const Biquad *bq, double x, double in_fs, double out_fs);
+void fixed_bank_update(FixedBiquadBank *fb, const BiquadBank *bank, double gain, const gint16 *in, gint16 *out);
+gint32 fixed_bank_sum(FixedBiquadBank *fb, const BiquadBank *bank, double gain, gint16 x);
+int fixed_bench_main(int argc, char *argv[]);
+
+// AutomatischeDifferenzierung.c
+gboolean ad_evaluate(const InverterParams *params, ADMetric metric, double duration, double dt, double start,
+                     const ADParameter *wrt, int n, double *cost, double *gradient);
+gboolean ad_cost(const InverterParams *params, ADMetric metric, double duration, double dt, double start, double *cost);
+double *ad_parameter(InverterParams *params, ADParameter parameter);
+int ad_bench_main(int argc, char *argv[]);
+
+// Reglerautotuning.c
+gboolean scenario_run(const InverterParams *base, GridCondition grid, ScenarioSignal signal, double overshoot_limit,
+                      ScenarioMetrics *m);
+void scenario_settling_text(const ScenarioMetrics *m, char *text, size_t size);
+double tune_phase_margin(const InverterParams *p, TuningTarget target);
+gboolean autotune_run(InverterParams *params, TuningTarget target, const TuningWeights *weights, int max_iterations,
+                      AutotuneReport *report);
+int autotune_main(int argc, char *argv[]);
+
+// Reglervergleich.c
+int shootout_main(int argc, char *argv[]);
+
+// SymmetrischeKomponenten.c
+void sequence_extract(SequenceExtractor *seq, double alpha, double beta, double theta, double w, double dt,
+                      double *pos, double *neg);
+double sequence_unbalance(const SequenceExtractor *seq);
 
 // StromUndSpannungsregelung.c
-void control_update(InverterParams *params, double time);
+void control_update(InverterParams *params, double time, double dt);
+void plant_coefficients(double dt, double *a, double *b);
+gboolean control_dq_active(const InverterParams *params);
+
+// ModellpraediktiveRegelung.c
+int mpc_switch_levels(InverterType type, double *levels);
+double mpc_update(InverterParams *params, double time, double dt, double current, double grid_voltage);
+int mpc_bench_main(int argc, char *argv[]);
+
+// Koordinatentransformation.c
+void clarke_batch(const double *a, const double *b, const double *c, double *alpha, double *beta, int n);
+void inverse_clarke_batch(const double *alpha, const double *beta, double *a, double *b, double *c, int n);
+void park_batch(const double *alpha, const double *beta, const double *theta, double *d, double *q, int n);
+void inverse_park_batch(const double *d, const double *q, const double *theta, double *alpha, double *beta, int n);
+void abc_to_dq_batch(const double *a, const double *b, const double *c, const double *theta, double *d, double *q, int n);
+void dq_to_abc_batch(const double *d, const double *q, const double *theta, double *a, double *b, double *c, int n);
+int dq_bench_main(int argc, char *argv[]);
+
+// HarmonischeKompensation.c
+void harmonic_bank_tune(InverterParams *params, double frequency, double dt);
+double harmonic_bank_update(InverterParams *params, double error);
+int harmonic_bench_main(int argc, char *argv[]);
 
 // IslandingDetectionMechanism.c
 void islanding_detection_update(InverterParams *params, double time);
 
 // GridSimulation.c
+double grid_harmonic_distortion(InverterParams *params, double frequency, double t);
+void grid_pcc_source(InverterParams *params, double t, double *v_source, double *drop, double *frequency,
+                     double *amplitude);
+void grid_pcc_voltages(InverterParams *params, double t, const double *inverter_current, double *v_pcc,
+                       double *frequency, double *amplitude);
 double grid_simulation_voltage(InverterParams *params, double t, double inverter_current, double *frequency, double *amplitude, gboolean *grid_connected);
 
 // GleichstromquellenModellierung.c
 void dc_source_window_create(AppData *app);
-void dc_source_update(AppData *app);
+void dc_source_update(AppData *app, double dt);
+double pv_array_current(InverterParams *params, double voltage);
+double pv_array_current_exact(const InverterParams *params, double voltage);
+PVDiode pv_diode(double irradiance, double temperature);
+double wright_omega(double x);
+double fuel_cell_voltage(double current);
+double fuel_cell_current_exact(double power, int *iterations);
+double fuel_cell_current(double power);
+double fuel_cell_max_power(void);
+
+// Batteriemodell.c
+void battery_reset(InverterParams *params);
+double battery_update(InverterParams *params, double current, double dt);
+void battery_efficiency(int type, double *eta_charge, double *eta_discharge);
+int battery_bench_main(int argc, char *argv[]);
+
+// HybridEinsatzplanung.c
+int dispatch_bench_main(int argc, char *argv[]);
+
+// Verlustmodell.c
+void inverter_losses(InverterType type, DesignType design, double power, double v_dc, double t_junction,
+                     InverterLosses *losses);
+const EfficiencyMap *efficiency_map(InverterType type, DesignType design);
+double efficiency_map_loss(const EfficiencyMap *map, double power, double v_dc, double t_junction);
+void efficiency_map_device_losses(const EfficiencyMap *map, double power, double v_dc, double t_junction,
+                                  double *p_igbt, double *p_diode);
+void efficiency_map_loss_batch(const EfficiencyMap *map, const double *power, const double *v_dc,
+                               const double *t_junction, double *loss, int n);
+double inverter_power(const InverterParams *params);
+double inverter_efficiency(const InverterParams *params);
+void mission_profile_day(int day, double ambient_offset, guint32 *rng, double *p_dc, double *v_dc, double *ambient);
+int efficiency_bench_main(int argc, char *argv[]);
+
+// ThermischesModell.c
+void thermal_reset(ThermalState *thermal, double ambient);
+void thermal_step(ThermalState *thermal, double p_igbt, double p_diode, double p_heatsink, double ambient, double dt);
+void thermal_update(InverterParams *params, double dt);
+void thermal_life_init(ThermalLife *life);
+double thermal_ripple(int device, double frequency);
+void thermal_life_sample(ThermalLife *life, double t_junction, double swing, double periods);
+void thermal_life_flush(ThermalLife *life);
+int thermal_life_main(int argc, char *argv[]);
+
+// Zwischenkreis.c
+void dc_link_reset(InverterParams *params);
+void dc_link_reset_ripple(InverterParams *params);
+void dc_link_update(InverterParams *params, double dt);
+double dc_link_voltage(const InverterParams *params);
+int dc_link_bench_main(int argc, char *argv[]);
+
+// Batteriealterung.c
+void rainflow_init(RainflowCounter *rf, double gate);
+void rainflow_push(RainflowCounter *rf, double x, RainflowSink sink, gpointer data);
+void rainflow_flush(RainflowCounter *rf, RainflowSink sink, gpointer data);
+void battery_aging_init(BatteryAging *aging, int type);
+void battery_aging_sample(BatteryAging *aging, double soc, double temperature, double dt);
+void battery_aging_update(BatteryAging *aging, BatteryState *battery, double dt);
+int battery_life_main(int argc, char *argv[]);
+
+// PVFeldModell.c
+PVField *pv_field_new(int strings, int modules);
+void pv_field_free(PVField *field);
+void pv_field_update(PVField *field);
+void pv_field_string_curve(PVField *field, int string);
+double pv_field_current(const PVField *field, double voltage);
+int pv_field_bench_main(int argc, char *argv[]);
+
+// DiskreteRegler.c
+void biquad_design(Biquad *bq, const double num[3], const double den[3], DiscretizationMethod method, double prewarp);
+void biquad_reset(Biquad *bq);
+void biquad_set_rate(Biquad *bq, double dt);
+double biquad_update(Biquad *bq, double x);
+double biquad_cascade_update(Biquad *sections, int n, double x);
+void biquad_pi(Biquad *bq, double kp, double ki, DiscretizationMethod method);
+void biquad_resonant(Biquad *bq, double kr, double w0, double wc, DiscretizationMethod method);
+void biquad_lead_lag(Biquad *bq, double k, double wz, double wp, DiscretizationMethod method);
+void biquad_bank_load(BiquadBank *bank, int lane, const Biquad *bq);
+void biquad_bank_update(BiquadBank *bank, const double *in, double *out);
+double biquad_bank_sum(BiquadBank *bank, double x);
+
+// Zeitbasis.c
+void timebase_reset(InverterParams *params, double time);
+void timebase_advance(InverterParams *params, double dt);
+double timebase_angle(double frequency, double time);
 
 // Zeitbereichssimulation.c
 double calculate_time_step(AppData *app);
 void simulation_step(AppData *app, double dt);
 gboolean simulation_update(gpointer user_data);
 
+// PeriodischerEingeschwungenerZustand.c
+gboolean steady_state_solve(AppData *app, int *iterations, double *residual);
+
+// Parallelisierung.c
+typedef void (*ParallelTask)(int task, gpointer data); // Runs task number task (0 .. n_tasks - 1)
+void parallel_for(int n_tasks, ParallelTask fn, gpointer data);
+
+// ParallelInDerZeit.c
+gboolean parareal_run(AppData *app, double t_end, int slices, int *iterations);
+int parareal_main(int argc, char *argv[]);
+
 // FrequenzbereichsUndKleinsignalanalyse.c
 void analysis_window_create(AppData *app);
 void frequency_domain_analysis(AppData *app, double *freq, double *gain, double *phase, int *n_points);
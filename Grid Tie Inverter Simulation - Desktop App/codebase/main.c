@@ -1,4 +1,5 @@
 #include "inverter.h"
+#include <string.h>
 
 static void on_start_button_toggled(GtkToggleButton *button, gpointer user_data) {
     AppData *app = (AppData *)user_data;
@@ -43,8 +44,13 @@ static void on_reset_button_clicked(GtkButton *button, gpointer user_data) {
     gtk_drop_down_set_selected(GTK_DROP_DOWN(app->design_dropdown), app->params.design);
     gtk_drop_down_set_selected(GTK_DROP_DOWN(app->mppt_dropdown), app->params.mppt);
     gtk_drop_down_set_selected(GTK_DROP_DOWN(app->control_dropdown), app->params.control);
+    gtk_drop_down_set_selected(GTK_DROP_DOWN(app->mpc_variant_dropdown), app->params.mpc_variant);
+    gtk_range_set_value(GTK_RANGE(app->mpc_horizon_scale), app->params.mpc_horizon);
+    gtk_range_set_value(GTK_RANGE(app->harmonic_order_scale), app->params.harmonic_order);
     gtk_switch_set_active(GTK_SWITCH(app->pll_switch), app->params.pll_enabled);
+    gtk_drop_down_set_selected(GTK_DROP_DOWN(app->pll_type_dropdown), app->params.pll_type);
     gtk_switch_set_active(GTK_SWITCH(app->islanding_switch), app->params.islanding_enabled);
+    gtk_switch_set_active(GTK_SWITCH(app->fixed_point_switch), app->params.fixed_point);
     gtk_range_set_value(GTK_RANGE(app->pll_kp_scale), app->params.pll_kp);
     gtk_range_set_value(GTK_RANGE(app->pll_ki_scale), app->params.pll_ki);
     gtk_label_set_text(GTK_LABEL(app->pll_lock_label), "PLL Lock: Not Locked");
@@ -59,10 +65,12 @@ static void on_reset_button_clicked(GtkButton *button, gpointer user_data) {
         gtk_range_set_value(GTK_RANGE(app->dc_ns_scale), app->params.pv_ns);
         gtk_range_set_value(GTK_RANGE(app->dc_np_scale), app->params.pv_np);
         gtk_range_set_value(GTK_RANGE(app->dc_soc_scale), app->params.battery_soc * 100);
-        gtk_drop_down_set_selected(GTK_DROP_DOWN(app->dc_battery_type_dropdown), 0);
+        gtk_drop_down_set_selected(GTK_DROP_DOWN(app->dc_battery_type_dropdown), app->params.battery_type);
         gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(app->dc_charge_button), app->params.battery_charging);
         gtk_switch_set_active(GTK_SWITCH(app->dc_fuel_cell_switch), FALSE);
         gtk_range_set_value(GTK_RANGE(app->dc_fuel_cell_power_scale), app->params.fuel_cell_power);
+        gtk_drop_down_set_selected(GTK_DROP_DOWN(app->dc_link_dropdown), app->params.dc_link_model);
+        gtk_range_set_value(GTK_RANGE(app->dc_link_capacitance_scale), app->params.dc_link.capacitance * 1e3);
     }
     if (app->analysis_window) {
         gtk_drop_down_set_selected(GTK_DROP_DOWN(app->analysis_type_dropdown), app->params.analysis_type);
@@ -120,6 +128,7 @@ static void on_design_changed(GtkDropDown *dropdown, GParamSpec *pspec, gpointer
 static void on_mppt_changed(GtkDropDown *dropdown, GParamSpec *pspec, gpointer user_data) {
     AppData *app = (AppData *)user_data;
     app->params.mppt = gtk_drop_down_get_selected(dropdown);
+    memset(&app->params.mppt_state, 0, sizeof(app->params.mppt_state)); // Global trackers start with a search
     if (app->params.running) {
         gtk_widget_queue_draw(app->drawing_area);
     }
@@ -133,6 +142,23 @@ static void on_control_changed(GtkDropDown *dropdown, GParamSpec *pspec, gpointe
     }
 }
 
+static void on_mpc_changed(GtkWidget *widget, gpointer user_data) {
+    AppData *app = (AppData *)user_data;
+    app->params.mpc_variant = gtk_drop_down_get_selected(GTK_DROP_DOWN(app->mpc_variant_dropdown));
+    app->params.mpc_horizon = (int)gtk_range_get_value(GTK_RANGE(app->mpc_horizon_scale));
+    if (app->params.running) {
+        gtk_widget_queue_draw(app->drawing_area);
+    }
+}
+
+static void on_harmonic_order_changed(GtkRange *range, gpointer user_data) {
+    AppData *app = (AppData *)user_data;
+    app->params.harmonic_order = (int)gtk_range_get_value(range) | 1; // Odd harmonics only
+    if (app->params.running) {
+        gtk_widget_queue_draw(app->drawing_area);
+    }
+}
+
 static void on_pll_toggled(GtkSwitch *switch_widget, gboolean state, gpointer user_data) {
     AppData *app = (AppData *)user_data;
     app->params.pll_enabled = state;
@@ -141,6 +167,22 @@ static void on_pll_toggled(GtkSwitch *switch_widget, gboolean state, gpointer us
     }
 }
 
+static void on_pll_type_changed(GtkDropDown *dropdown, GParamSpec *pspec, gpointer user_data) {
+    AppData *app = (AppData *)user_data;
+    app->params.pll_type = gtk_drop_down_get_selected(dropdown);
+    if (app->params.running) {
+        gtk_widget_queue_draw(app->drawing_area);
+    }
+}
+
+static void on_fixed_point_toggled(GtkSwitch *switch_widget, gboolean state, gpointer user_data) {
+    AppData *app = (AppData *)user_data;
+    app->params.fixed_point = state;
+    if (app->params.running) {
+        gtk_widget_queue_draw(app->drawing_area);
+    }
+}
+
 static void on_islanding_toggled(GtkWidget *switch_widget, gboolean state, gpointer user_data) {
     AppData *app = (AppData *)user_data;
     app->params.islanding_enabled = state;
@@ -165,7 +207,7 @@ static void on_dc_source_changed(GtkDropDown *dropdown, GParamSpec *pspec, gpoin
     AppData *app = (AppData *)user_data;
     app->params.dc_source = gtk_drop_down_get_selected(dropdown);
     if (app->params.running) {
-        dc_source_update(app);
+        dc_source_update(app, 0.0); // Re-evaluate without advancing time
         gtk_widget_queue_draw(app->drawing_area);
     }
 }
@@ -186,6 +228,15 @@ static void on_analysis_button_clicked(GtkButton *button, gpointer user_data) {
     gtk_window_present(GTK_WINDOW(app->analysis_window));
 }
 
+static void on_steady_state_button_clicked(GtkButton *button, gpointer user_data) {
+    AppData *app = (AppData *)user_data;
+    int iterations;
+    double residual;
+    if (steady_state_solve(app, &iterations, &residual)) {
+        gtk_widget_queue_draw(app->drawing_area);
+    }
+}
+
 static void activate(GtkApplication *gtk_app, gpointer user_data) {
     AppData *app = (AppData *)user_data;
     app->window = gtk_application_window_new(gtk_app);
@@ -217,17 +268,52 @@ static void activate(GtkApplication *gtk_app, gpointer user_data) {
     g_signal_connect(app->design_dropdown, "notify::selected", G_CALLBACK(on_design_changed), app);
     g_signal_connect(app->mppt_dropdown, "notify::selected", G_CALLBACK(on_mppt_changed), app);
     g_signal_connect(app->control_dropdown, "notify::selected", G_CALLBACK(on_control_changed), app);
+    g_signal_connect(app->mpc_variant_dropdown, "notify::selected", G_CALLBACK(on_mpc_changed), app);
+    g_signal_connect(app->mpc_horizon_scale, "value-changed", G_CALLBACK(on_mpc_changed), app);
+    g_signal_connect(app->harmonic_order_scale, "value-changed", G_CALLBACK(on_harmonic_order_changed), app);
     g_signal_connect(app->pll_switch, "state-set", G_CALLBACK(on_pll_toggled), app);
+    g_signal_connect(app->pll_type_dropdown, "notify::selected", G_CALLBACK(on_pll_type_changed), app);
     g_signal_connect(app->islanding_switch, "state-set", G_CALLBACK(on_islanding_toggled), app);
+    g_signal_connect(app->fixed_point_switch, "state-set", G_CALLBACK(on_fixed_point_toggled), app);
     g_signal_connect(app->grid_dropdown, "notify::selected", G_CALLBACK(on_grid_condition_changed), app);
     g_signal_connect(app->dc_source_dropdown, "notify::selected", G_CALLBACK(on_dc_source_changed), app);
     g_signal_connect(app->dc_source_button, "clicked", G_CALLBACK(on_dc_source_button_clicked), app);
     g_signal_connect(app->analysis_button, "clicked", G_CALLBACK(on_analysis_button_clicked), app);
+    g_signal_connect(app->steady_state_button, "clicked", G_CALLBACK(on_steady_state_button_clicked), app);
 
     gtk_window_present(GTK_WINDOW(app->window));
 }
 
+// Headless modes: run from the command line without opening a window
+static const struct {
+    const char *flag;
+    int (*run)(int argc, char *argv[]);
+} headless_modes[] = {
+    { "--parareal", parareal_main },
+    { "--mpc-bench", mpc_bench_main },
+    { "--harmonic-bench", harmonic_bench_main },
+    { "--dq-bench", dq_bench_main },
+    { "--pll-bench", pll_bench_main },
+    { "--fixed-bench", fixed_bench_main },
+    { "--ad-bench", ad_bench_main },
+    { "--autotune", autotune_main },
+    { "--control-shootout", shootout_main },
+    { "--pv-field-bench", pv_field_bench_main },
+    { "--mppt-bench", mppt_bench_main },
+    { "--battery-bench", battery_bench_main },
+    { "--battery-life", battery_life_main },
+    { "--dispatch-bench", dispatch_bench_main },
+    { "--dc-link-bench", dc_link_bench_main },
+    { "--efficiency-bench", efficiency_bench_main },
+    { "--thermal-life", thermal_life_main },
+};
+
 int main(int argc, char *argv[]) {
+    for (size_t i = 0; argc > 1 && i < sizeof(headless_modes) / sizeof(headless_modes[0]); i++) {
+        if (strcmp(argv[1], headless_modes[i].flag) == 0) {
+            return headless_modes[i].run(argc, argv);
+        }
+    }
     AppData app = {0};
     GtkApplication *gtk_app = gtk_application_new("com.example.inverter", G_APPLICATION_DEFAULT_FLAGS);
     g_signal_connect(gtk_app, "activate", G_CALLBACK(activate), &app);
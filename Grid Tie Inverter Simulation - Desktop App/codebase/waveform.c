@@ -35,7 +35,15 @@ void waveform_draw(GtkDrawingArea *area, cairo_t *cr, int width, int height, gpo
     double dt = 0.001;
     int samples = width; // One sample per pixel
 
-    // Plot three-phase or single-phase output
+    // Evaluate every sample once for all phases, then plot three-phase or single-phase output
+    double *values = g_new(double, 3 * samples);
+    for (int i = 0; i < samples; i++) {
+        double t = time - (samples - i) * dt;
+        inverter_get_output(&app->params, t, output);
+        values[i] = output[0];
+        values[samples + i] = output[1];
+        values[2 * samples + i] = output[2];
+    }
     for (int phase = 0; phase < (app->params.type == SINGLE_PHASE ? 1 : 3); phase++) {
         // Set color for each phase
         switch (phase) {
@@ -47,9 +55,7 @@ void waveform_draw(GtkDrawingArea *area, cairo_t *cr, int width, int height, gpo
 
         // Start path
         for (int i = 0; i < samples; i++) {
-            double t = time - (samples - i) * dt;
-            inverter_get_output(&app->params, t, output);
-            double value = output[phase];
+            double value = values[phase * samples + i];
             double x = i * width / (double)samples;
             double y = height / 2.0 - (value / 400.0) * (height / 2.0); // Scale to ±400V
             if (i == 0) {
@@ -60,4 +66,5 @@ void waveform_draw(GtkDrawingArea *area, cairo_t *cr, int width, int height, gpo
         }
         cairo_stroke(cr);
     }
+    g_free(values);
 }
\ No newline at end of file